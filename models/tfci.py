@@ -19,6 +19,8 @@ Use this script to compress images with pre-trained models as published. See the
 """
 
 import argparse
+import collections
+from concurrent import futures
 import os
 import sys
 import urllib
@@ -96,11 +98,26 @@ def instantiate_signature(signature_def):
   return inputs, outputs
 
 
-def compress_image(model, input_image):
-  """Compresses an image array into a bitstring."""
-  with tf.Graph().as_default():
+def compress_images(model, input_images, num_parallel=2):
+  """Compresses a sequence of image arrays into bitstrings.
+
+  The model is loaded once, with the async range coding kernels, and up to
+  `num_parallel` images are compressed concurrently. The entropy coding of one
+  image then overlaps with the transforms of the next one.
+
+  Args:
+    model: String. Model identifier.
+    input_images: Iterable of image arrays. It is consumed lazily, so it can be
+      a generator that loads the images one by one.
+    num_parallel: Integer. Maximum number of images in flight.
+
+  Yields:
+    The bitstring of each image, in the order of `input_images`.
+  """
+  with tf.Graph().as_default() as graph:
     # Load model metagraph.
-    signature_defs = import_metagraph(model)
+    with tfc.async_range_coding(graph):
+      signature_defs = import_metagraph(model)
     inputs, outputs = instantiate_signature(signature_defs["sender"])
 
     # Just one input tensor.
@@ -108,15 +125,31 @@ def compress_image(model, input_image):
     # Multiple output tensors, ordered alphabetically, without names.
     outputs = [outputs[k] for k in sorted(outputs) if k.startswith("channel:")]
 
-    # Run encoder.
-    with tf.Session() as sess:
+    def compress_one(input_image):
+      # Run encoder.
       arrays = sess.run(outputs, feed_dict={inputs: input_image})
 
-    # Pack data into bitstring.
-    packed = tfc.PackedTensors()
-    packed.model = model
-    packed.pack(outputs, arrays)
-    return packed.string
+      # Pack data into bitstring.
+      packed = tfc.PackedTensors()
+      packed.model = model
+      packed.pack(outputs, arrays)
+      return packed.string
+
+    with tf.Session() as sess:
+      with futures.ThreadPoolExecutor(num_parallel) as executor:
+        pending = collections.deque()
+        for input_image in input_images:
+          if len(pending) >= num_parallel:
+            yield pending.popleft().result()
+          pending.append(executor.submit(compress_one, input_image))
+        while pending:
+          yield pending.popleft().result()
+
+
+def compress_image(model, input_image):
+  """Compresses an image array into a bitstring."""
+  bitstring, = compress_images(model, [input_image], num_parallel=1)
+  return bitstring
 
 
 def compress(model, input_file, output_file, target_bpp=None, bpp_strict=False):
@@ -169,6 +202,22 @@ def compress(model, input_file, output_file, target_bpp=None, bpp_strict=False):
     f.write(bitstring)
 
 
+def compress_files(model, input_files, num_parallel=2):
+  """Compresses PNG files to TFCI files, appending '.tfci' to the filenames."""
+  def read_images():
+    with tf.Graph().as_default():
+      filename = tf.placeholder(tf.string, [])
+      image = read_png(filename)
+      with tf.Session() as sess:
+        for input_file in input_files:
+          yield sess.run(image, feed_dict={filename: input_file})
+
+  bitstrings = compress_images(model, read_images(), num_parallel)
+  for input_file, bitstring in zip(input_files, bitstrings):
+    with tf.io.gfile.GFile(input_file + ".tfci", "wb") as f:
+      f.write(bitstring)
+
+
 def decompress(input_file, output_file):
   """Decompresses a TFCI file and writes a PNG file."""
   if not output_file:
@@ -245,6 +294,24 @@ def parse_args(argv):
       help="Try never to exceed 'target_bpp'. Ignored if 'target_bpp' is not "
            "set.")
 
+  # 'compress_batch' subcommand.
+  compress_batch_cmd = subparsers.add_parser(
+      "compress_batch",
+      formatter_class=argparse.ArgumentDefaultsHelpFormatter,
+      description="Reads PNG files, compresses them using the given model, and "
+                  "writes a TFCI file for each, appending '.tfci' to the input "
+                  "filename. The entropy coding of each image overlaps with "
+                  "the transforms of the next one.")
+  compress_batch_cmd.add_argument(
+      "model",
+      help="Unique model identifier. See 'models' command for options.")
+  compress_batch_cmd.add_argument(
+      "input_files", nargs="+",
+      help="Input filenames.")
+  compress_batch_cmd.add_argument(
+      "--num_parallel", type=int, default=2,
+      help="Maximum number of images compressed concurrently.")
+
   # 'decompress' subcommand.
   decompress_cmd = subparsers.add_parser(
       "decompress",
@@ -287,6 +354,8 @@ def main(args):
   if args.command == "compress":
     compress(args.model, args.input_file, args.output_file,
              args.target_bpp, args.bpp_strict)
+  if args.command == "compress_batch":
+    compress_files(args.model, args.input_files, args.num_parallel)
   if args.command == "decompress":
     decompress(args.input_file, args.output_file)
   if args.command == "models":
@@ -0,0 +1,398 @@
+# Copyright 2020 Google LLC. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Benchmarks compression and decompression with the models of tfci.py.
+
+For each combination of model, image size, number of images in flight, thread
+pool sizes, and device, this measures the throughput in images/s and the
+latency percentiles of compressing images to TFCI bitstrings and decompressing
+them again, the same way as tfci.py does. A traced run of each image size also
+splits the time into transforms, CDF construction, and entropy coding.
+
+Example:
+
+  python tfci_benchmark.py bmshj2018-hyperprior-mse-4 hific-lo \
+      --sizes 256x256 768x512 --num_parallel 1 2 4 --intra_op 1 4 0
+
+Invoke 'python tfci.py models' for a list of model identifiers.
+"""
+
+import argparse
+import collections
+from concurrent import futures
+import csv
+import sys
+import time
+
+from absl import app
+from absl.flags import argparse_flags
+import numpy as np
+import tensorflow.compat.v1 as tf
+
+import tensorflow_compression as tfc
+import tfci
+
+# Op types counted as CDF construction in the time split.
+CDF_OPS = frozenset([
+    "PmfToQuantizedCdf",
+    "BatchedPmfToQuantizedCdf",
+    "BatchedPmfToQuantizedCdfWithOverflow",
+    "CdfToDecodeTable",
+    "CreateCdfTable",
+    "CreatePackedCdfTable",
+    "LoadCdfTable",
+])
+
+# Columns of the benchmark results, in the order they are printed.
+COLUMNS = (
+    "model", "command", "device", "size", "num_parallel", "inter_op",
+    "intra_op", "images_per_s", "p50_ms", "p99_ms", "bpp", "transform_ms",
+    "cdf_ms", "coding_ms",
+)
+
+
+def op_category(op_type):
+  """Returns the part of the time split that an op type is counted in."""
+  if op_type in CDF_OPS:
+    return "cdf"
+  if "RangeEncode" in op_type or "RangeDecode" in op_type:
+    return "coding"
+  return "transform"
+
+
+def parse_size(string):
+  """Parses an image size given as '<width>x<height>' into (height, width)."""
+  width, height = (int(s) for s in string.split("x"))
+  if width <= 0 or height <= 0:
+    raise ValueError("Image size should be positive: {}".format(string))
+  return height, width
+
+
+def synthetic_image(height, width, seed):
+  """Returns a smooth random image, which compresses like a natural one.
+
+  Uniform noise would make the entropy coding unrealistically expensive, so
+  the image is upsampled from coarse noise, with some fine noise on top.
+
+  Args:
+    height: Integer. Image height.
+    width: Integer. Image width.
+    seed: Integer. Seed of the random generator.
+
+  Returns:
+    A uint8 array of shape (1, height, width, 3).
+  """
+  rng = np.random.RandomState(seed)
+  coarse = rng.uniform(0, 255, size=(height // 16 + 2, width // 16 + 2, 3))
+  image = np.repeat(np.repeat(coarse, 16, axis=0), 16, axis=1)
+  # Box filter of the upsampled image, so that it has no sharp block edges.
+  image = np.cumsum(np.cumsum(image, axis=0), axis=1)
+  image = (image[16:, 16:] - image[:-16, 16:] - image[16:, :-16] +
+           image[:-16, :-16]) / 256
+  image = image[:height, :width] + rng.normal(0, 4, size=(height, width, 3))
+  return np.clip(np.round(image), 0, 255).astype(np.uint8)[None]
+
+
+def load_image(filename, height, width):
+  """Loads a PNG file, mirrored or cropped to the given size."""
+  with tf.Graph().as_default():
+    with tf.Session() as sess:
+      image = sess.run(tfci.read_png(filename))
+  pad_height = max(height - image.shape[1], 0)
+  pad_width = max(width - image.shape[2], 0)
+  while pad_height or pad_width:
+    # Mirrors the image at most once per call, as np.pad requires.
+    h = min(pad_height, image.shape[1])
+    w = min(pad_width, image.shape[2])
+    image = np.pad(image, [(0, 0), (0, h), (0, w), (0, 0)], mode="symmetric")
+    pad_height -= h
+    pad_width -= w
+  return image[:, :height, :width, :3]
+
+
+def session_config(device, inter_op, intra_op):
+  """Returns the session configuration for a benchmark setting."""
+  config = tf.ConfigProto(
+      inter_op_parallelism_threads=inter_op,
+      intra_op_parallelism_threads=intra_op,
+      allow_soft_placement=True)
+  if device == "cpu":
+    config.device_count["GPU"] = 0
+  return config
+
+
+def run_parallel(run_one, items, num_parallel):
+  """Runs `run_one` on each of `items`, with up to `num_parallel` in flight.
+
+  Args:
+    run_one: Callable taking an item.
+    items: List of items.
+    num_parallel: Integer. Maximum number of items in flight.
+
+  Returns:
+    The wall time in seconds, the latency in seconds of each call, and the
+    results of the calls.
+  """
+  latencies = []
+
+  def timed(item):
+    start = time.perf_counter()
+    result = run_one(item)
+    latencies.append(time.perf_counter() - start)
+    return result
+
+  start = time.perf_counter()
+  with futures.ThreadPoolExecutor(num_parallel) as executor:
+    results = list(executor.map(timed, items))
+  return time.perf_counter() - start, latencies, results
+
+
+def time_split(sess, fetches, feed_dict, op_types):
+  """Splits the op run times of a traced run into the parts of the pipeline.
+
+  The times are sums over ops, which can exceed the wall time when ops run
+  concurrently. On GPU, the kernel times are taken from the 'stream:all'
+  statistics, which adds the launch overhead of the kernels once more.
+
+  Args:
+    sess: The session.
+    fetches: Fetches of the run.
+    feed_dict: Feed dictionary of the run.
+    op_types: Dictionary from op names to op types.
+
+  Returns:
+    Dictionary with the milliseconds spent in each part of the time split.
+  """
+  options = tf.RunOptions(trace_level=tf.RunOptions.FULL_TRACE)
+  metadata = tf.RunMetadata()
+  sess.run(fetches, feed_dict, options=options, run_metadata=metadata)
+  split = collections.Counter(transform=0., cdf=0., coding=0.)
+  for dev_stats in metadata.step_stats.dev_stats:
+    device = dev_stats.device
+    if "/stream:" in device and not device.endswith("/stream:all"):
+      continue
+    for node_stats in dev_stats.node_stats:
+      op_type = op_types.get(node_stats.node_name.split(":")[0])
+      if op_type is None:
+        continue
+      split[op_category(op_type)] += node_stats.all_end_rel_micros / 1000
+  return split
+
+
+def benchmark_model(model, images, args):
+  """Benchmarks compression and decompression with one model.
+
+  Args:
+    model: String. Model identifier.
+    images: Dictionary from image sizes to lists of image arrays.
+    args: Parsed command line arguments.
+
+  Yields:
+    A dictionary with the values of COLUMNS for each benchmark setting.
+  """
+  with tf.Graph().as_default() as graph:
+    if args.sync_coding:
+      signature_defs = tfci.import_metagraph(model)
+    else:
+      with tfc.async_range_coding(graph):
+        signature_defs = tfci.import_metagraph(model)
+    sender_inputs, sender_outputs = tfci.instantiate_signature(
+        signature_defs["sender"])
+    receiver_inputs, receiver_outputs = tfci.instantiate_signature(
+        signature_defs["receiver"])
+  op_types = {op.name: op.type for op in graph.get_operations()}
+
+  # Same tensors as in tfci.compress_images() and tfci.decompress().
+  input_image = sender_inputs["input_image"]
+  channels = [sender_outputs[k] for k in sorted(sender_outputs)
+              if k.startswith("channel:")]
+  channel_inputs = [receiver_inputs[k] for k in sorted(receiver_inputs)
+                    if k.startswith("channel:")]
+  output_image = receiver_outputs["output_image"]
+
+  for device in args.devices:
+    if device == "gpu" and not tf.config.list_physical_devices("GPU"):
+      print("No GPU available, skipping device 'gpu'.", file=sys.stderr)
+      continue
+    for inter_op in args.inter_op:
+      for intra_op in args.intra_op:
+        config = session_config(device, inter_op, intra_op)
+        with tf.Session(graph=graph, config=config) as sess:
+
+          def compress_one(image):
+            arrays = sess.run(channels, feed_dict={input_image: image})
+            packed = tfc.PackedTensors()
+            packed.model = model
+            packed.pack(channels, arrays)
+            return packed.string
+
+          def decompress_one(bitstring):
+            arrays = tfc.PackedTensors(bitstring).unpack(channel_inputs)
+            return sess.run(
+                output_image, feed_dict=dict(zip(channel_inputs, arrays)))
+
+          for size in args.sizes:
+            sized_images = images[size]
+            num_pixels = size[0] * size[1]
+            # Warm up the session, and compute the inputs of decompression.
+            for _ in range(args.num_warmup):
+              bitstrings = [compress_one(image) for image in sized_images]
+              decompress_one(bitstrings[0])
+            bpp = 8 * np.mean([len(b) for b in bitstrings]) / num_pixels
+
+            compress_split = time_split(
+                sess, channels, {input_image: sized_images[0]}, op_types)
+            arrays = tfc.PackedTensors(bitstrings[0]).unpack(channel_inputs)
+            decompress_split = time_split(
+                sess, output_image, dict(zip(channel_inputs, arrays)),
+                op_types)
+
+            for num_parallel in args.num_parallel:
+              for command, run_one, items, split in (
+                  ("compress", compress_one, sized_images, compress_split),
+                  ("decompress", decompress_one, bitstrings,
+                   decompress_split)):
+                wall_time, latencies, _ = run_parallel(
+                    run_one, items, num_parallel)
+                p50, p99 = np.percentile(latencies, [50, 99]) * 1000
+                yield dict(
+                    model=model,
+                    command=command,
+                    device=device,
+                    size="{}x{}".format(size[1], size[0]),
+                    num_parallel=num_parallel,
+                    inter_op=inter_op,
+                    intra_op=intra_op,
+                    images_per_s=len(items) / wall_time,
+                    p50_ms=p50,
+                    p99_ms=p99,
+                    bpp=bpp,
+                    transform_ms=split["transform"],
+                    cdf_ms=split["cdf"],
+                    coding_ms=split["coding"],
+                )
+
+
+def format_row(row):
+  """Formats the values of a row of results for printing."""
+  return [
+      "{:.3f}".format(row[c]) if isinstance(row[c], float) else str(row[c])
+      for c in COLUMNS
+  ]
+
+
+def benchmark(args):
+  """Runs the benchmarks and prints the results."""
+  images = {}
+  for height, width in args.sizes:
+    if args.input_file:
+      image = load_image(args.input_file, height, width)
+      images[height, width] = args.num_images * [image]
+    else:
+      images[height, width] = [
+          synthetic_image(height, width, seed=i)
+          for i in range(args.num_images)
+      ]
+
+  writer = None
+  output = None
+  if args.output_file:
+    output = tf.io.gfile.GFile(args.output_file, "w")
+    writer = csv.DictWriter(output, fieldnames=COLUMNS)
+    writer.writeheader()
+  print("\t".join(COLUMNS))
+  try:
+    for model in args.models:
+      for row in benchmark_model(model, images, args):
+        print("\t".join(format_row(row)))
+        sys.stdout.flush()
+        if writer:
+          writer.writerow(row)
+  finally:
+    if output:
+      output.close()
+
+
+def parse_args(argv):
+  """Parses command line arguments."""
+  parser = argparse_flags.ArgumentParser(
+      formatter_class=argparse.ArgumentDefaultsHelpFormatter,
+      description="Measures the throughput and latency of compressing and "
+                  "decompressing images with the pre-trained models of "
+                  "tfci.py, over all combinations of the given settings.")
+  parser.add_argument(
+      "models", nargs="+",
+      help="Unique model identifiers. See 'tfci.py models' for options.")
+  parser.add_argument(
+      "--url_prefix",
+      default=tfci.URL_PREFIX,
+      help="URL prefix for downloading model metagraphs.")
+  parser.add_argument(
+      "--metagraph_cache",
+      default=tfci.METAGRAPH_CACHE,
+      help="Directory where to cache model metagraphs.")
+  parser.add_argument(
+      "--input_file",
+      help="PNG file to compress, mirrored or cropped to each size. If not "
+           "provided, synthetic images are compressed.")
+  parser.add_argument(
+      "--sizes", nargs="+", default=["768x512"],
+      help="Image sizes, given as '<width>x<height>'.")
+  parser.add_argument(
+      "--num_parallel", type=int, nargs="+", default=[1, 2, 4],
+      help="Maximum numbers of images in flight. Each image is run through "
+           "the session separately, as with 'tfci.py compress_batch'.")
+  parser.add_argument(
+      "--inter_op", type=int, nargs="+", default=[0],
+      help="Sizes of the inter-op thread pool. 0 lets TensorFlow choose.")
+  parser.add_argument(
+      "--intra_op", type=int, nargs="+", default=[0],
+      help="Sizes of the intra-op thread pool, which also runs the range "
+           "coding. 0 lets TensorFlow choose.")
+  parser.add_argument(
+      "--devices", nargs="+", default=["cpu"], choices=["cpu", "gpu"],
+      help="Devices to place the transforms on. The range coding always runs "
+           "on the host.")
+  parser.add_argument(
+      "--num_images", type=int, default=16,
+      help="Number of images per measurement.")
+  parser.add_argument(
+      "--num_warmup", type=int, default=1,
+      help="Number of passes over the images before measuring.")
+  parser.add_argument(
+      "--sync_coding", action="store_true",
+      help="Use the synchronous range coding kernels, instead of the async "
+           "kernels used by tfci.py.")
+  parser.add_argument(
+      "--output_file",
+      help="CSV file to write the results to (optional).")
+  args = parser.parse_args(argv[1:])
+  try:
+    args.sizes = [parse_size(size) for size in args.sizes]
+  except ValueError:
+    parser.error("'sizes' should be given as '<width>x<height>'.")
+  if args.num_warmup < 1:
+    parser.error("'num_warmup' should be at least 1.")
+  return args
+
+
+def main(args):
+  # Command line can override these defaults.
+  tfci.URL_PREFIX = args.url_prefix
+  tfci.METAGRAPH_CACHE = args.metagraph_cache
+  benchmark(args)
+
+
+if __name__ == "__main__":
+  app.run(main, flags_parser=parse_args)
@@ -0,0 +1,272 @@
+/* Copyright 2020 Google LLC. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_compression/cc/kernels/range_coder.h"
+#include "tensorflow_compression/cc/kernels/range_coding_metrics.h"
+
+namespace tensorflow_compression {
+namespace {
+namespace errors = tensorflow::errors;
+using tensorflow::DEVICE_CPU;
+using tensorflow::int32;
+using tensorflow::int64;
+using tensorflow::OpKernel;
+using tensorflow::OpKernelConstruction;
+using tensorflow::OpKernelContext;
+using tensorflow::Tensor;
+using tensorflow::TensorShape;
+using tensorflow::TensorShapeUtils;
+using tensorflow::tstring;
+
+// CDFs over `num_symbols` symbols for each of `num_contexts` contexts, which
+// adapt to the symbols coded with them. All CDFs start out uniform. After a
+// symbol is coded, the probability mass of the CDF is moved towards it by
+// 2^-adaptation_rate of the distance to the distribution that puts all mass on
+// the symbol.
+//
+// Each symbol keeps a probability of at least 2^-precision, so that any symbol
+// can still be coded. To guarantee this, the CDF stored for each context is
+// cdf[i] = i + m[i], where m is a CDF with total mass 2^precision - num_symbols
+// that is updated as described above. The updates preserve the monotonicity of
+// m, because both the old m and the target distribution are monotonic, and the
+// update is monotonic in m even with the rounding.
+class AdaptiveModel {
+ public:
+  // REQUIRES: 0 < precision <= 16.
+  // REQUIRES: 1 < num_symbols < 2^precision.
+  // REQUIRES: num_contexts > 0 and adaptation_rate > 0.
+  AdaptiveModel(int num_contexts, int num_symbols, int precision,
+                int adaptation_rate)
+      : num_symbols_(num_symbols),
+        max_mass_((1 << precision) - num_symbols),
+        adaptation_rate_(adaptation_rate),
+        cdf_(static_cast<int64>(num_contexts) * (num_symbols + 1)) {
+    for (int64 c = 0; c < num_contexts; ++c) {
+      int32* cdf = &cdf_[c * (num_symbols_ + 1)];
+      for (int32 i = 0; i <= num_symbols_; ++i) {
+        cdf[i] = i + static_cast<int64>(max_mass_) * i / num_symbols_;
+      }
+    }
+  }
+
+  // Returns the current CDF of `context`, with num_symbols + 1 elements.
+  absl::Span<const int32> cdf(int32 context) const {
+    return absl::MakeConstSpan(
+        &cdf_[static_cast<int64>(context) * (num_symbols_ + 1)],
+        num_symbols_ + 1);
+  }
+
+  // Adapts the CDF of `context` after `symbol` was coded with it.
+  void Update(int32 context, int32 symbol) {
+    int32* cdf = &cdf_[static_cast<int64>(context) * (num_symbols_ + 1)];
+    // cdf[0] and cdf[num_symbols] do not change.
+    for (int32 i = 1; i < num_symbols_; ++i) {
+      int32 mass = cdf[i] - i;
+      if (i <= symbol) {
+        mass -= mass >> adaptation_rate_;
+      } else {
+        mass += (max_mass_ - mass) >> adaptation_rate_;
+      }
+      cdf[i] = i + mass;
+    }
+  }
+
+ private:
+  const int32 num_symbols_;
+  const int32 max_mass_;
+  const int adaptation_rate_;
+  std::vector<int32> cdf_;
+};
+
+tensorflow::Status CheckContext(int num_contexts, const Tensor& context) {
+  auto flat = context.flat<int32>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    if (flat(i) < 0 || num_contexts <= flat(i)) {
+      return errors::InvalidArgument("'context' has a value not in [0, ",
+                                     num_contexts, "): value=", flat(i));
+    }
+  }
+  return tensorflow::Status::OK();
+}
+
+// Reads and checks the attributes shared by the adaptive coding ops.
+class AdaptiveRangeCodingOpBase : public OpKernel {
+ public:
+  explicit AdaptiveRangeCodingOpBase(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("precision", &precision_));
+    OP_REQUIRES(context, 0 < precision_ && precision_ <= 16,
+                errors::InvalidArgument("`precision` must be in [1, 16]: ",
+                                        precision_));
+    OP_REQUIRES_OK(context, context->GetAttr("num_symbols", &num_symbols_));
+    OP_REQUIRES(
+        context, 1 < num_symbols_ && num_symbols_ < (1 << precision_),
+        errors::InvalidArgument("`num_symbols` must be in [2, 2^precision): ",
+                                num_symbols_));
+    OP_REQUIRES_OK(context, context->GetAttr("num_contexts", &num_contexts_));
+    OP_REQUIRES(context, num_contexts_ > 0,
+                errors::InvalidArgument("`num_contexts` must be positive: ",
+                                        num_contexts_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("adaptation_rate", &adaptation_rate_));
+    OP_REQUIRES(
+        context, 0 < adaptation_rate_ && adaptation_rate_ <= 16,
+        errors::InvalidArgument("`adaptation_rate` must be in [1, 16]: ",
+                                adaptation_rate_));
+    OP_REQUIRES_OK(context, context->GetAttr("debug_level", &debug_level_));
+    OP_REQUIRES(context, debug_level_ == 0 || debug_level_ == 1,
+                errors::InvalidArgument("`debug_level` must be 0 or 1: ",
+                                        debug_level_));
+  }
+
+ protected:
+  AdaptiveModel MakeModel() const {
+    return AdaptiveModel(num_contexts_, num_symbols_, precision_,
+                         adaptation_rate_);
+  }
+
+  int precision_;
+  int num_symbols_;
+  int num_contexts_;
+  int adaptation_rate_;
+  int debug_level_;
+};
+
+class AdaptiveRangeEncodeOp : public AdaptiveRangeCodingOpBase {
+ public:
+  explicit AdaptiveRangeEncodeOp(OpKernelConstruction* context)
+      : AdaptiveRangeCodingOpBase(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& data = context->input(0);
+    const Tensor& context_tensor = context->input(1);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    OP_REQUIRES(
+        context, data.shape() == context_tensor.shape(),
+        errors::InvalidArgument(
+            "`data` and `context` should have the same shape: data.shape=",
+            data.shape(), ", context.shape=", context_tensor.shape()));
+    auto data_flat = data.flat<int32>();
+    auto context_flat = context_tensor.flat<int32>();
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckContext(num_contexts_, context_tensor));
+      for (int64 i = 0; i < data_flat.size(); ++i) {
+        OP_REQUIRES(context, 0 <= data_flat(i) && data_flat(i) < num_symbols_,
+                    errors::InvalidArgument("'data' value not in [0, ",
+                                            num_symbols_,
+                                            "): value=", data_flat(i)));
+      }
+    }
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
+    Tensor* output;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape{}, &output));
+    tstring* encoded = &output->scalar<tstring>()();
+
+    AdaptiveModel model = MakeModel();
+    RangeEncoder encoder;
+    for (int64 i = 0; i < data_flat.size(); ++i) {
+      const int32 value = data_flat(i);
+      const int32 cdf_index = context_flat(i);
+      DCHECK_GE(value, 0);
+      DCHECK_LT(value, num_symbols_);
+      DCHECK_GE(cdf_index, 0);
+      DCHECK_LT(cdf_index, num_contexts_);
+
+      const absl::Span<const int32> cdf = model.cdf(cdf_index);
+      encoder.Encode(cdf[value], cdf[value + 1], precision_, encoded);
+      model.Update(cdf_index, value);
+    }
+    encoder.Finalize(encoded);
+
+    metrics.AddSymbols(data_flat.size());
+    metrics.AddBytes(encoded->size());
+    metrics.AddCarries(encoder.num_carries());
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("AdaptiveRangeEncode").Device(DEVICE_CPU),
+                        AdaptiveRangeEncodeOp);
+
+class AdaptiveRangeDecodeOp : public AdaptiveRangeCodingOpBase {
+ public:
+  explicit AdaptiveRangeDecodeOp(OpKernelConstruction* context)
+      : AdaptiveRangeCodingOpBase(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& encoded_tensor = context->input(0);
+    const Tensor& context_tensor = context->input(1);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(encoded_tensor.shape()),
+                errors::InvalidArgument("Invalid `encoded` shape: ",
+                                        encoded_tensor.shape()));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckContext(num_contexts_, context_tensor));
+    }
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
+    Tensor* output;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, context_tensor.shape(), &output));
+
+    const tstring& encoded = encoded_tensor.scalar<tstring>()();
+    auto context_flat = context_tensor.flat<int32>();
+    auto output_flat = output->flat<int32>();
+
+    AdaptiveModel model = MakeModel();
+    RangeDecoder decoder(encoded);
+    for (int64 i = 0; i < output_flat.size(); ++i) {
+      const int32 cdf_index = context_flat(i);
+      DCHECK_GE(cdf_index, 0);
+      DCHECK_LT(cdf_index, num_contexts_);
+
+      const int32 value = decoder.Decode(model.cdf(cdf_index), precision_);
+      model.Update(cdf_index, value);
+      output_flat(i) = value;
+    }
+    OP_REQUIRES(context, !decoder.corrupted(),
+                errors::InvalidArgument("`encoded` is corrupt"));
+
+    metrics.AddSymbols(output_flat.size());
+    metrics.AddBytes(encoded.size());
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("AdaptiveRangeDecode").Device(DEVICE_CPU),
+                        AdaptiveRangeDecodeOp);
+
+}  // namespace
+}  // namespace tensorflow_compression
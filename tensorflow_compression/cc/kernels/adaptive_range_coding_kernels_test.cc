@@ -0,0 +1,181 @@
+/* Copyright 2020 Google LLC. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.proto.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.proto.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/stacktrace_handler.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow_compression {
+namespace {
+using tensorflow::DT_INT32;
+using tensorflow::DT_STRING;
+using tensorflow::int32;
+using tensorflow::int64;
+using tensorflow::NodeDefBuilder;
+using tensorflow::OpsTestBase;
+using tensorflow::Status;
+using tensorflow::Tensor;
+using tensorflow::tstring;
+
+class AdaptiveRangeCodingOpTest : public OpsTestBase {
+ protected:
+  Status RunEncode(int num_symbols, int num_contexts, int precision,
+                   int adaptation_rate, const Tensor& data,
+                   const Tensor& context, Tensor* encoded) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("encode", "AdaptiveRangeEncode")
+                           .Input(tensorflow::FakeInput(DT_INT32))
+                           .Input(tensorflow::FakeInput(DT_INT32))
+                           .Attr("num_symbols", num_symbols)
+                           .Attr("num_contexts", num_contexts)
+                           .Attr("precision", precision)
+                           .Attr("adaptation_rate", adaptation_rate)
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+
+    inputs_.clear();
+    std::vector<Tensor> copies{data, context};
+    for (auto& copy : copies) {
+      inputs_.emplace_back(&copy);
+    }
+    TF_RETURN_IF_ERROR(RunOpKernel());
+    *encoded = *GetOutput(0);
+    inputs_.clear();
+    return Status::OK();
+  }
+
+  Status RunDecode(int num_symbols, int num_contexts, int precision,
+                   int adaptation_rate, const Tensor& encoded,
+                   const Tensor& context, Tensor* decoded) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("decode", "AdaptiveRangeDecode")
+                           .Input(tensorflow::FakeInput(DT_STRING))
+                           .Input(tensorflow::FakeInput(DT_INT32))
+                           .Attr("num_symbols", num_symbols)
+                           .Attr("num_contexts", num_contexts)
+                           .Attr("precision", precision)
+                           .Attr("adaptation_rate", adaptation_rate)
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+
+    inputs_.clear();
+    std::vector<Tensor> copies{encoded, context};
+    for (auto& copy : copies) {
+      inputs_.emplace_back(&copy);
+    }
+    TF_RETURN_IF_ERROR(RunOpKernel());
+    *decoded = *GetOutput(0);
+    inputs_.clear();
+    return Status::OK();
+  }
+};
+
+TEST_F(AdaptiveRangeCodingOpTest, RoundTrip) {
+  std::mt19937 gen(12345);
+  std::geometric_distribution<int32> distribution(0.3);
+
+  for (int precision : {8, 12, 16}) {
+    for (int adaptation_rate : {1, 4, 16}) {
+      for (int num_symbols : {2, 7, 40}) {
+        Tensor data(DT_INT32, {10, 30});
+        Tensor context(DT_INT32, {10, 30});
+        auto data_flat = data.flat<int32>();
+        auto context_flat = context.flat<int32>();
+        for (int64 i = 0; i < data_flat.size(); ++i) {
+          // The contexts have different distributions.
+          context_flat(i) = gen() % 3;
+          data_flat(i) = std::min(num_symbols - 1,
+                                  distribution(gen) + context_flat(i));
+        }
+
+        Tensor encoded;
+        TF_ASSERT_OK(RunEncode(num_symbols, 3, precision, adaptation_rate,
+                               data, context, &encoded));
+        EXPECT_EQ(encoded.dims(), 0);
+
+        Tensor decoded;
+        TF_ASSERT_OK(RunDecode(num_symbols, 3, precision, adaptation_rate,
+                               encoded, context, &decoded));
+        tensorflow::test::ExpectTensorEqual<int32>(data, decoded);
+      }
+    }
+  }
+}
+
+TEST_F(AdaptiveRangeCodingOpTest, Adapts) {
+  std::mt19937 gen(12345);
+  constexpr int kSize = 2000;
+  Tensor skewed(DT_INT32, {kSize});
+  Tensor uniform(DT_INT32, {kSize});
+  Tensor context(DT_INT32, {kSize});
+  for (int64 i = 0; i < kSize; ++i) {
+    skewed.flat<int32>()(i) = (gen() % 10 == 0) ? gen() % 16 : 3;
+    uniform.flat<int32>()(i) = gen() % 16;
+    context.flat<int32>()(i) = 0;
+  }
+
+  Tensor skewed_encoded;
+  TF_ASSERT_OK(RunEncode(16, 1, 15, 5, skewed, context, &skewed_encoded));
+  Tensor uniform_encoded;
+  TF_ASSERT_OK(RunEncode(16, 1, 15, 5, uniform, context, &uniform_encoded));
+
+  // Uniform data costs 4 bits per value, plus a small adaptation overhead.
+  const int64 skewed_size = skewed_encoded.scalar<tstring>()().size();
+  const int64 uniform_size = uniform_encoded.scalar<tstring>()().size();
+  EXPECT_LT(uniform_size, kSize / 2 * 11 / 10);
+  EXPECT_LT(3 * skewed_size, uniform_size);
+}
+
+TEST_F(AdaptiveRangeCodingOpTest, InvalidInputs) {
+  Tensor data(DT_INT32, {2});
+  Tensor context(DT_INT32, {2});
+  Tensor encoded;
+
+  data.flat<int32>().setValues({0, 4});
+  context.flat<int32>().setValues({0, 1});
+  EXPECT_FALSE(RunEncode(4, 2, 8, 4, data, context, &encoded).ok());
+
+  data.flat<int32>().setValues({0, 3});
+  context.flat<int32>().setValues({0, 2});
+  EXPECT_FALSE(RunEncode(4, 2, 8, 4, data, context, &encoded).ok());
+
+  context.flat<int32>().setValues({0, 1});
+  EXPECT_FALSE(RunEncode(4, 2, 8, 4, data, Tensor(DT_INT32, {3}), &encoded)
+                   .ok());
+
+  // `num_symbols` or `adaptation_rate` out of range.
+  EXPECT_FALSE(RunEncode(256, 2, 8, 4, data, context, &encoded).ok());
+  EXPECT_FALSE(RunEncode(4, 2, 8, 17, data, context, &encoded).ok());
+
+  TF_EXPECT_OK(RunEncode(4, 2, 8, 4, data, context, &encoded));
+}
+
+}  // namespace
+}  // namespace tensorflow_compression
+
+GTEST_API_ int main(int argc, char** argv) {
+  tensorflow::testing::InstallStacktraceHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,124 @@
+/* Copyright 2020 Google LLC. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPRESSION_CC_KERNELS_CDF_TABLE_H_
+#define TENSORFLOW_COMPRESSION_CC_KERNELS_CDF_TABLE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_compression/cc/kernels/range_coding_kernels_util.h"
+
+namespace tensorflow_compression {
+
+// A set of CDFs for the unbounded index range coding ops, created by
+// CreateCdfTable or CreatePackedCdfTable op, or loaded from a file by
+// LoadCdfTable op. The CDFs are validated once when the table is created, and
+// are stored together with their decode tables, so that the coding ops can use
+// them without checking or converting them on every call. The tensors of a
+// loaded table refer to the memory-mapped file.
+//
+// The CDFs are stored as ragged rows of 16-bit values: the i-th CDF is
+// cdf_values[cdf_row_splits[i]:cdf_row_splits[i + 1]], without its last
+// element, which is always 2^precision. This keeps the table small regardless
+// of the padding of the `cdf` argument of the other ops, and lets precision 16
+// CDFs fit in 16 bits.
+class CdfTable : public tensorflow::ResourceBase {
+ public:
+  // REQUIRES: `cdf_values` (DT_UINT16) and `cdf_row_splits` (DT_INT32) hold
+  // valid CDFs in the packed format for `precision`, and `offset` has one
+  // element per CDF.
+  // REQUIRES: `decode_table` is the output of CdfToDecodeTable op for the CDFs
+  // and `precision`, with 2^table_bits entries per CDF.
+  // REQUIRES: `entropy` holds the entropy of each CDF, see CdfEntropy().
+  //
+  // `inputs` are the tensors the table was created from, see IsCreatedFrom().
+  CdfTable(int precision, const tensorflow::Tensor& cdf_values,
+           const tensorflow::Tensor& cdf_row_splits,
+           const tensorflow::Tensor& offset,
+           const tensorflow::Tensor& decode_table, int table_bits,
+           std::vector<float> entropy, std::vector<tensorflow::Tensor> inputs)
+      : precision_(precision),
+        cdf_values_(cdf_values),
+        cdf_row_splits_(cdf_row_splits),
+        offset_(offset),
+        decode_table_(decode_table),
+        table_bits_(table_bits),
+        entropy_(std::move(entropy)),
+        inputs_(std::move(inputs)) {}
+
+  int precision() const { return precision_; }
+  tensorflow::int64 num_cdfs() const { return offset_.NumElements(); }
+  const tensorflow::Tensor& cdf_values() const { return cdf_values_; }
+  const tensorflow::Tensor& cdf_row_splits() const { return cdf_row_splits_; }
+  const tensorflow::Tensor& offset() const { return offset_; }
+
+  absl::Span<const float> entropy() const { return entropy_; }
+
+  DecodeTable decode_table() const {
+    DecodeTable table;
+    table.data = decode_table_.flat<tensorflow::int16>().data();
+    table.bits = table_bits_;
+    return table;
+  }
+
+  // Returns true if this table was created from the same tensor buffers. The
+  // table holds references to the buffers, so they cannot have been reused
+  // for other tensors in the meantime.
+  bool IsCreatedFrom(absl::Span<const tensorflow::Tensor> inputs) const {
+    if (inputs.size() != inputs_.size()) return false;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      if (!inputs[i].SharesBufferWith(inputs_[i]) ||
+          inputs[i].shape() != inputs_[i].shape()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::string DebugString() const override {
+    return absl::StrCat("CdfTable(precision=", precision_,
+                        ", num_cdfs=", num_cdfs(),
+                        ", num_values=", cdf_values_.NumElements(), ")");
+  }
+
+  // The inputs are not counted. They are usually variables that are kept
+  // alive by the model anyway, and the coding ops do not read them.
+  tensorflow::int64 MemoryUsed() const override {
+    return cdf_values_.TotalBytes() + cdf_row_splits_.TotalBytes() +
+           offset_.TotalBytes() + decode_table_.TotalBytes() +
+           entropy_.size() * sizeof(float);
+  }
+
+ private:
+  const int precision_;
+  const tensorflow::Tensor cdf_values_;
+  const tensorflow::Tensor cdf_row_splits_;
+  const tensorflow::Tensor offset_;
+  const tensorflow::Tensor decode_table_;
+  const int table_bits_;
+  const std::vector<float> entropy_;
+  const std::vector<tensorflow::Tensor> inputs_;
+};
+
+}  // namespace tensorflow_compression
+
+#endif  // TENSORFLOW_COMPRESSION_CC_KERNELS_CDF_TABLE_H_
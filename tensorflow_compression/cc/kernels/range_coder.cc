@@ -21,22 +21,49 @@ limitations under the License.
 //
 #include "tensorflow_compression/cc/kernels/range_coder.h"
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include <string>
 
 #include "absl/types/span.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow_compression {
+using tensorflow::int16;
 using tensorflow::int32;
 using tensorflow::tstring;
+using tensorflow::uint16;
 using tensorflow::uint32;
 using tensorflow::uint64;
 using tensorflow::uint8;
 
-void RangeEncoder::Encode(int32 lower, int32 upper, int precision,
-                          tstring* sink) {
+PresizedSink::PresizedSink(tstring* output, size_t size_hint)
+    : output_(output) {
+  const size_t size = output_->size();
+  output_->resize_uninitialized(size + size_hint);
+  current_ = output_->mdata() + size;
+  end_ = output_->mdata() + output_->size();
+}
+
+void PresizedSink::Grow(size_t count) {
+  const size_t size = current_ - output_->mdata();
+  output_->resize_uninitialized(
+      std::max({2 * output_->size(), size + count, static_cast<size_t>(16)}));
+  current_ = output_->mdata() + size;
+  end_ = output_->mdata() + output_->size();
+}
+
+void PresizedSink::Finish() {
+  output_->resize_uninitialized(current_ - output_->mdata());
+  current_ = end_ = output_->mdata() + output_->size();
+}
+
+template <typename Precision, typename Sink>
+void RangeEncoder::Encode(int32 lower, int32 upper, Precision precision,
+                          Sink* sink) {
   // Input requirement: 0 < precision < 16.
   DCHECK_GT(precision, 0);
   DCHECK_LE(precision, 16);
@@ -80,6 +107,32 @@ void RangeEncoder::Encode(int32 lower, int32 upper, int precision,
   // For lower bound of b, note that 1 <= v, 2^16 <= size, and 16 <= precision.
   // Therefore (size * v) / 2^precision - 1 >= 2^16 / 2^precision - 1 >= 0.
 
+  Narrow(a, b, sink);
+}
+
+template <typename Precision, typename Sink>
+void RangeEncoder::EncodeUniform(int32 value, Precision precision,
+                                 Sink* sink) {
+  DCHECK_GT(precision, 0);
+  DCHECK_LE(precision, 16);
+  DCHECK_LE(0, value);
+  DCHECK_LT(value, 1 << precision);
+
+  // Same as Encode(value, value + 1, precision, sink). The interval bounds
+  // are computed in the same way, so that the output does not depend on which
+  // function was used.
+  const uint64 size = static_cast<uint64>(size_minus1_) + 1;
+  const uint64 lower = size * static_cast<uint64>(value);
+  const uint32 a = lower >> precision;
+  const uint32 b = ((lower + size) >> precision) - 1;
+  DCHECK_LE(a, b);
+  Narrow(a, b, sink);
+}
+
+template <typename Sink>
+inline void RangeEncoder::Narrow(uint32 a, uint32 b, Sink* sink) {
+  const uint64 size = static_cast<uint64>(size_minus1_) + 1;
+
   // The new interval is [base + a, base + b] = [base + a, base + b + 1).
   base_ += a;  // May overflow.
   size_minus1_ = b - a;
@@ -261,11 +314,13 @@ void RangeEncoder::Encode(int32 lower, int32 upper, int precision,
       // New state is 1.
       DCHECK_LT(top, 0xFFFF);
       delay_ = top + 1;
+      ++num_carries_;
     }
   }
 }
 
-void RangeEncoder::Finalize(tstring* sink) {
+template <typename Sink>
+void RangeEncoder::Finalize(Sink* sink) {
   // Finalize the encode by writing out any number in the interval
   // [base, base + size).
   //
@@ -300,13 +355,45 @@ void RangeEncoder::Finalize(tstring* sink) {
   delay_ = 0;
 }
 
+#define INSTANTIATE_RANGE_ENCODER(Precision, Sink)                    \
+  template void RangeEncoder::Encode(int32, int32, Precision, Sink*); \
+  template void RangeEncoder::EncodeUniform(int32, Precision, Sink*);
+#define INSTANTIATE_RANGE_ENCODER_PRECISIONS(Sink)     \
+  INSTANTIATE_RANGE_ENCODER(int, Sink)                 \
+  INSTANTIATE_RANGE_ENCODER(StaticPrecision<12>, Sink) \
+  INSTANTIATE_RANGE_ENCODER(StaticPrecision<14>, Sink) \
+  INSTANTIATE_RANGE_ENCODER(StaticPrecision<15>, Sink) \
+  INSTANTIATE_RANGE_ENCODER(StaticPrecision<16>, Sink) \
+  template void RangeEncoder::Finalize(Sink*);
+INSTANTIATE_RANGE_ENCODER_PRECISIONS(tstring)
+INSTANTIATE_RANGE_ENCODER_PRECISIONS(PresizedSink)
+#undef INSTANTIATE_RANGE_ENCODER_PRECISIONS
+#undef INSTANTIATE_RANGE_ENCODER
+
 RangeDecoder::RangeDecoder(const tstring& source)
-    : current_(source.begin()), end_(source.end()) {
+    : RangeDecoder(source.data(), source.data() + source.size()) {}
+
+RangeDecoder::RangeDecoder(const char* begin, const char* end)
+    : current_(begin), end_(end) {
   Read16BitValue();
   Read16BitValue();
 }
 
-int32 RangeDecoder::Decode(absl::Span<const int32> cdf, int precision) {
+inline void RangeDecoder::Narrow(uint32 a, uint32 b) {
+  base_ += a;
+  size_minus1_ = b - a;
+
+  if (size_minus1_ >> 16 == 0) {
+    base_ <<= 16;
+    size_minus1_ <<= 16;
+    size_minus1_ |= 0xFFFF;
+
+    Read16BitValue();
+  }
+}
+
+template <typename Precision>
+int32 RangeDecoder::Decode(absl::Span<const int32> cdf, Precision precision) {
   // Input requirement: 0 < precision < 16.
   DCHECK_GT(precision, 0);
   DCHECK_LE(precision, 16);
@@ -340,31 +427,135 @@ int32 RangeDecoder::Decode(absl::Span<const int32> cdf, int precision) {
   } while (len > 0);
 
   // If (size * v) / 2^precision <= offset for all v in cdf, then pv points to
-  // one after the last element of cdf. That is a decoding error.
-  //
-  // TODO(ssjhv): Consider returning -1 to indicate error. Or start len =
-  // cdf.size() - 2 instead and give up detecting this error.
-  CHECK_LT(pv, cdf.data() + cdf.size());
+  // one after the last element of cdf. That is a decoding error. It is
+  // recorded in `corrupted_`, and the last character is decoded instead, so
+  // that the caller can check for errors once at the end.
+  if (TF_PREDICT_FALSE(pv == cdf.data() + cdf.size())) {
+    corrupted_ = true;
+    --pv;
+  }
 
   const uint32 a = (size * static_cast<uint64>(*(pv - 1))) >> precision;
   const uint32 b = ((size * static_cast<uint64>(*pv)) >> precision) - 1;
-  DCHECK_LE(a, offset >> precision);
-  DCHECK_LE(offset >> precision, b);
+  DCHECK(corrupted_ || a <= offset >> precision);
+  DCHECK(corrupted_ || offset >> precision <= b);
 
-  base_ += a;
-  size_minus1_ = b - a;
+  Narrow(a, b);
 
-  if (size_minus1_ >> 16 == 0) {
-    base_ <<= 16;
-    size_minus1_ <<= 16;
-    size_minus1_ |= 0xFFFF;
+  return pv - cdf.data() - 1;
+}
 
-    Read16BitValue();
+template <typename Precision>
+int32 RangeDecoder::Decode(absl::Span<const int32> cdf,
+                           absl::Span<const int16> table, int table_bits,
+                           Precision precision) {
+  DCHECK_GE(cdf.size(), 2);
+  return DecodeWithTable(cdf.data(), cdf.size() - 2, cdf[cdf.size() - 1],
+                         table, table_bits, precision);
+}
+
+template <typename Precision>
+int32 RangeDecoder::Decode(absl::Span<const uint16> cdf,
+                           absl::Span<const int16> table, int table_bits,
+                           Precision precision) {
+  DCHECK_GE(cdf.size(), 1);
+  return DecodeWithTable(cdf.data(), cdf.size() - 1,
+                         static_cast<uint32>(1) << precision, table,
+                         table_bits, precision);
+}
+
+template <typename T, typename Precision>
+int32 RangeDecoder::DecodeWithTable(const T* cdf, int32 max_index,
+                                    uint32 last, absl::Span<const int16> table,
+                                    int table_bits, Precision precision) {
+  DCHECK_GT(precision, 0);
+  DCHECK_LE(precision, 16);
+  DCHECK_LE(table_bits, precision);
+  DCHECK_EQ(table.size(), 1 << table_bits);
+
+  const uint64 size = static_cast<uint64>(size_minus1_) + 1;
+  const uint64 offset =
+      ((static_cast<uint64>(value_ - base_) + 1) << precision) - 1;
+
+  // The binary search in the other Decode() looks for the smallest v in cdf
+  // that satisfies offset < (size * v) / 2^precision, which is equivalent to
+  // target < v. Because value_ - base_ <= size_minus1_ holds for a valid
+  // bitstream, target is less than 2^precision. Otherwise it is clamped, so
+  // that the table lookup stays in bounds.
+  uint32 target = offset / size;
+  if (TF_PREDICT_FALSE(target >> precision != 0)) {
+    corrupted_ = true;
+    target = (static_cast<uint32>(1) << precision) - 1;
   }
 
-  return pv - cdf.data() - 1;
+  DCHECK_GE(max_index, 0);
+  int32 index =
+      std::min<int32>(table[target >> (precision - table_bits)], max_index);
+  DCHECK_LE(static_cast<uint32>(cdf[index]), target);
+  while (index < max_index && static_cast<uint32>(cdf[index + 1]) <= target) {
+    ++index;
+  }
+  const uint32 upper =
+      index < max_index ? static_cast<uint32>(cdf[index + 1]) : last;
+  // See the comment in the other Decode().
+  if (TF_PREDICT_FALSE(target >= upper)) {
+    corrupted_ = true;
+  }
+
+  const uint32 a = (size * static_cast<uint64>(cdf[index])) >> precision;
+  const uint32 b = ((size * static_cast<uint64>(upper)) >> precision) - 1;
+  DCHECK(corrupted_ || a <= offset >> precision);
+  DCHECK(corrupted_ || offset >> precision <= b);
+
+  Narrow(a, b);
+
+  return index;
 }
 
+template <typename Precision>
+int32 RangeDecoder::DecodeUniform(Precision precision) {
+  DCHECK_GT(precision, 0);
+  DCHECK_LE(precision, 16);
+
+  const uint64 size = static_cast<uint64>(size_minus1_) + 1;
+  const uint64 offset =
+      ((static_cast<uint64>(value_ - base_) + 1) << precision) - 1;
+
+  // With cdf[i] = i, the smallest v that satisfies offset < size * v is
+  // offset / size + 1, so the decoded value is found by a single division.
+  uint32 value = offset / size;
+  // See the comment in Decode().
+  if (TF_PREDICT_FALSE(value >> precision != 0)) {
+    corrupted_ = true;
+    value = (static_cast<uint32>(1) << precision) - 1;
+  }
+
+  const uint64 lower = size * value;
+  const uint32 a = lower >> precision;
+  const uint32 b = ((lower + size) >> precision) - 1;
+  DCHECK(corrupted_ || a <= offset >> precision);
+  DCHECK(corrupted_ || offset >> precision <= b);
+
+  Narrow(a, b);
+  return value;
+}
+
+#define INSTANTIATE_RANGE_DECODER(Precision)                               \
+  template int32 RangeDecoder::Decode(absl::Span<const int32>, Precision); \
+  template int32 RangeDecoder::Decode(absl::Span<const int32>,             \
+                                      absl::Span<const int16>, int,        \
+                                      Precision);                          \
+  template int32 RangeDecoder::Decode(absl::Span<const uint16>,            \
+                                      absl::Span<const int16>, int,        \
+                                      Precision);                          \
+  template int32 RangeDecoder::DecodeUniform(Precision);
+INSTANTIATE_RANGE_DECODER(int)
+INSTANTIATE_RANGE_DECODER(StaticPrecision<12>)
+INSTANTIATE_RANGE_DECODER(StaticPrecision<14>)
+INSTANTIATE_RANGE_DECODER(StaticPrecision<15>)
+INSTANTIATE_RANGE_DECODER(StaticPrecision<16>)
+#undef INSTANTIATE_RANGE_DECODER
+
 void RangeDecoder::Read16BitValue() {
   value_ <<= 8;
   if (current_ != end_) {
@@ -375,4 +566,323 @@ void RangeDecoder::Read16BitValue() {
     value_ |= static_cast<uint8>(*current_++);
   }
 }
+
+void MakeDecodeTable(absl::Span<const int32> cdf, int precision,
+                     absl::Span<int16> table) {
+  DCHECK_GT(precision, 0);
+  DCHECK_LE(precision, 16);
+  DCHECK_GE(cdf.size(), 2);
+  DCHECK_LE(cdf.size(), 1 << 15);
+
+  int table_bits = 0;
+  while ((size_t{1} << table_bits) < table.size()) {
+    ++table_bits;
+  }
+  DCHECK_EQ(table.size(), size_t{1} << table_bits);
+  DCHECK_LE(table_bits, precision);
+  const int shift = precision - table_bits;
+
+  // For each bucket, find the character whose interval contains the smallest
+  // value in the bucket. The scan stops before cdf reaches 2^precision, which
+  // makes padding after that point irrelevant.
+  const int32 max_index = cdf.size() - 2;
+  int32 index = 0;
+  for (size_t i = 0; i < table.size(); ++i) {
+    const int32 value = static_cast<int32>(i) << shift;
+    while (index < max_index && cdf[index + 1] <= value) {
+      ++index;
+    }
+    table[i] = index;
+  }
+}
+
+namespace {
+
+// Writes the first `count` bytes of `word` in big-endian order, with a single
+// store when count == 4.
+template <typename Sink>
+inline void WriteWord(uint32 word, size_t count, Sink* sink) {
+  const char bytes[4] = {static_cast<char>(word >> 24),
+                         static_cast<char>(word >> 16),
+                         static_cast<char>(word >> 8), static_cast<char>(word)};
+  sink->append(bytes, count);
+}
+
+}  // namespace
+
+template <typename Precision, typename Sink>
+void RangeEncoder64::Encode(int32 lower, int32 upper, Precision precision,
+                            Sink* sink) {
+  DCHECK_GT(precision, 0);
+  DCHECK_LE(precision, 16);
+  DCHECK_LE(0, lower);
+  DCHECK_LT(lower, upper);
+  DCHECK_LE(upper, 1 << precision);
+
+  // As 2^32 <= size, step >= 2^16 and the new size is at least 2^16. A single
+  // shift by 32 bits brings it back above 2^32.
+  const uint64 step = size_ >> precision;
+  const uint64 a = step * static_cast<uint64>(lower);
+  low_ += a;
+  // Since low + size < 2^65 holds at all times, at most one carry happens
+  // between two calls to ShiftLow().
+  if (low_ < a) {
+    DCHECK(!carry_);
+    carry_ = true;
+  }
+  size_ = step * static_cast<uint64>(upper - lower);
+  if (size_ >> 32 == 0) {
+    ShiftLow(sink);
+    size_ <<= 32;
+  }
+}
+
+template <typename Precision, typename Sink>
+void RangeEncoder64::EncodeUniform(int32 value, Precision precision,
+                                   Sink* sink) {
+  Encode(value, value + 1, precision, sink);
+}
+
+template <typename Sink>
+inline void RangeEncoder64::ShiftLow(Sink* sink) {
+  const uint32 top = low_ >> 32;
+  if (top != 0xFFFFFFFF || carry_) {
+    // A carry can no longer reach the cached word and the pending words, and
+    // is added to them now if there was one.
+    if (has_cache_) {
+      WriteWord(cache_ + carry_, 4, sink);
+    } else {
+      // Before the first word is cached, the interval lies in [0, 2^64) in
+      // the scale of the pending words, so there is no carry.
+      DCHECK(!carry_);
+    }
+    sink->append(4 * num_pending_, static_cast<char>(carry_ ? 0 : 0xFF));
+    has_cache_ = true;
+    cache_ = top;
+    num_pending_ = 0;
+    carry_ = false;
+  } else {
+    ++num_pending_;
+    ++num_carries_;
+  }
+  low_ <<= 32;
+}
+
+template <typename Sink>
+void RangeEncoder64::Finalize(Sink* sink) {
+  // Rounds low up to the next multiple of 2^32, which is in [low, low + size)
+  // because 2^32 <= size. The zeros after it are filled in by the decoder.
+  if ((low_ & 0xFFFFFFFF) != 0) {
+    low_ = (low_ | 0xFFFFFFFF) + 1;
+    if (low_ == 0) {
+      DCHECK(!carry_);
+      carry_ = true;
+    }
+  }
+  ShiftLow(sink);
+  DCHECK_EQ(low_, 0);
+
+  // Writes the cached word and the pending words, without trailing zeros.
+  if (num_pending_ > 0) {
+    if (has_cache_) {
+      WriteWord(cache_, 4, sink);
+    }
+    sink->append(4 * num_pending_, static_cast<char>(0xFF));
+  } else {
+    size_t count = 4;
+    while (count > 0 && ((cache_ >> (32 - 8 * count)) & 0xFF) == 0) {
+      --count;
+    }
+    WriteWord(cache_, count, sink);
+  }
+
+  low_ = 0;
+  size_ = std::numeric_limits<uint64>::max();
+  carry_ = false;
+  has_cache_ = false;
+  cache_ = 0;
+  num_pending_ = 0;
+}
+
+#define INSTANTIATE_RANGE_ENCODER64(Precision, Sink)                    \
+  template void RangeEncoder64::Encode(int32, int32, Precision, Sink*); \
+  template void RangeEncoder64::EncodeUniform(int32, Precision, Sink*);
+#define INSTANTIATE_RANGE_ENCODER64_PRECISIONS(Sink)     \
+  INSTANTIATE_RANGE_ENCODER64(int, Sink)                 \
+  INSTANTIATE_RANGE_ENCODER64(StaticPrecision<12>, Sink) \
+  INSTANTIATE_RANGE_ENCODER64(StaticPrecision<14>, Sink) \
+  INSTANTIATE_RANGE_ENCODER64(StaticPrecision<15>, Sink) \
+  INSTANTIATE_RANGE_ENCODER64(StaticPrecision<16>, Sink) \
+  template void RangeEncoder64::Finalize(Sink*);
+INSTANTIATE_RANGE_ENCODER64_PRECISIONS(tstring)
+INSTANTIATE_RANGE_ENCODER64_PRECISIONS(PresizedSink)
+#undef INSTANTIATE_RANGE_ENCODER64_PRECISIONS
+#undef INSTANTIATE_RANGE_ENCODER64
+
+RangeDecoder64::RangeDecoder64(const tstring& source)
+    : RangeDecoder64(source.data(), source.data() + source.size()) {}
+
+RangeDecoder64::RangeDecoder64(const char* begin, const char* end)
+    : current_(begin), end_(end) {
+  value_ = static_cast<uint64>(Read32BitValue()) << 32;
+  value_ |= Read32BitValue();
+}
+
+inline void RangeDecoder64::Narrow(uint64 step, uint32 lower, uint32 upper) {
+  value_ -= step * lower;
+  size_ = step * (upper - lower);
+  if (size_ >> 32 == 0) {
+    // value < size < 2^32, so no bits are lost.
+    value_ = (value_ << 32) | Read32BitValue();
+    size_ <<= 32;
+    // An empty interval is only reached after a decoding error. It is reset,
+    // so that the next step is not zero.
+    if (TF_PREDICT_FALSE(size_ == 0)) {
+      corrupted_ = true;
+      size_ = std::numeric_limits<uint64>::max();
+    }
+  }
+}
+
+template <typename Precision>
+int32 RangeDecoder64::Decode(absl::Span<const int32> cdf,
+                             Precision precision) {
+  DCHECK_GT(precision, 0);
+  DCHECK_LE(precision, 16);
+
+  const uint64 step = size_ >> precision;
+
+  // Finds the smallest v in cdf that satisfies value < step * v, as in
+  // RangeDecoder::Decode().
+  const int32* pv = cdf.data() + 1;
+  auto len = cdf.size() - 1;
+  DCHECK_GT(len, 0);
+
+  do {
+    const auto half = len / 2;
+    const int32* mid = pv + half;
+    DCHECK_GE(*mid, 0);
+    DCHECK_LE(*mid, 1 << precision);
+    if (step * static_cast<uint64>(*mid) <= value_) {
+      pv = mid + 1;
+      len -= half + 1;
+    } else {
+      len = half;
+    }
+  } while (len > 0);
+
+  // See the comment in RangeDecoder::Decode().
+  if (TF_PREDICT_FALSE(pv == cdf.data() + cdf.size())) {
+    corrupted_ = true;
+    --pv;
+  }
+
+  Narrow(step, *(pv - 1), *pv);
+  return pv - cdf.data() - 1;
+}
+
+template <typename Precision>
+int32 RangeDecoder64::Decode(absl::Span<const int32> cdf,
+                             absl::Span<const int16> table, int table_bits,
+                             Precision precision) {
+  DCHECK_GE(cdf.size(), 2);
+  return DecodeWithTable(cdf.data(), cdf.size() - 2, cdf[cdf.size() - 1],
+                         table, table_bits, precision);
+}
+
+template <typename Precision>
+int32 RangeDecoder64::Decode(absl::Span<const uint16> cdf,
+                             absl::Span<const int16> table, int table_bits,
+                             Precision precision) {
+  DCHECK_GE(cdf.size(), 1);
+  return DecodeWithTable(cdf.data(), cdf.size() - 1,
+                         static_cast<uint32>(1) << precision, table,
+                         table_bits, precision);
+}
+
+template <typename T, typename Precision>
+int32 RangeDecoder64::DecodeWithTable(const T* cdf, int32 max_index,
+                                      uint32 last,
+                                      absl::Span<const int16> table,
+                                      int table_bits, Precision precision) {
+  DCHECK_GT(precision, 0);
+  DCHECK_LE(precision, 16);
+  DCHECK_LE(table_bits, precision);
+  DCHECK_EQ(table.size(), 1 << table_bits);
+
+  const uint64 step = size_ >> precision;
+  // A valid bitstream keeps value < step * 2^precision, so target fits in
+  // `precision` bits. Otherwise it is clamped, as in RangeDecoder.
+  uint64 target = value_ / step;
+  if (TF_PREDICT_FALSE(target >> precision != 0)) {
+    corrupted_ = true;
+    target = (static_cast<uint64>(1) << precision) - 1;
+  }
+
+  DCHECK_GE(max_index, 0);
+  int32 index =
+      std::min<int32>(table[target >> (precision - table_bits)], max_index);
+  DCHECK_LE(static_cast<uint32>(cdf[index]), target);
+  while (index < max_index && static_cast<uint32>(cdf[index + 1]) <= target) {
+    ++index;
+  }
+  const uint32 upper =
+      index < max_index ? static_cast<uint32>(cdf[index + 1]) : last;
+  // See the comment in RangeDecoder::Decode().
+  if (TF_PREDICT_FALSE(target >= upper)) {
+    corrupted_ = true;
+  }
+
+  Narrow(step, cdf[index], upper);
+  return index;
+}
+
+template <typename Precision>
+int32 RangeDecoder64::DecodeUniform(Precision precision) {
+  DCHECK_GT(precision, 0);
+  DCHECK_LE(precision, 16);
+
+  const uint64 step = size_ >> precision;
+  uint64 value = value_ / step;
+  // See the comment in RangeDecoder::Decode().
+  if (TF_PREDICT_FALSE(value >> precision != 0)) {
+    corrupted_ = true;
+    value = (static_cast<uint64>(1) << precision) - 1;
+  }
+
+  Narrow(step, value, value + 1);
+  return value;
+}
+
+#define INSTANTIATE_RANGE_DECODER64(Precision)                               \
+  template int32 RangeDecoder64::Decode(absl::Span<const int32>, Precision); \
+  template int32 RangeDecoder64::Decode(absl::Span<const int32>,             \
+                                        absl::Span<const int16>, int,        \
+                                        Precision);                          \
+  template int32 RangeDecoder64::Decode(absl::Span<const uint16>,            \
+                                        absl::Span<const int16>, int,        \
+                                        Precision);                          \
+  template int32 RangeDecoder64::DecodeUniform(Precision);
+INSTANTIATE_RANGE_DECODER64(int)
+INSTANTIATE_RANGE_DECODER64(StaticPrecision<12>)
+INSTANTIATE_RANGE_DECODER64(StaticPrecision<14>)
+INSTANTIATE_RANGE_DECODER64(StaticPrecision<15>)
+INSTANTIATE_RANGE_DECODER64(StaticPrecision<16>)
+#undef INSTANTIATE_RANGE_DECODER64
+
+uint32 RangeDecoder64::Read32BitValue() {
+  uint8 bytes[4] = {0, 0, 0, 0};
+  if (TF_PREDICT_TRUE(end_ - current_ >= 4)) {
+    std::memcpy(bytes, current_, 4);
+    current_ += 4;
+  } else {
+    // Past the end of the bytes, reads zeros.
+    for (int i = 0; current_ != end_; ++i) {
+      bytes[i] = static_cast<uint8>(*current_++);
+    }
+  }
+  return (static_cast<uint32>(bytes[0]) << 24) |
+         (static_cast<uint32>(bytes[1]) << 16) |
+         (static_cast<uint32>(bytes[2]) << 8) | static_cast<uint32>(bytes[3]);
+}
 }  // namespace tensorflow_compression
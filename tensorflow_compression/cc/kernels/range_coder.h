@@ -16,14 +16,78 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPRESSION_CC_KERNELS_RANGE_CODER_H_
 #define TENSORFLOW_COMPRESSION_CC_KERNELS_RANGE_CODER_H_
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <limits>
 #include <string>
+#include <type_traits>
+#include <vector>
 
+#include "absl/container/inlined_vector.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow_compression {
 
+// A sink for RangeEncoder that writes directly into the buffer of a string,
+// which is sized up front to an estimate of the output size. Compared to
+// appending to the string byte by byte, this avoids repeated reallocations
+// and most of the capacity checks. If the estimate turns out to be too small,
+// the buffer grows geometrically.
+class PresizedSink {
+ public:
+  // Appends to `output`, with room for `size_hint` bytes. The caller has to
+  // make sure that `output` outlives the sink object, and must not access
+  // `output` until Finish() is called.
+  PresizedSink(tensorflow::tstring* output, size_t size_hint);
+
+  PresizedSink(PresizedSink&&) = default;
+  PresizedSink(const PresizedSink&) = delete;
+  PresizedSink& operator=(const PresizedSink&) = delete;
+
+  void push_back(char c) {
+    if (TF_PREDICT_FALSE(current_ == end_)) {
+      Grow(1);
+    }
+    *current_++ = c;
+  }
+
+  void append(size_t count, char c) {
+    if (TF_PREDICT_FALSE(static_cast<size_t>(end_ - current_) < count)) {
+      Grow(count);
+    }
+    current_ = std::fill_n(current_, count, c);
+  }
+
+  void append(const char* data, size_t count) {
+    if (TF_PREDICT_FALSE(static_cast<size_t>(end_ - current_) < count)) {
+      Grow(count);
+    }
+    current_ = std::copy_n(data, count, current_);
+  }
+
+  // Trims `output` to the bytes written so far.
+  void Finish();
+
+ private:
+  // Makes room for at least `count` more bytes.
+  void Grow(size_t count);
+
+  tensorflow::tstring* const output_;
+  char* current_ = nullptr;
+  char* end_ = nullptr;
+};
+
+// A precision known at compile time. The `precision` arguments of the coder
+// functions below are either an int, or StaticPrecision<p>() so that the
+// shifts and bounds by the precision are constant-folded in the coding loops.
+// Only the precisions listed in range_coder.cc are instantiated.
+template <int kPrecision>
+using StaticPrecision = std::integral_constant<int, kPrecision>;
+
 class RangeEncoder {
  public:
   RangeEncoder() = default;
@@ -42,21 +106,45 @@ class RangeEncoder {
   // To encode value 2, lower = Pr(X = 0 or 1) and upper = Pr(X = 0, 1, or 2).
   // ...
   //
+  // `Sink` is either tstring or PresizedSink.
+  //
   // REQUIRES: 0 <= lower < upper <= 2^precision.
   // REQUIRES: 0 < precision <= 16.
-  void Encode(tensorflow::int32 lower, tensorflow::int32 upper, int precision,
-              tensorflow::tstring* sink);
+  template <typename Precision, typename Sink>
+  void Encode(tensorflow::int32 lower, tensorflow::int32 upper,
+              Precision precision, Sink* sink);
+
+  // Same as Encode(value, value + 1, precision, sink), i.e., encodes `value`
+  // from the uniform distribution over [0, 2^precision), without a CDF.
+  //
+  // REQUIRES: 0 <= value < 2^precision.
+  // REQUIRES: 0 < precision <= 16.
+  template <typename Precision, typename Sink>
+  void EncodeUniform(tensorflow::int32 value, Precision precision, Sink* sink);
 
   // The encode may contain some under-determined values from previous encoding.
   // After Encode() calls, Finalize() must be called. Otherwise the encoded
   // string may not be decoded.
-  void Finalize(tensorflow::tstring* sink);
+  template <typename Sink>
+  void Finalize(Sink* sink);
+
+  // Returns the number of times the output was delayed, because the encoded
+  // interval contained a carry boundary (the transitions to state 1 in
+  // range_coder.cc). Each such event holds back two or more bytes until the
+  // carry is resolved.
+  tensorflow::int64 num_carries() const { return num_carries_; }
 
  private:
+  // Narrows the interval to [base + a, base + b] and writes out the bytes that
+  // are determined.
+  template <typename Sink>
+  void Narrow(tensorflow::uint32 a, tensorflow::uint32 b, Sink* sink);
+
   tensorflow::uint32 base_ = 0;
   tensorflow::uint32 size_minus1_ =
       std::numeric_limits<tensorflow::uint32>::max();
   tensorflow::uint64 delay_ = 0;
+  tensorflow::int64 num_carries_ = 0;
 };
 
 class RangeDecoder {
@@ -65,6 +153,10 @@ class RangeDecoder {
   // outlives the decoder object.
   explicit RangeDecoder(const tensorflow::tstring& source);
 
+  // Decodes the bytes in the half-open range [begin, end). The caller has to
+  // make sure that the bytes outlive the decoder object.
+  RangeDecoder(const char* begin, const char* end);
+
   // Decodes a character from `source` using CDF. The size of `cdf` should be
   // one more than the number of the character in the alphabet.
   //
@@ -85,19 +177,355 @@ class RangeDecoder {
   // REQUIRES: 0 < precision <= 16.
   //
   // In practice the last element of `cdf` should equal to 2^precision.
+  template <typename Precision>
+  tensorflow::int32 Decode(absl::Span<const tensorflow::int32> cdf,
+                           Precision precision);
+
+  // Same as above, but uses a decode table created by MakeDecodeTable() to
+  // find the character in O(1) time for most characters, instead of running a
+  // binary search over `cdf`.
+  //
+  // REQUIRES: table.size() == 2^table_bits.
+  // REQUIRES: table_bits <= precision.
+  template <typename Precision>
   tensorflow::int32 Decode(absl::Span<const tensorflow::int32> cdf,
-                           int precision);
+                           absl::Span<const tensorflow::int16> table,
+                           int table_bits, Precision precision);
+
+  // Same as above, but for a CDF stored in 16 bits without its last element,
+  // which is taken to be 2^precision. Returns cdf.size() - 1 for the last
+  // character.
+  //
+  // REQUIRES: cdf.size() > 0.
+  template <typename Precision>
+  tensorflow::int32 Decode(absl::Span<const tensorflow::uint16> cdf,
+                           absl::Span<const tensorflow::int16> table,
+                           int table_bits, Precision precision);
+
+  // Reverse of RangeEncoder::EncodeUniform(). Same as Decode() with
+  // cdf = {0, 1, 2, ..., 2^precision}, but finds the value in O(1) time.
+  //
+  // REQUIRES: 0 < precision <= 16.
+  template <typename Precision>
+  tensorflow::int32 DecodeUniform(Precision precision);
+
+  // Returns true if a decoding error was detected by any call so far, i.e.,
+  // if the bytes are not a valid encoding with the CDFs they were decoded with.
+  // The flag is sticky, so that decode loops can check it once at the end.
+  // After an error, Decode() still returns an index into `cdf`, but the values
+  // are meaningless. Not every corruption of the bytes is detected.
+  bool corrupted() const { return corrupted_; }
+
+  // Returns the position of the next byte to be read. Past the end of the
+  // bytes, the decoder reads zeros.
+  const char* current() const { return current_; }
+
+  // Continues decoding from [begin, end), which has to start with the bytes in
+  // [current(), end) of the previous range, in order to decode a bitstream that
+  // arrives in pieces. Each Decode() reads at most 2 bytes.
+  void Resume(const char* begin, const char* end) {
+    current_ = begin;
+    end_ = end;
+  }
 
  private:
+  // Narrows the interval to [base + a, base + b] and reads more bytes if
+  // needed.
+  void Narrow(tensorflow::uint32 a, tensorflow::uint32 b);
+  // Implements Decode() with a decode table for `cdf`, which is cdf[0],
+  // cdf[1], ..., cdf[max_index], followed by `last`.
+  template <typename T, typename Precision>
+  tensorflow::int32 DecodeWithTable(const T* cdf, tensorflow::int32 max_index,
+                                    tensorflow::uint32 last,
+                                    absl::Span<const tensorflow::int16> table,
+                                    int table_bits, Precision precision);
   void Read16BitValue();
 
   tensorflow::uint32 base_ = 0;
   tensorflow::uint32 size_minus1_ =
       std::numeric_limits<tensorflow::uint32>::max();
   tensorflow::uint32 value_ = 0;
+  bool corrupted_ = false;
+
+  const char* current_;
+  const char* end_;
+};
+
+// Fills `table` with a decode table for `cdf`, to be used by
+// RangeDecoder::Decode(). Let `table_bits` = log2(table.size()). Then
+// `table[i]` is the character that the value `i * 2^(precision - table_bits)`
+// falls into. When table_bits == precision, this is a complete map from values
+// to characters. Otherwise the decoder starts from the table entry and scans
+// forward.
+//
+// Entries of `cdf` after the first one reaching 2^precision are ignored, so
+// that padded CDF rows may be passed.
+//
+// REQUIRES: table.size() is a power of 2 and not greater than 2^precision.
+// REQUIRES: cdf.size() <= 2^15.
+void MakeDecodeTable(absl::Span<const tensorflow::int32> cdf, int precision,
+                     absl::Span<tensorflow::int16> table);
+
+// A range coder with a 64-bit interval and 32-bit word I/O. This is version 2
+// of the bitstream; version 1 is written by RangeEncoder. The two versions are
+// not compatible with each other.
+//
+// Compared to RangeEncoder, the interval is renormalized half as often, and
+// each renormalization writes one 32-bit word, in big-endian order. The
+// interval of a character is [lower, upper) * floor(size / 2^precision), which
+// wastes less than 2^(precision - 32) of the interval per character. In
+// exchange, no 128-bit products are needed.
+//
+// A pending carry is held back LZMA style: the last word that a carry could
+// still change is kept in `cache_`, followed by `num_pending_` words of
+// 0xFFFFFFFF that the carry would turn into zeros.
+class RangeEncoder64 {
+ public:
+  RangeEncoder64() = default;
+
+  // Same as RangeEncoder::Encode().
+  //
+  // REQUIRES: 0 <= lower < upper <= 2^precision.
+  // REQUIRES: 0 < precision <= 16.
+  template <typename Precision, typename Sink>
+  void Encode(tensorflow::int32 lower, tensorflow::int32 upper,
+              Precision precision, Sink* sink);
+
+  // Same as Encode(value, value + 1, precision, sink).
+  //
+  // REQUIRES: 0 <= value < 2^precision.
+  // REQUIRES: 0 < precision <= 16.
+  template <typename Precision, typename Sink>
+  void EncodeUniform(tensorflow::int32 value, Precision precision, Sink* sink);
+
+  // Same as RangeEncoder::Finalize().
+  template <typename Sink>
+  void Finalize(Sink* sink);
+
+  // Returns the number of words that were held back, because a carry could
+  // still change them.
+  tensorflow::int64 num_carries() const { return num_carries_; }
+
+ private:
+  // Moves the top 32 bits of `low_` out, and writes out the words that a
+  // carry can no longer change.
+  template <typename Sink>
+  void ShiftLow(Sink* sink);
+
+  // The interval is [low_, low_ + size_), plus 2^64 if `carry_` is set.
+  // Invariant: 2^32 <= size_ after each Encode().
+  tensorflow::uint64 low_ = 0;
+  tensorflow::uint64 size_ = std::numeric_limits<tensorflow::uint64>::max();
+  bool carry_ = false;
+  bool has_cache_ = false;
+  tensorflow::uint32 cache_ = 0;
+  tensorflow::int64 num_pending_ = 0;
+  tensorflow::int64 num_carries_ = 0;
+};
+
+// Reverse of RangeEncoder64.
+class RangeDecoder64 {
+ public:
+  // Holds a reference to `source`. The caller has to make sure that `source`
+  // outlives the decoder object.
+  explicit RangeDecoder64(const tensorflow::tstring& source);
+
+  // Decodes the bytes in the half-open range [begin, end). The caller has to
+  // make sure that the bytes outlive the decoder object.
+  RangeDecoder64(const char* begin, const char* end);
+
+  // Same as the corresponding RangeDecoder::Decode().
+  template <typename Precision>
+  tensorflow::int32 Decode(absl::Span<const tensorflow::int32> cdf,
+                           Precision precision);
+  template <typename Precision>
+  tensorflow::int32 Decode(absl::Span<const tensorflow::int32> cdf,
+                           absl::Span<const tensorflow::int16> table,
+                           int table_bits, Precision precision);
+  template <typename Precision>
+  tensorflow::int32 Decode(absl::Span<const tensorflow::uint16> cdf,
+                           absl::Span<const tensorflow::int16> table,
+                           int table_bits, Precision precision);
+
+  // Reverse of RangeEncoder64::EncodeUniform().
+  template <typename Precision>
+  tensorflow::int32 DecodeUniform(Precision precision);
+
+  // Same as RangeDecoder::corrupted().
+  bool corrupted() const { return corrupted_; }
+
+ private:
+  // Narrows the interval to [lower, upper) * step and reads another word if
+  // needed.
+  void Narrow(tensorflow::uint64 step, tensorflow::uint32 lower,
+              tensorflow::uint32 upper);
+  template <typename T, typename Precision>
+  tensorflow::int32 DecodeWithTable(const T* cdf, tensorflow::int32 max_index,
+                                    tensorflow::uint32 last,
+                                    absl::Span<const tensorflow::int16> table,
+                                    int table_bits, Precision precision);
+  tensorflow::uint32 Read32BitValue();
+
+  // The offset of the encoded value from the lower end of the interval, and
+  // the size of the interval.
+  tensorflow::uint64 value_ = 0;
+  tensorflow::uint64 size_ = std::numeric_limits<tensorflow::uint64>::max();
+  bool corrupted_ = false;
+
+  const char* current_;
+  const char* end_;
+};
+
+// Range encodes a single stream of characters with `kNumLanes` independent
+// coder states. The i-th character is encoded by lane `i % kNumLanes`, and each
+// lane writes its own substream. Because the lanes do not depend on each other,
+// the CPU can overlap the work on consecutive characters. With kNumLanes == 1,
+// the output is identical to that of `Encoder`, which is either RangeEncoder or
+// RangeEncoder64.
+template <int kNumLanes, typename Encoder = RangeEncoder>
+class InterleavedRangeEncoder {
+ public:
+  static_assert(kNumLanes > 0, "kNumLanes must be positive");
+
+  // Lane i appends its output to `sinks[i]`. `size_hint` is an estimate of
+  // the total output size of all lanes, used to size the strings up front. The
+  // caller has to make sure that `sinks` outlives the encoder object, and must
+  // not access `sinks` until Finalize() is called.
+  //
+  // REQUIRES: sinks.size() == kNumLanes.
+  explicit InterleavedRangeEncoder(absl::Span<tensorflow::tstring> sinks,
+                                   size_t size_hint = 0) {
+    sinks_.reserve(kNumLanes);
+    for (int i = 0; i < kNumLanes; ++i) {
+      sinks_.emplace_back(&sinks[i], size_hint / kNumLanes);
+    }
+  }
+
+  // Same as RangeEncoder::Encode(), using the next lane.
+  template <typename Precision>
+  void Encode(tensorflow::int32 lower, tensorflow::int32 upper,
+              Precision precision) {
+    encoders_[lane_].Encode(lower, upper, precision, &sinks_[lane_]);
+    NextLane();
+  }
+
+  // Same as RangeEncoder::EncodeUniform(), using the next lane.
+  template <typename Precision>
+  void EncodeUniform(tensorflow::int32 value, Precision precision) {
+    encoders_[lane_].EncodeUniform(value, precision, &sinks_[lane_]);
+    NextLane();
+  }
+
+  // Returns the sum of RangeEncoder::num_carries() of all lanes.
+  tensorflow::int64 num_carries() const {
+    tensorflow::int64 count = 0;
+    for (const Encoder& encoder : encoders_) {
+      count += encoder.num_carries();
+    }
+    return count;
+  }
+
+  // Finalizes all lanes.
+  void Finalize() {
+    for (int i = 0; i < kNumLanes; ++i) {
+      encoders_[i].Finalize(&sinks_[i]);
+      sinks_[i].Finish();
+    }
+  }
+
+ private:
+  void NextLane() {
+    if (kNumLanes > 1 && ++lane_ == kNumLanes) {
+      lane_ = 0;
+    }
+  }
+
+  std::array<Encoder, kNumLanes> encoders_;
+  // PresizedSink is not default constructible, hence not stored in std::array.
+  // The inline storage avoids a heap allocation per encoder.
+  absl::InlinedVector<PresizedSink, kNumLanes> sinks_;
+  int lane_ = 0;
+};
+
+// Reverse of InterleavedRangeEncoder. `Decoder` is either RangeDecoder or
+// RangeDecoder64, matching the encoder.
+template <int kNumLanes, typename Decoder = RangeDecoder>
+class InterleavedRangeDecoder {
+ public:
+  static_assert(kNumLanes > 0, "kNumLanes must be positive");
+
+  // Lane i decodes `lanes[i]`. The caller has to make sure that the bytes
+  // referenced by `lanes` outlive the decoder object.
+  //
+  // REQUIRES: lanes.size() == kNumLanes.
+  explicit InterleavedRangeDecoder(absl::Span<const absl::string_view> lanes) {
+    decoders_.reserve(kNumLanes);
+    for (int i = 0; i < kNumLanes; ++i) {
+      const absl::string_view lane = lanes[i];
+      decoders_.emplace_back(lane.data(), lane.data() + lane.size());
+    }
+  }
+
+  // Same as RangeDecoder::Decode(), using the next lane.
+  template <typename Precision>
+  tensorflow::int32 Decode(absl::Span<const tensorflow::int32> cdf,
+                           Precision precision) {
+    const tensorflow::int32 value = decoders_[lane_].Decode(cdf, precision);
+    NextLane();
+    return value;
+  }
+
+  // Same as RangeDecoder::Decode() with a decode table, using the next lane.
+  template <typename Precision>
+  tensorflow::int32 Decode(absl::Span<const tensorflow::int32> cdf,
+                           absl::Span<const tensorflow::int16> table,
+                           int table_bits, Precision precision) {
+    const tensorflow::int32 value =
+        decoders_[lane_].Decode(cdf, table, table_bits, precision);
+    NextLane();
+    return value;
+  }
+
+  // Same as above, for a CDF stored in 16 bits without its last element.
+  template <typename Precision>
+  tensorflow::int32 Decode(absl::Span<const tensorflow::uint16> cdf,
+                           absl::Span<const tensorflow::int16> table,
+                           int table_bits, Precision precision) {
+    const tensorflow::int32 value =
+        decoders_[lane_].Decode(cdf, table, table_bits, precision);
+    NextLane();
+    return value;
+  }
+
+  // Same as RangeDecoder::DecodeUniform(), using the next lane.
+  template <typename Precision>
+  tensorflow::int32 DecodeUniform(Precision precision) {
+    const tensorflow::int32 value = decoders_[lane_].DecodeUniform(precision);
+    NextLane();
+    return value;
+  }
+
+  // Returns true if any lane has detected a decoding error. See
+  // RangeDecoder::corrupted().
+  bool corrupted() const {
+    bool corrupted = false;
+    for (const Decoder& decoder : decoders_) {
+      corrupted |= decoder.corrupted();
+    }
+    return corrupted;
+  }
+
+ private:
+  void NextLane() {
+    if (kNumLanes > 1 && ++lane_ == kNumLanes) {
+      lane_ = 0;
+    }
+  }
 
-  tensorflow::tstring::const_iterator current_;
-  const tensorflow::tstring::const_iterator end_;
+  // The decoders are not default constructible, hence not stored in
+  // std::array. The inline storage avoids a heap allocation per decoder.
+  absl::InlinedVector<Decoder, kNumLanes> decoders_;
+  int lane_ = 0;
 };
 
 }  // namespace tensorflow_compression
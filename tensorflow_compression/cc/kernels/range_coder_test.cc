@@ -15,7 +15,10 @@ limitations under the License.
 
 #include <cmath>
 #include <random>
+#include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tensorflow/core/lib/random/distribution_sampler.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
@@ -28,6 +31,7 @@ namespace tensorflow_compression {
 namespace {
 namespace random = tensorflow::random;
 
+template <typename Encoder, typename Decoder>
 void RangeEncodeDecodeTest(int precision, random::SimplePhilox* gen) {
   constexpr int kAlphabetSize = 256;
 
@@ -67,7 +71,7 @@ void RangeEncodeDecodeTest(int precision, random::SimplePhilox* gen) {
     ideal_code_length[i] = -std::log2((cdf[i + 1] - cdf[i]) / normalizer);
   }
 
-  RangeEncoder encoder;
+  Encoder encoder;
   tensorflow::tstring encoded;
   double ideal_length = 0.0;
   for (uint8 x : data) {
@@ -82,11 +86,39 @@ void RangeEncodeDecodeTest(int precision, random::SimplePhilox* gen) {
             << " (ideal compression rate " << ideal_length / (8 * data.size())
             << ")";
 
-  RangeDecoder decoder(encoded);
+  Decoder decoder(encoded);
   for (int i = 0; i < data.size(); ++i) {
     const int32 decoded = decoder.Decode(cdf, precision);
     ASSERT_EQ(decoded, static_cast<int32>(data[i])) << i;
   }
+
+  // Decoding with a decode table should produce the same result, with both a
+  // complete table and a bucketed table.
+  for (int table_bits : {precision, precision / 2}) {
+    std::vector<int16> table(1 << table_bits);
+    MakeDecodeTable(cdf, precision, absl::MakeSpan(table));
+
+    Decoder table_decoder(encoded);
+    for (int i = 0; i < data.size(); ++i) {
+      const int32 decoded =
+          table_decoder.Decode(cdf, table, table_bits, precision);
+      ASSERT_EQ(decoded, static_cast<int32>(data[i]))
+          << "table_bits=" << table_bits << ", i=" << i;
+    }
+
+    // The same with the CDF stored in 16 bits without its last element, which
+    // requires the other elements to be less than 2^precision.
+    if (cdf[cdf.size() - 2] < (1 << precision)) {
+      const std::vector<uint16> packed_cdf(cdf.begin(), cdf.end() - 1);
+      Decoder packed_decoder(encoded);
+      for (int i = 0; i < data.size(); ++i) {
+        const int32 decoded = packed_decoder.Decode(
+            absl::MakeConstSpan(packed_cdf), table, table_bits, precision);
+        ASSERT_EQ(decoded, static_cast<int32>(data[i]))
+            << "table_bits=" << table_bits << ", i=" << i;
+      }
+    }
+  }
 }
 
 TEST(RangeCoderTest, Precision1To11) {
@@ -94,7 +126,7 @@ TEST(RangeCoderTest, Precision1To11) {
   random::PhiloxRandom gen(rd(), rd());
   random::SimplePhilox rand(&gen);
   const int precision = 1 + rand.Uniform(11);
-  RangeEncodeDecodeTest(precision, &rand);
+  RangeEncodeDecodeTest<RangeEncoder, RangeDecoder>(precision, &rand);
 }
 
 TEST(RangeCoderTest, Precision12To16) {
@@ -102,7 +134,7 @@ TEST(RangeCoderTest, Precision12To16) {
   random::PhiloxRandom gen(rd(), rd());
   random::SimplePhilox rand(&gen);
   for (int precision = 12; precision < 17; ++precision) {
-    RangeEncodeDecodeTest(precision, &rand);
+    RangeEncodeDecodeTest<RangeEncoder, RangeDecoder>(precision, &rand);
   }
 }
 
@@ -118,6 +150,347 @@ TEST(RangeCoderTest, FinalizeState0) {
   EXPECT_EQ(decoder.Decode({0, 2, 4}, kPrecision), 0);
 }
 
+TEST(RangeCoderTest, NumCarries) {
+  constexpr int kPrecision = 10;
+  const std::vector<int32> cdf = {0, 400, 700, 900, 1000, 1024};
+
+  // Intervals at the bottom of the range never straddle a carry boundary.
+  {
+    tensorflow::tstring output;
+    RangeEncoder encoder;
+    for (int i = 0; i < 1000; ++i) {
+      encoder.Encode(cdf[0], cdf[1], kPrecision, &output);
+    }
+    encoder.Finalize(&output);
+    EXPECT_EQ(encoder.num_carries(), 0);
+  }
+
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+  std::vector<int32> data(1000);
+  for (int32& x : data) {
+    x = rand.Uniform(cdf.size() - 1);
+  }
+
+  tensorflow::tstring output;
+  RangeEncoder encoder;
+  for (int32 x : data) {
+    encoder.Encode(cdf[x], cdf[x + 1], kPrecision, &output);
+  }
+  encoder.Finalize(&output);
+  EXPECT_GT(encoder.num_carries(), 0);
+
+  // The interleaved encoder counts the carries of all lanes.
+  std::vector<tensorflow::tstring> lanes(1);
+  InterleavedRangeEncoder<1> interleaved(absl::MakeSpan(lanes));
+  for (int32 x : data) {
+    interleaved.Encode(cdf[x], cdf[x + 1], kPrecision);
+  }
+  interleaved.Finalize();
+  EXPECT_EQ(interleaved.num_carries(), encoder.num_carries());
+  EXPECT_EQ(lanes[0], output);
+}
+
+TEST(RangeCoderTest, PresizedSink) {
+  constexpr int kPrecision = 10;
+  const std::vector<int32> cdf = {0, 400, 700, 900, 1000, 1024};
+
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+  std::vector<int32> data(1000);
+  for (int32& x : data) {
+    x = rand.Uniform(cdf.size() - 1);
+  }
+
+  RangeEncoder expected_encoder;
+  tensorflow::tstring expected;
+  for (int32 x : data) {
+    expected_encoder.Encode(cdf[x], cdf[x + 1], kPrecision, &expected);
+  }
+  expected_encoder.Finalize(&expected);
+
+  // Size hints that are too small force the sink to grow, and unused capacity
+  // is trimmed by Finish().
+  for (size_t size_hint : {0, 1, 100, 10000}) {
+    tensorflow::tstring output;
+    PresizedSink sink(&output, size_hint);
+    RangeEncoder encoder;
+    for (int32 x : data) {
+      encoder.Encode(cdf[x], cdf[x + 1], kPrecision, &sink);
+    }
+    encoder.Finalize(&sink);
+    sink.Finish();
+    EXPECT_EQ(output, expected) << "size_hint=" << size_hint;
+  }
+}
+
+TEST(RangeCoderTest, Uniform) {
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+
+  // Mixes uniform symbols of different precisions with symbols from a CDF, as
+  // UnboundedIndexRangeEncode does for overflows.
+  const std::vector<int32> cdf = {0, 3000, 3500, 4000, 4096};
+  std::vector<int32> precisions(2000);
+  std::vector<int32> data(precisions.size());
+  for (int i = 0; i < data.size(); ++i) {
+    precisions[i] = rand.Uniform(17);
+    data[i] = precisions[i] > 0 ? rand.Uniform(1 << precisions[i])
+                                : rand.Uniform(cdf.size() - 1);
+  }
+
+  tensorflow::tstring expected;
+  tensorflow::tstring output;
+  RangeEncoder expected_encoder;
+  RangeEncoder encoder;
+  for (int i = 0; i < data.size(); ++i) {
+    const int32 x = data[i];
+    if (precisions[i] > 0) {
+      expected_encoder.Encode(x, x + 1, precisions[i], &expected);
+      encoder.EncodeUniform(x, precisions[i], &output);
+    } else {
+      expected_encoder.Encode(cdf[x], cdf[x + 1], 12, &expected);
+      encoder.Encode(cdf[x], cdf[x + 1], 12, &output);
+    }
+  }
+  expected_encoder.Finalize(&expected);
+  encoder.Finalize(&output);
+  EXPECT_EQ(output, expected);
+
+  RangeDecoder decoder(output);
+  for (int i = 0; i < data.size(); ++i) {
+    if (precisions[i] > 0) {
+      ASSERT_EQ(decoder.DecodeUniform(precisions[i]), data[i]) << i;
+    } else {
+      ASSERT_EQ(decoder.Decode(cdf, 12), data[i]) << i;
+    }
+  }
+}
+
+template <int kPrecision>
+void StaticPrecisionTest(random::SimplePhilox* gen) {
+  const std::vector<int32> cdf = {0, 1, 1 << (kPrecision - 2),
+                                  1 << (kPrecision - 1), 1 << kPrecision};
+  std::vector<int32> data(1000);
+  for (int32& x : data) {
+    x = gen->Uniform(cdf.size() - 1);
+    if (cdf[x] == cdf[x + 1]) x = 0;
+  }
+
+  tensorflow::tstring expected;
+  tensorflow::tstring output;
+  RangeEncoder expected_encoder;
+  RangeEncoder encoder;
+  for (int32 x : data) {
+    expected_encoder.Encode(cdf[x], cdf[x + 1], kPrecision, &expected);
+    encoder.Encode(cdf[x], cdf[x + 1], StaticPrecision<kPrecision>(), &output);
+  }
+  expected_encoder.Finalize(&expected);
+  encoder.Finalize(&output);
+  EXPECT_EQ(output, expected) << "precision=" << kPrecision;
+
+  std::vector<int16> table(1 << 8);
+  MakeDecodeTable(cdf, kPrecision, absl::MakeSpan(table));
+  RangeDecoder decoder(output);
+  RangeDecoder table_decoder(output);
+  for (int i = 0; i < data.size(); ++i) {
+    ASSERT_EQ(decoder.Decode(cdf, StaticPrecision<kPrecision>()), data[i]);
+    ASSERT_EQ(
+        table_decoder.Decode(cdf, table, 8, StaticPrecision<kPrecision>()),
+        data[i]);
+  }
+}
+
+TEST(RangeCoderTest, StaticPrecision) {
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+  StaticPrecisionTest<12>(&rand);
+  StaticPrecisionTest<14>(&rand);
+  StaticPrecisionTest<15>(&rand);
+  StaticPrecisionTest<16>(&rand);
+}
+
+template <int kNumLanes>
+void InterleavedEncodeDecodeTest(random::SimplePhilox* gen) {
+  constexpr int kPrecision = 10;
+  const std::vector<int32> cdf = {0, 400, 700, 900, 1000, 1024};
+
+  std::vector<int32> data(1000 + gen->Uniform(kNumLanes));
+  for (int32& x : data) {
+    x = gen->Uniform(cdf.size() - 1);
+  }
+
+  std::vector<tensorflow::tstring> lanes(kNumLanes);
+  InterleavedRangeEncoder<kNumLanes> encoder(absl::MakeSpan(lanes));
+  for (int32 x : data) {
+    encoder.Encode(cdf[x], cdf[x + 1], kPrecision);
+  }
+  encoder.Finalize();
+
+  // Each lane should be identical to a plain range coder run over every
+  // kNumLanes-th character.
+  for (int lane = 0; lane < kNumLanes; ++lane) {
+    RangeEncoder lane_encoder;
+    tensorflow::tstring expected;
+    for (int i = lane; i < data.size(); i += kNumLanes) {
+      lane_encoder.Encode(cdf[data[i]], cdf[data[i] + 1], kPrecision,
+                          &expected);
+    }
+    lane_encoder.Finalize(&expected);
+    EXPECT_EQ(lanes[lane], expected) << "lane=" << lane;
+  }
+
+  std::vector<absl::string_view> views(lanes.begin(), lanes.end());
+  InterleavedRangeDecoder<kNumLanes> decoder(views);
+  for (int i = 0; i < data.size(); ++i) {
+    ASSERT_EQ(decoder.Decode(cdf, kPrecision), data[i]) << i;
+  }
+}
+
+TEST(RangeCoderTest, Interleaved) {
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+  InterleavedEncodeDecodeTest<1>(&rand);
+  InterleavedEncodeDecodeTest<2>(&rand);
+  InterleavedEncodeDecodeTest<4>(&rand);
+  InterleavedEncodeDecodeTest<8>(&rand);
+}
+
+TEST(RangeCoderTest, Coder64) {
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+  for (int precision = 1; precision < 17; ++precision) {
+    RangeEncodeDecodeTest<RangeEncoder64, RangeDecoder64>(precision, &rand);
+  }
+}
+
+TEST(RangeCoderTest, Coder64Carries) {
+  constexpr int kPrecision = 16;
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+
+  // Values at both ends of the range make the words before a carry boundary
+  // 0xFFFFFFFF often, which have to be held back.
+  std::vector<int32> data(10000);
+  for (int32& x : data) {
+    x = rand.Uniform(2) == 0 ? 0 : (1 << kPrecision) - 1;
+  }
+
+  tensorflow::tstring output;
+  RangeEncoder64 encoder;
+  for (int32 x : data) {
+    encoder.EncodeUniform(x, kPrecision, &output);
+  }
+  encoder.Finalize(&output);
+  EXPECT_GT(encoder.num_carries(), 0);
+
+  tensorflow::tstring presized_output;
+  PresizedSink sink(&presized_output, 0);
+  RangeEncoder64 presized_encoder;
+  for (int32 x : data) {
+    presized_encoder.EncodeUniform(x, kPrecision, &sink);
+  }
+  presized_encoder.Finalize(&sink);
+  sink.Finish();
+  EXPECT_EQ(presized_output, output);
+
+  RangeDecoder64 decoder(output);
+  for (int i = 0; i < data.size(); ++i) {
+    ASSERT_EQ(decoder.DecodeUniform(kPrecision), data[i]) << i;
+  }
+}
+
+TEST(RangeCoderTest, Coder64Finalize) {
+  // Nothing is written for an empty stream, and trailing zeros are dropped.
+  tensorflow::tstring output;
+  RangeEncoder64 encoder;
+  encoder.Finalize(&output);
+  EXPECT_EQ(output, "");
+
+  encoder.Encode(0, 2, 2, &output);
+  encoder.Finalize(&output);
+  EXPECT_EQ(output, "");
+  RangeDecoder64 decoder(output);
+  EXPECT_EQ(decoder.Decode({0, 2, 4}, 2), 0);
+
+  encoder.Encode(2, 4, 2, &output);
+  encoder.Finalize(&output);
+  EXPECT_EQ(output, "\x80");
+  RangeDecoder64 upper_decoder(output);
+  EXPECT_EQ(upper_decoder.Decode({0, 2, 4}, 2), 1);
+}
+
+template <typename Encoder, typename Decoder>
+void TestCorrupted() {
+  // The last quarter of the interval is not covered by the CDF, so the all-ones
+  // bitstream cannot be decoded with it.
+  const std::vector<int32> cdf = {0, 2, 3};
+  std::vector<int16> table(4);
+  MakeDecodeTable(cdf, 2, absl::MakeSpan(table));
+  const tensorflow::tstring ones(8, '\xff');
+
+  Decoder decoder(ones);
+  EXPECT_FALSE(decoder.corrupted());
+  EXPECT_EQ(decoder.Decode(cdf, 2), 1);
+  EXPECT_TRUE(decoder.corrupted());
+  // The flag is sticky.
+  decoder.Decode({0, 2, 4}, 2);
+  EXPECT_TRUE(decoder.corrupted());
+
+  Decoder table_decoder(ones);
+  EXPECT_EQ(table_decoder.Decode(cdf, table, 2, 2), 1);
+  EXPECT_TRUE(table_decoder.corrupted());
+
+  // A valid bitstream does not set the flag.
+  tensorflow::tstring valid;
+  Encoder encoder;
+  encoder.Encode(2, 4, 2, &valid);
+  encoder.EncodeUniform(3, 2, &valid);
+  encoder.Finalize(&valid);
+  Decoder valid_decoder(valid);
+  EXPECT_EQ(valid_decoder.Decode({0, 2, 4}, 2), 1);
+  EXPECT_EQ(valid_decoder.DecodeUniform(2), 3);
+  EXPECT_FALSE(valid_decoder.corrupted());
+}
+
+TEST(RangeCoderTest, Corrupted) {
+  TestCorrupted<RangeEncoder, RangeDecoder>();
+  TestCorrupted<RangeEncoder64, RangeDecoder64>();
+}
+
+TEST(RangeCoderTest, Coder64Interleaved) {
+  constexpr int kPrecision = 10;
+  const std::vector<int32> cdf = {0, 400, 700, 900, 1000, 1024};
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+
+  std::vector<int32> data(1003);
+  for (int32& x : data) {
+    x = rand.Uniform(cdf.size() - 1);
+  }
+
+  std::vector<tensorflow::tstring> lanes(4);
+  InterleavedRangeEncoder<4, RangeEncoder64> encoder(absl::MakeSpan(lanes));
+  for (int32 x : data) {
+    encoder.Encode(cdf[x], cdf[x + 1], kPrecision);
+  }
+  encoder.Finalize();
+
+  std::vector<absl::string_view> views(lanes.begin(), lanes.end());
+  InterleavedRangeDecoder<4, RangeDecoder64> decoder(views);
+  for (int i = 0; i < data.size(); ++i) {
+    ASSERT_EQ(decoder.Decode(cdf, kPrecision), data[i]) << i;
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow_compression
 
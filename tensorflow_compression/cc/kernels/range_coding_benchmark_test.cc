@@ -0,0 +1,620 @@
+/* Copyright 2020 Google LLC. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks for the range coder and the range coding kernels.
+//
+// Run with --benchmarks=<regex>, e.g., --benchmarks=BM_RangeEncoder.* or
+// --benchmarks=all. Each benchmark reports symbols/s as items/s, and the
+// encoded bytes/s. The op benchmarks also report the number of heap
+// allocations per run of the graph as the label.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "tensorflow/core/common_runtime/graph_runner.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/random/distribution_sampler.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/stacktrace_handler.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow_compression/cc/kernels/range_coder.h"
+
+namespace {
+// The number of calls to the global operator new below.
+std::atomic<tensorflow::int64> num_allocations{0};
+}  // namespace
+
+void* operator new(std::size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = std::malloc(size > 0 ? size : 1);
+  if (pointer == nullptr) {
+    std::abort();
+  }
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace tensorflow_compression {
+namespace {
+namespace random = tensorflow::random;
+namespace test = tensorflow::test;
+namespace testing = tensorflow::testing;
+using tensorflow::DT_FLOAT;
+using tensorflow::DT_INT16;
+using tensorflow::DT_INT32;
+using tensorflow::Graph;
+using tensorflow::int16;
+using tensorflow::int32;
+using tensorflow::int64;
+using tensorflow::Node;
+using tensorflow::NodeBuilder;
+using tensorflow::OpRegistry;
+using tensorflow::Tensor;
+using tensorflow::TensorShape;
+using tensorflow::tstring;
+
+// Returns probability weights that decay geometrically, so that the entropy
+// is well below log2(alphabet_size) as for typical quantized latents.
+std::vector<float> MakeWeights(int alphabet_size) {
+  std::vector<float> weights(alphabet_size);
+  float weight = 1;
+  for (float& w : weights) {
+    w = weight;
+    weight *= 0.8f;
+  }
+  return weights;
+}
+
+// Quantizes `weights` to a CDF with `precision` bits, giving every symbol a
+// nonzero mass.
+std::vector<int32> MakeCdf(absl::Span<const float> weights, int precision) {
+  const int32 total = 1 << precision;
+  CHECK_LE(weights.size(), total);
+  double sum = 0;
+  for (float w : weights) sum += w;
+
+  std::vector<int32> cdf(weights.size() + 1);
+  double cumulative = 0;
+  for (size_t i = 0; i < weights.size(); ++i) {
+    cumulative += weights[i];
+    cdf[i + 1] = i + 1 +
+                 std::lrint(cumulative / sum * (total - weights.size()));
+  }
+  cdf.back() = total;
+  return cdf;
+}
+
+std::vector<int32> SampleSymbols(absl::Span<const float> weights, int64 size,
+                                 random::SimplePhilox* gen) {
+  random::DistributionSampler sampler(weights);
+  std::vector<int32> symbols(size);
+  for (int32& x : symbols) {
+    x = sampler.Sample(gen);
+  }
+  return symbols;
+}
+
+// Evaluates the first output of `node`.
+Tensor Evaluate(Graph* graph, Node* node) {
+  tensorflow::GraphRunner runner(tensorflow::Env::Default());
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(runner.Run(graph, nullptr, {}, {node->name()}, &outputs));
+  return outputs[0];
+}
+
+// Runs the benchmark of `graph`, and reports the heap allocations per
+// iteration as the label. The count includes the allocations of the executor,
+// which are the same for all kernels, and the warmup runs.
+void RunBenchmark(Graph* graph, int iters) {
+  test::Benchmark benchmark("cpu", graph);
+  const int64 start = num_allocations.load(std::memory_order_relaxed);
+  benchmark.Run(iters);
+  const int64 count = num_allocations.load(std::memory_order_relaxed) - start;
+  testing::SetLabel(absl::StrCat("allocs/iter=", count / std::max(iters, 1)));
+}
+
+constexpr int64 kNumSymbols = 1 << 16;
+
+template <typename Encoder>
+void RangeEncoderBenchmark(int iters, int precision, int alphabet_size) {
+  testing::StopTiming();
+  random::PhiloxRandom philox(0, 0);
+  random::SimplePhilox gen(&philox);
+  const std::vector<float> weights = MakeWeights(alphabet_size);
+  const std::vector<int32> cdf = MakeCdf(weights, precision);
+  const std::vector<int32> data = SampleSymbols(weights, kNumSymbols, &gen);
+
+  tstring encoded;
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    encoded.clear();
+    Encoder encoder;
+    for (const int32 x : data) {
+      encoder.Encode(cdf[x], cdf[x + 1], precision, &encoded);
+    }
+    encoder.Finalize(&encoded);
+  }
+  testing::StopTiming();
+  testing::ItemsProcessed(static_cast<int64>(iters) * data.size());
+  testing::BytesProcessed(static_cast<int64>(iters) * encoded.size());
+}
+
+void BM_RangeEncoder(int iters, int precision, int alphabet_size) {
+  RangeEncoderBenchmark<RangeEncoder>(iters, precision, alphabet_size);
+}
+BENCHMARK(BM_RangeEncoder)
+    ->ArgPair(12, 16)
+    ->ArgPair(12, 256)
+    ->ArgPair(16, 16)
+    ->ArgPair(16, 256);
+
+void BM_RangeEncoder64(int iters, int precision, int alphabet_size) {
+  RangeEncoderBenchmark<RangeEncoder64>(iters, precision, alphabet_size);
+}
+BENCHMARK(BM_RangeEncoder64)
+    ->ArgPair(12, 16)
+    ->ArgPair(12, 256)
+    ->ArgPair(16, 16)
+    ->ArgPair(16, 256);
+
+template <typename Encoder, typename Decoder>
+void RangeDecoderBenchmark(int iters, int precision, int alphabet_size) {
+  testing::StopTiming();
+  random::PhiloxRandom philox(0, 0);
+  random::SimplePhilox gen(&philox);
+  const std::vector<float> weights = MakeWeights(alphabet_size);
+  const std::vector<int32> cdf = MakeCdf(weights, precision);
+  const std::vector<int32> data = SampleSymbols(weights, kNumSymbols, &gen);
+
+  tstring encoded;
+  Encoder encoder;
+  for (const int32 x : data) {
+    encoder.Encode(cdf[x], cdf[x + 1], precision, &encoded);
+  }
+  encoder.Finalize(&encoded);
+
+  int32 checksum = 0;
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Decoder decoder(encoded);
+    for (int64 j = 0; j < kNumSymbols; ++j) {
+      checksum += decoder.Decode(cdf, precision);
+    }
+  }
+  testing::StopTiming();
+  CHECK_NE(checksum, -1);  // Keeps the decoder loop from being optimized out.
+  testing::ItemsProcessed(static_cast<int64>(iters) * data.size());
+  testing::BytesProcessed(static_cast<int64>(iters) * encoded.size());
+}
+
+void BM_RangeDecoder(int iters, int precision, int alphabet_size) {
+  RangeDecoderBenchmark<RangeEncoder, RangeDecoder>(iters, precision,
+                                                    alphabet_size);
+}
+BENCHMARK(BM_RangeDecoder)
+    ->ArgPair(12, 16)
+    ->ArgPair(12, 256)
+    ->ArgPair(16, 16)
+    ->ArgPair(16, 256);
+
+void BM_RangeDecoder64(int iters, int precision, int alphabet_size) {
+  RangeDecoderBenchmark<RangeEncoder64, RangeDecoder64>(iters, precision,
+                                                        alphabet_size);
+}
+BENCHMARK(BM_RangeDecoder64)
+    ->ArgPair(12, 16)
+    ->ArgPair(12, 256)
+    ->ArgPair(16, 16)
+    ->ArgPair(16, 256);
+
+void BM_RangeCoderUniform(int iters, int precision) {
+  testing::StopTiming();
+  random::PhiloxRandom philox(0, 0);
+  random::SimplePhilox gen(&philox);
+  std::vector<int32> data(kNumSymbols);
+  for (int32& x : data) {
+    x = gen.Uniform(1 << precision);
+  }
+
+  tstring encoded;
+  int32 checksum = 0;
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    encoded.clear();
+    RangeEncoder encoder;
+    for (const int32 x : data) {
+      encoder.EncodeUniform(x, precision, &encoded);
+    }
+    encoder.Finalize(&encoded);
+    RangeDecoder decoder(encoded);
+    for (int64 j = 0; j < kNumSymbols; ++j) {
+      checksum += decoder.DecodeUniform(precision);
+    }
+  }
+  testing::StopTiming();
+  CHECK_NE(checksum, -1);
+  testing::ItemsProcessed(static_cast<int64>(iters) * data.size());
+  testing::BytesProcessed(static_cast<int64>(iters) * encoded.size());
+}
+BENCHMARK(BM_RangeCoderUniform)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+
+// Broadcast patterns of the CDF against data of shape [size / 64, 64] for
+// RangeEncode and RangeDecode ops.
+enum BroadcastPattern {
+  kBroadcastAll = 0,   // CDF shape [1, 1, n]: one CDF for all elements.
+  kBroadcastRows = 1,  // CDF shape [1, 64, n]: one CDF per column.
+  kBroadcastNone = 2,  // CDF shape [size / 64, 64, n]: one CDF per element.
+};
+
+constexpr int kRangeCodePrecision = 12;
+constexpr int kRangeCodeAlphabetSize = 16;
+constexpr int64 kNumColumns = 64;
+
+struct RangeCodeInputs {
+  Tensor data;
+  Tensor cdf;
+};
+
+RangeCodeInputs MakeRangeCodeInputs(int64 size, int broadcast) {
+  random::PhiloxRandom philox(0, 0);
+  random::SimplePhilox gen(&philox);
+  const std::vector<float> weights = MakeWeights(kRangeCodeAlphabetSize);
+  const std::vector<int32> cdf = MakeCdf(weights, kRangeCodePrecision);
+  const std::vector<int32> symbols = SampleSymbols(weights, size, &gen);
+
+  const int64 num_rows = size / kNumColumns;
+  RangeCodeInputs inputs;
+  inputs.data = Tensor(DT_INT16, TensorShape{num_rows, kNumColumns});
+  std::copy(symbols.begin(), symbols.end(), inputs.data.flat<int16>().data());
+
+  TensorShape cdf_shape{1, 1, static_cast<int64>(cdf.size())};
+  if (broadcast >= kBroadcastRows) cdf_shape.set_dim(1, kNumColumns);
+  if (broadcast >= kBroadcastNone) cdf_shape.set_dim(0, num_rows);
+  inputs.cdf = Tensor(DT_INT32, cdf_shape);
+  auto cdf_matrix = inputs.cdf.flat_inner_dims<int32>();
+  for (int64 i = 0; i < cdf_matrix.dimension(0); ++i) {
+    std::copy(cdf.begin(), cdf.end(), &cdf_matrix(i, 0));
+  }
+  return inputs;
+}
+
+Node* RangeEncodeNode(Graph* g, const RangeCodeInputs& inputs) {
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("range_encode"), "RangeEncode")
+                  .Input(test::graph::Constant(g, inputs.data))
+                  .Input(test::graph::Constant(g, inputs.cdf))
+                  .Attr("precision", kRangeCodePrecision)
+                  .Attr("debug_level", 0)
+                  .Finalize(g, &node));
+  return node;
+}
+
+void BM_RangeEncodeOp(int iters, int size, int broadcast) {
+  testing::StopTiming();
+  const RangeCodeInputs inputs = MakeRangeCodeInputs(size, broadcast);
+  std::unique_ptr<Graph> encode_graph(new Graph(OpRegistry::Global()));
+  const Tensor encoded =
+      Evaluate(encode_graph.get(), RangeEncodeNode(encode_graph.get(), inputs));
+
+  Graph* g = new Graph(OpRegistry::Global());
+  RangeEncodeNode(g, inputs);
+  testing::ItemsProcessed(static_cast<int64>(iters) * size);
+  testing::BytesProcessed(static_cast<int64>(iters) *
+                          encoded.scalar<tstring>()().size());
+  testing::StartTiming();
+  RunBenchmark(g, iters);
+}
+BENCHMARK(BM_RangeEncodeOp)
+    ->ArgPair(1 << 12, kBroadcastAll)
+    ->ArgPair(1 << 16, kBroadcastAll)
+    ->ArgPair(1 << 20, kBroadcastAll)
+    ->ArgPair(1 << 16, kBroadcastRows)
+    ->ArgPair(1 << 20, kBroadcastRows)
+    ->ArgPair(1 << 16, kBroadcastNone);
+
+void BM_RangeDecodeOp(int iters, int size, int broadcast) {
+  testing::StopTiming();
+  const RangeCodeInputs inputs = MakeRangeCodeInputs(size, broadcast);
+  std::unique_ptr<Graph> encode_graph(new Graph(OpRegistry::Global()));
+  const Tensor encoded =
+      Evaluate(encode_graph.get(), RangeEncodeNode(encode_graph.get(), inputs));
+
+  Tensor shape(DT_INT32, TensorShape{2});
+  shape.vec<int32>()(0) = inputs.data.dim_size(0);
+  shape.vec<int32>()(1) = inputs.data.dim_size(1);
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("range_decode"), "RangeDecode")
+                  .Input(test::graph::Constant(g, encoded))
+                  .Input(test::graph::Constant(g, shape))
+                  .Input(test::graph::Constant(g, inputs.cdf))
+                  .Attr("precision", kRangeCodePrecision)
+                  .Attr("debug_level", 0)
+                  .Finalize(g, &node));
+  testing::ItemsProcessed(static_cast<int64>(iters) * size);
+  testing::BytesProcessed(static_cast<int64>(iters) *
+                          encoded.scalar<tstring>()().size());
+  testing::StartTiming();
+  RunBenchmark(g, iters);
+}
+BENCHMARK(BM_RangeDecodeOp)
+    ->ArgPair(1 << 12, kBroadcastAll)
+    ->ArgPair(1 << 16, kBroadcastAll)
+    ->ArgPair(1 << 20, kBroadcastAll)
+    ->ArgPair(1 << 16, kBroadcastRows)
+    ->ArgPair(1 << 20, kBroadcastRows)
+    ->ArgPair(1 << 16, kBroadcastNone);
+
+constexpr int kUnboundedPrecision = 12;
+constexpr int kUnboundedAlphabetSize = 16;
+constexpr int kUnboundedNumCdfs = 8;
+constexpr int kOverflowWidth = 4;
+
+struct UnboundedInputs {
+  Tensor data;
+  Tensor index;
+  Tensor cdf;
+  Tensor cdf_size;
+  Tensor offset;
+};
+
+// Each CDF covers `kUnboundedAlphabetSize` values plus the overflow bin, and
+// `overflow_percent` percent of the values fall outside of that range.
+UnboundedInputs MakeUnboundedInputs(int64 size, int overflow_percent) {
+  random::PhiloxRandom philox(0, 0);
+  random::SimplePhilox gen(&philox);
+
+  std::vector<float> weights = MakeWeights(kUnboundedAlphabetSize);
+  float sum = 0;
+  for (float w : weights) sum += w;
+  weights.push_back(std::max(sum * overflow_percent / 100, 1e-3f));
+  const std::vector<int32> cdf = MakeCdf(weights, kUnboundedPrecision);
+  random::DistributionSampler sampler(MakeWeights(kUnboundedAlphabetSize));
+
+  UnboundedInputs inputs;
+  inputs.cdf = Tensor(DT_INT32, TensorShape{kUnboundedNumCdfs,
+                                            static_cast<int64>(cdf.size())});
+  inputs.cdf_size = Tensor(DT_INT32, TensorShape{kUnboundedNumCdfs});
+  inputs.offset = Tensor(DT_INT32, TensorShape{kUnboundedNumCdfs});
+  auto cdf_matrix = inputs.cdf.matrix<int32>();
+  for (int64 i = 0; i < kUnboundedNumCdfs; ++i) {
+    std::copy(cdf.begin(), cdf.end(), &cdf_matrix(i, 0));
+    inputs.cdf_size.vec<int32>()(i) = cdf.size();
+    inputs.offset.vec<int32>()(i) = -kUnboundedAlphabetSize / 2;
+  }
+
+  const TensorShape shape{size / kNumColumns, kNumColumns};
+  inputs.data = Tensor(DT_INT32, shape);
+  inputs.index = Tensor(DT_INT32, shape);
+  auto data = inputs.data.flat<int32>();
+  auto index = inputs.index.flat<int32>();
+  for (int64 i = 0; i < size; ++i) {
+    index(i) = gen.Uniform(kUnboundedNumCdfs);
+    if (gen.Uniform(100) < overflow_percent) {
+      // Overflows are spread over a few hundred values on both sides.
+      const int32 magnitude = 1 + gen.Uniform(256);
+      data(i) = gen.Uniform(2) ? kUnboundedAlphabetSize / 2 + magnitude
+                               : -kUnboundedAlphabetSize / 2 - magnitude;
+    } else {
+      data(i) = sampler.Sample(&gen) - kUnboundedAlphabetSize / 2;
+    }
+  }
+  return inputs;
+}
+
+Node* UnboundedIndexRangeEncodeNode(Graph* g, const UnboundedInputs& inputs) {
+  Node* node;
+  TF_CHECK_OK(
+      NodeBuilder(g->NewName("encode"), "UnboundedIndexRangeEncode")
+          .Input(test::graph::Constant(g, inputs.data))
+          .Input(test::graph::Constant(g, inputs.index))
+          .Input(test::graph::Constant(g, inputs.cdf))
+          .Input(test::graph::Constant(g, inputs.cdf_size))
+          .Input(test::graph::Constant(g, inputs.offset))
+          .Attr("precision", kUnboundedPrecision)
+          .Attr("overflow_width", kOverflowWidth)
+          .Attr("debug_level", 0)
+          .Finalize(g, &node));
+  return node;
+}
+
+void BM_UnboundedIndexRangeEncodeOp(int iters, int size,
+                                    int overflow_percent) {
+  testing::StopTiming();
+  const UnboundedInputs inputs = MakeUnboundedInputs(size, overflow_percent);
+  std::unique_ptr<Graph> encode_graph(new Graph(OpRegistry::Global()));
+  const Tensor encoded =
+      Evaluate(encode_graph.get(),
+               UnboundedIndexRangeEncodeNode(encode_graph.get(), inputs));
+
+  Graph* g = new Graph(OpRegistry::Global());
+  UnboundedIndexRangeEncodeNode(g, inputs);
+  testing::ItemsProcessed(static_cast<int64>(iters) * size);
+  testing::BytesProcessed(static_cast<int64>(iters) *
+                          encoded.scalar<tstring>()().size());
+  testing::StartTiming();
+  RunBenchmark(g, iters);
+}
+BENCHMARK(BM_UnboundedIndexRangeEncodeOp)
+    ->ArgPair(1 << 12, 0)
+    ->ArgPair(1 << 16, 0)
+    ->ArgPair(1 << 20, 0)
+    ->ArgPair(1 << 16, 1)
+    ->ArgPair(1 << 16, 10)
+    ->ArgPair(1 << 16, 50);
+
+void BM_UnboundedIndexRangeDecodeOp(int iters, int size,
+                                    int overflow_percent) {
+  testing::StopTiming();
+  const UnboundedInputs inputs = MakeUnboundedInputs(size, overflow_percent);
+  std::unique_ptr<Graph> encode_graph(new Graph(OpRegistry::Global()));
+  const Tensor encoded =
+      Evaluate(encode_graph.get(),
+               UnboundedIndexRangeEncodeNode(encode_graph.get(), inputs));
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* node;
+  TF_CHECK_OK(
+      NodeBuilder(g->NewName("decode"), "UnboundedIndexRangeDecode")
+          .Input(test::graph::Constant(g, encoded))
+          .Input(test::graph::Constant(g, inputs.index))
+          .Input(test::graph::Constant(g, inputs.cdf))
+          .Input(test::graph::Constant(g, inputs.cdf_size))
+          .Input(test::graph::Constant(g, inputs.offset))
+          .Attr("precision", kUnboundedPrecision)
+          .Attr("overflow_width", kOverflowWidth)
+          .Attr("debug_level", 0)
+          .Finalize(g, &node));
+  testing::ItemsProcessed(static_cast<int64>(iters) * size);
+  testing::BytesProcessed(static_cast<int64>(iters) *
+                          encoded.scalar<tstring>()().size());
+  testing::StartTiming();
+  RunBenchmark(g, iters);
+}
+BENCHMARK(BM_UnboundedIndexRangeDecodeOp)
+    ->ArgPair(1 << 12, 0)
+    ->ArgPair(1 << 16, 0)
+    ->ArgPair(1 << 20, 0)
+    ->ArgPair(1 << 16, 1)
+    ->ArgPair(1 << 16, 10)
+    ->ArgPair(1 << 16, 50);
+
+// Decodes `num_strings` strings of kNumColumns symbols each, as when small
+// tensors are decoded one at a time, e.g., under tf.map_fn. The time and the
+// allocations are dominated by the per-string work.
+void BM_BatchedUnboundedIndexRangeDecodeOp(int iters, int num_strings,
+                                           int interleave) {
+  testing::StopTiming();
+  const UnboundedInputs inputs =
+      MakeUnboundedInputs(num_strings * kNumColumns, 1);
+  std::unique_ptr<Graph> encode_graph(new Graph(OpRegistry::Global()));
+  Node* encode_node;
+  TF_CHECK_OK(
+      NodeBuilder(encode_graph->NewName("encode"),
+                  "BatchedUnboundedIndexRangeEncode")
+          .Input(test::graph::Constant(encode_graph.get(), inputs.data))
+          .Input(test::graph::Constant(encode_graph.get(), inputs.index))
+          .Input(test::graph::Constant(encode_graph.get(), inputs.cdf))
+          .Input(test::graph::Constant(encode_graph.get(), inputs.cdf_size))
+          .Input(test::graph::Constant(encode_graph.get(), inputs.offset))
+          .Attr("precision", kUnboundedPrecision)
+          .Attr("overflow_width", kOverflowWidth)
+          .Attr("debug_level", 0)
+          .Attr("interleave", interleave)
+          .Finalize(encode_graph.get(), &encode_node));
+  const Tensor encoded = Evaluate(encode_graph.get(), encode_node);
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* node;
+  TF_CHECK_OK(
+      NodeBuilder(g->NewName("decode"), "BatchedUnboundedIndexRangeDecode")
+          .Input(test::graph::Constant(g, encoded))
+          .Input(test::graph::Constant(g, inputs.index))
+          .Input(test::graph::Constant(g, inputs.cdf))
+          .Input(test::graph::Constant(g, inputs.cdf_size))
+          .Input(test::graph::Constant(g, inputs.offset))
+          .Attr("precision", kUnboundedPrecision)
+          .Attr("overflow_width", kOverflowWidth)
+          .Attr("debug_level", 0)
+          .Attr("interleave", interleave)
+          .Finalize(g, &node));
+  int64 encoded_size = 0;
+  for (int64 i = 0; i < num_strings; ++i) {
+    encoded_size += encoded.vec<tstring>()(i).size();
+  }
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_strings *
+                          kNumColumns);
+  testing::BytesProcessed(static_cast<int64>(iters) * encoded_size);
+  testing::StartTiming();
+  RunBenchmark(g, iters);
+}
+BENCHMARK(BM_BatchedUnboundedIndexRangeDecodeOp)
+    ->ArgPair(1024, 1)
+    ->ArgPair(1024, 4);
+
+// Reports the number of PMF entries as items.
+void BM_PmfToQuantizedCdfOp(int iters, int num_pmfs, int alphabet_size) {
+  testing::StopTiming();
+  random::PhiloxRandom philox(0, 0);
+  random::SimplePhilox gen(&philox);
+  Tensor pmf(DT_FLOAT, TensorShape{num_pmfs, alphabet_size});
+  auto matrix = pmf.matrix<float>();
+  for (int64 i = 0; i < num_pmfs; ++i) {
+    float sum = 0;
+    for (int64 j = 0; j < alphabet_size; ++j) {
+      matrix(i, j) = gen.RandFloat() + 1e-3f;
+      sum += matrix(i, j);
+    }
+    for (int64 j = 0; j < alphabet_size; ++j) {
+      matrix(i, j) /= sum;
+    }
+  }
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("pmf_to_cdf"), "PmfToQuantizedCdf")
+                  .Input(test::graph::Constant(g, pmf))
+                  .Attr("precision", 16)
+                  .Finalize(g, &node));
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_pmfs *
+                          alphabet_size);
+  testing::BytesProcessed(static_cast<int64>(iters) * pmf.TotalBytes());
+  testing::StartTiming();
+  RunBenchmark(g, iters);
+}
+BENCHMARK(BM_PmfToQuantizedCdfOp)
+    ->ArgPair(1, 256)
+    ->ArgPair(64, 64)
+    ->ArgPair(64, 4096)
+    ->ArgPair(1024, 64);
+
+}  // namespace
+}  // namespace tensorflow_compression
+
+GTEST_API_ int main(int argc, char** argv) {
+  tensorflow::testing::InstallStacktraceHandler();
+  const char* pattern = "all";
+  for (int i = 1; i < argc; ++i) {
+    if (absl::StartsWith(argv[i], "--benchmarks=")) {
+      pattern = argv[i] + std::strlen("--benchmarks=");
+    }
+  }
+  tensorflow::testing::Benchmark::Run(pattern);
+  return 0;
+}
@@ -16,8 +16,8 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include <algorithm>
-#include <functional>
-#include <iterator>
+#include <cmath>
+#include <limits>
 #include <numeric>
 #include <vector>
 
@@ -27,15 +27,19 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow_compression/cc/kernels/range_coder.h"
+#include "tensorflow_compression/cc/kernels/range_coding_kernels_util.h"
 
 namespace tensorflow_compression {
 namespace {
 namespace thread = tensorflow::thread;
 using tensorflow::DEVICE_CPU;
+using tensorflow::int16;
 using tensorflow::int32;
 using tensorflow::int64;
 using tensorflow::OpKernel;
@@ -78,15 +82,9 @@ class PmfToCdfOp : public OpKernel {
     CHECK_EQ(pmf.dimension(0), cdf.dimension(0));
     CHECK_EQ(pmf.dimension(1) + 1, cdf.dimension(1));
 
+    const absl::Span<const float>::size_type pmf_size = pmf.dimension(1);
     for (int64 i = 0; i < pmf.dimension(0); ++i) {
-      for (int64 j = 0; j < pmf.dimension(1); ++j) {
-        auto value = pmf(i, j);
-        OP_REQUIRES(
-            context, std::isfinite(value) && value >= 0,
-            InvalidArgument("`pmf` has non-finite or negative element: ", value,
-                            ". Please check for numerical problems in the "
-                            "probability computation."));
-      }
+      OP_REQUIRES_OK(context, CheckPmf({&pmf(i, 0), pmf_size}));
     }
 
     const double n = pmf.dimension(1);
@@ -95,16 +93,29 @@ class PmfToCdfOp : public OpKernel {
         context->device()->tensorflow_cpu_worker_threads()->workers;
     thread_pool->ParallelFor(
         pmf.dimension(0), cost_per_unit,
-        [this, pmf, &cdf](int64 start, int64 limit) {
-          const absl::Span<const float>::size_type pmf_size = pmf.dimension(1);
+        [this, pmf, pmf_size, &cdf](int64 start, int64 limit) {
+          Scratch scratch;
           for (int64 i = start; i < limit; ++i) {
             cdf(i, 0) = 0;
-            PerShard({&pmf(i, 0), pmf_size}, {&cdf(i, 1), pmf_size});
+            PerShard({&pmf(i, 0), pmf_size}, {&cdf(i, 1), pmf_size},
+                     &scratch);
           }
         });
   }
 
- private:
+ protected:
+  static tensorflow::Status CheckPmf(absl::Span<const float> pmf) {
+    for (const float value : pmf) {
+      if (!std::isfinite(value) || value < 0) {
+        return InvalidArgument("`pmf` has non-finite or negative element: ",
+                               value,
+                               ". Please check for numerical problems in the "
+                               "probability computation.");
+      }
+    }
+    return tensorflow::Status::OK();
+  }
+
   struct PenaltyItem {
     PenaltyItem(int32* p, double mass) : pointer(p), mass(mass) {
       penalty = ComputeNextPenalty();
@@ -160,52 +171,67 @@ class PmfToCdfOp : public OpKernel {
     double gain;
   };
 
-  void PerShard(absl::Span<const float> pmf, absl::Span<int32> cdf) const {
+  // The heaps of PerShard(), which are reused for all rows of a shard instead
+  // of being allocated for each row.
+  struct Scratch {
+    std::vector<PenaltyItem> penalty_queue;
+    std::vector<GainItem> gain_queue;
+  };
+
+  void PerShard(absl::Span<const float> pmf, absl::Span<int32> cdf,
+                Scratch* scratch) const {
     CHECK_EQ(pmf.size(), cdf.size());
 
+    // Kept free of branches and function calls other than rint(), so that the
+    // compiler can vectorize it.
     const int32 normalizer = 1 << precision_;
-    std::transform(pmf.begin(), pmf.end(), cdf.begin(),
-                   [normalizer](float mass) {
-                     int32 value = std::rint(mass * normalizer);
-                     // NOTE: Consider checking if mass > 0.
-                     value = std::max(value, 1);
-                     return value;
-                   });
+    const absl::Span<int32>::size_type size = cdf.size();
+    for (absl::Span<int32>::size_type i = 0; i < size; ++i) {
+      const int32 value = std::rint(pmf[i] * normalizer);
+      // NOTE: Consider checking if mass > 0.
+      cdf[i] = std::max(value, 1);
+    }
 
+    // The rounding error is fixed one unit at a time, each time taking the
+    // unit from (or giving it to) the element where it costs (or gains) the
+    // most in terms of cross entropy. The elements are kept in a binary heap,
+    // so that this takes O(log n) time per unit.
     int32 sum = std::accumulate(cdf.begin(), cdf.end(), 0);
     if (sum > normalizer) {
-      std::vector<PenaltyItem> queue;
+      std::vector<PenaltyItem>& queue = scratch->penalty_queue;
+      queue.clear();
       queue.reserve(cdf.size());
       for (absl::Span<int32>::size_type i = 0; i < cdf.size(); ++i) {
         queue.emplace_back(&cdf[i], pmf[i]);
       }
 
-      std::sort(queue.begin(), queue.end());
+      // Min-heap, i.e., the item with the smallest penalty is at the front.
+      auto compare = [](const PenaltyItem& lhs, const PenaltyItem& rhs) {
+        return rhs < lhs;
+      };
+      std::make_heap(queue.begin(), queue.end(), compare);
       while (sum-- > normalizer) {
-        queue[0].Decrease();
-        // Performs a linear search because this find_if is likely to return
-        // iterator very close to the begin.
-        auto iter = std::find_if(
-            std::next(queue.begin()), queue.end(),
-            [&queue](const PenaltyItem& rhs) { return queue[0] < rhs; });
-        std::rotate(queue.begin(), std::next(queue.begin()), iter);
+        std::pop_heap(queue.begin(), queue.end(), compare);
+        queue.back().Decrease();
+        std::push_heap(queue.begin(), queue.end(), compare);
       }
     } else if (sum < normalizer) {
-      std::vector<GainItem> queue;
+      std::vector<GainItem>& queue = scratch->gain_queue;
+      queue.clear();
       queue.reserve(cdf.size());
       for (absl::Span<int32>::size_type i = 0; i < cdf.size(); ++i) {
         queue.emplace_back(&cdf[i], pmf[i]);
       }
 
-      std::sort(queue.begin(), queue.end(), std::greater<GainItem>());
+      // Max-heap, i.e., the item with the largest gain is at the front.
+      auto compare = [](const GainItem& lhs, const GainItem& rhs) {
+        return rhs > lhs;
+      };
+      std::make_heap(queue.begin(), queue.end(), compare);
       while (sum++ < normalizer) {
-        queue[0].Increase();
-        // Performs a linear search because this find_if is likely to return
-        // iterator very close to the begin.
-        auto iter = std::find_if(
-            std::next(queue.begin()), queue.end(),
-            [&queue](const GainItem& rhs) { return queue[0] > rhs; });
-        std::rotate(queue.begin(), std::next(queue.begin()), iter);
+        std::pop_heap(queue.begin(), queue.end(), compare);
+        queue.back().Increase();
+        std::push_heap(queue.begin(), queue.end(), compare);
       }
     }
     std::partial_sum(cdf.begin(), cdf.end(), cdf.begin());
@@ -217,5 +243,146 @@ class PmfToCdfOp : public OpKernel {
 REGISTER_KERNEL_BUILDER(Name("PmfToQuantizedCdf").Device(DEVICE_CPU),
                         PmfToCdfOp);
 
+// Also the kernel of BatchedPmfToQuantizedCdfWithOverflow op, which has the
+// overflow masses as an extra input.
+class BatchedPmfToCdfOp : public PmfToCdfOp {
+ public:
+  explicit BatchedPmfToCdfOp(OpKernelConstruction* context)
+      : PmfToCdfOp(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& pmf_tensor = context->input(0);
+    const Tensor& pmf_length_tensor = context->input(1);
+
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(pmf_tensor.shape()),
+                InvalidArgument("`pmf` should be 2-D: ", pmf_tensor.shape()));
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(pmf_length_tensor.shape()) &&
+                    pmf_length_tensor.dim_size(0) == pmf_tensor.dim_size(0),
+                InvalidArgument("`pmf_length` should be 1-D and its length "
+                                "should match the number of rows in `pmf`: ",
+                                pmf_length_tensor.shape()));
+
+    // The overflow mass of each row, if any, is appended to its PMF.
+    const float* overflow = nullptr;
+    if (context->num_inputs() > 2) {
+      const Tensor& overflow_tensor = context->input(2);
+      OP_REQUIRES(context,
+                  TensorShapeUtils::IsVector(overflow_tensor.shape()) &&
+                      overflow_tensor.dim_size(0) == pmf_tensor.dim_size(0),
+                  InvalidArgument("`overflow` should be 1-D and its length "
+                                  "should match the number of rows in `pmf`: ",
+                                  overflow_tensor.shape()));
+      overflow = overflow_tensor.vec<float>().data();
+      OP_REQUIRES_OK(context, CheckPmf(absl::MakeConstSpan(
+                                  overflow, overflow_tensor.NumElements())));
+    }
+
+    // With the overflow mass appended, a single symbol is a valid PMF.
+    const int32 min_length = (overflow != nullptr) ? 1 : 2;
+    auto pmf = pmf_tensor.matrix<float>();
+    auto pmf_length = pmf_length_tensor.vec<int32>();
+    const int64 max_length = pmf.dimension(1);
+    for (int64 i = 0; i < pmf.dimension(0); ++i) {
+      const int32 length = pmf_length(i);
+      OP_REQUIRES(context, min_length <= length && length <= max_length,
+                  InvalidArgument("`pmf_length` has a value not in [",
+                                  min_length, ", ", max_length,
+                                  "]: value=", length));
+      OP_REQUIRES_OK(context,
+                     CheckPmf(absl::MakeConstSpan(&pmf(i, 0), length)));
+    }
+
+    const int64 cdf_width = max_length + (overflow != nullptr ? 2 : 1);
+    const TensorShape shape{pmf.dimension(0), cdf_width};
+    Tensor* cdf_tensor;
+    OP_REQUIRES_OK(context, context->allocate_output(0, shape, &cdf_tensor));
+    auto cdf = cdf_tensor->matrix<int32>();
+
+    const double n = max_length;
+    const int64 cost_per_unit = static_cast<int64>(50.0 * n * std::log2(n));
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        pmf.dimension(0), cost_per_unit,
+        [this, pmf, pmf_length, overflow, cdf_width, &cdf](int64 start,
+                                                           int64 limit) {
+          Scratch scratch;
+          std::vector<float> row;
+          for (int64 i = start; i < limit; ++i) {
+            absl::Span<const float> pmf_row(&pmf(i, 0), pmf_length(i));
+            if (overflow != nullptr) {
+              row.assign(pmf_row.begin(), pmf_row.end());
+              row.push_back(overflow[i]);
+              pmf_row = row;
+            }
+            const auto length = pmf_row.size();
+            cdf(i, 0) = 0;
+            PerShard(pmf_row, {&cdf(i, 1), length}, &scratch);
+            std::fill(&cdf(i, 0) + length + 1, &cdf(i, 0) + cdf_width, 0);
+          }
+        });
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("BatchedPmfToQuantizedCdf").Device(DEVICE_CPU),
+                        BatchedPmfToCdfOp);
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedPmfToQuantizedCdfWithOverflow").Device(DEVICE_CPU),
+    BatchedPmfToCdfOp);
+
+class CdfToDecodeTableOp : public OpKernel {
+ public:
+  explicit CdfToDecodeTableOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("precision", &precision_));
+    OP_REQUIRES(
+        context, 0 < precision_ && precision_ <= 16,
+        InvalidArgument("`precision` must be in [1, 16]: ", precision_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& cdf_tensor = context->input(0);
+
+    TensorShape shape = cdf_tensor.shape();
+    OP_REQUIRES(context, TensorShapeUtils::IsVectorOrHigher(shape),
+                InvalidArgument("`cdf` should be at least 1-D."));
+    const int64 cdf_width = shape.dim_size(shape.dims() - 1);
+    OP_REQUIRES(context, 2 <= cdf_width && cdf_width <= (1 << 15),
+                InvalidArgument("`cdf` size in the last axis should be in "
+                                "[2, 2^15]: ",
+                                cdf_width));
+    const int table_bits = std::min(precision_, kMaxDecodeTableBits);
+    shape.set_dim(shape.dims() - 1, 1 << table_bits);
+
+    Tensor* table_tensor;
+    OP_REQUIRES_OK(context, context->allocate_output(0, shape, &table_tensor));
+
+    auto cdf = cdf_tensor.flat_inner_dims<int32, 2>();
+    auto table = table_tensor->flat_inner_dims<int16, 2>();
+    CHECK_EQ(cdf.dimension(0), table.dimension(0));
+
+    const int64 cost_per_unit = 2 * (cdf_width + table.dimension(1));
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        cdf.dimension(0), cost_per_unit,
+        [this, cdf, &table](int64 start, int64 limit) {
+          const absl::Span<const int32>::size_type cdf_size = cdf.dimension(1);
+          const absl::Span<int16>::size_type table_size = table.dimension(1);
+          for (int64 i = start; i < limit; ++i) {
+            MakeDecodeTable({&cdf(i, 0), cdf_size}, precision_,
+                            {&table(i, 0), table_size});
+          }
+        });
+  }
+
+ private:
+  int precision_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("CdfToDecodeTable").Device(DEVICE_CPU),
+                        CdfToDecodeTableOp);
+
 }  // namespace
 }  // namespace tensorflow_compression
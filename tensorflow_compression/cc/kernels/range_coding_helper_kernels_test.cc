@@ -35,6 +35,9 @@ namespace tensorflow_compression {
 namespace {
 namespace random = tensorflow::random;
 using tensorflow::DT_FLOAT;
+using tensorflow::DT_INT32;
+using tensorflow::int32;
+using tensorflow::int64;
 using tensorflow::NodeDefBuilder;
 using tensorflow::OpsTestBase;
 using tensorflow::ShapeInferenceTestOp;
@@ -141,6 +144,128 @@ TEST_F(PmfToQuantizedCdfOpTest, OverSum) {
   Verify(kPrecision, pmf, *GetOutput(0));
 }
 
+TEST_F(PmfToQuantizedCdfOpTest, Batched) {
+  constexpr int kPrecision = 10;
+  constexpr int kRows = 20;
+  constexpr int kMaxLength = 64;
+
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+
+  Tensor pmf(DT_FLOAT, {kRows, kMaxLength});
+  Tensor pmf_length(DT_INT32, {kRows});
+  auto matrix = pmf.matrix<float>();
+  for (int64 i = 0; i < kRows; ++i) {
+    const int32 length = 2 + rand.Uniform(kMaxLength - 1);
+    pmf_length.vec<int32>()(i) = length;
+    GenerateData(&rand, {&matrix(i, 0), static_cast<std::size_t>(length)});
+    // Padding should be ignored, even if it is not a valid probability.
+    std::fill(&matrix(i, 0) + length, &matrix(i, 0) + kMaxLength, -1.0f);
+  }
+
+  TF_ASSERT_OK(NodeDefBuilder("pmf_to_cdf", "BatchedPmfToQuantizedCdf")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT32))
+                   .Attr("precision", kPrecision)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&pmf);
+  inputs_.emplace_back(&pmf_length);
+  TF_ASSERT_OK(RunOpKernel());
+  const Tensor cdf = *GetOutput(0);
+  ASSERT_EQ(cdf.shape(), (TensorShape{kRows, kMaxLength + 1}));
+
+  // Each row should be identical to the output of the unbatched op.
+  for (int64 i = 0; i < kRows; ++i) {
+    const int32 length = pmf_length.vec<int32>()(i);
+    Tensor row(DT_FLOAT, {length});
+    std::copy_n(&matrix(i, 0), length, row.flat<float>().data());
+    SetupOp(kPrecision, &row);
+    TF_ASSERT_OK(RunOpKernel());
+    auto expected = GetOutput(0)->vec<int32>();
+    for (int j = 0; j <= kMaxLength; ++j) {
+      EXPECT_EQ(cdf.matrix<int32>()(i, j), j <= length ? expected(j) : 0)
+          << "i=" << i << ", j=" << j;
+    }
+  }
+}
+
+TEST_F(PmfToQuantizedCdfOpTest, BatchedWithOverflow) {
+  constexpr int kPrecision = 12;
+  constexpr int kRows = 10;
+  constexpr int kMaxLength = 32;
+
+  std::random_device rd;
+  random::PhiloxRandom gen(rd(), rd());
+  random::SimplePhilox rand(&gen);
+
+  Tensor pmf(DT_FLOAT, {kRows, kMaxLength});
+  Tensor pmf_length(DT_INT32, {kRows});
+  Tensor overflow(DT_FLOAT, {kRows});
+  auto matrix = pmf.matrix<float>();
+  for (int64 i = 0; i < kRows; ++i) {
+    const int32 length = 2 + rand.Uniform(kMaxLength - 1);
+    pmf_length.vec<int32>()(i) = length;
+    GenerateData(&rand, {&matrix(i, 0), static_cast<std::size_t>(length)});
+    std::fill(&matrix(i, 0) + length, &matrix(i, 0) + kMaxLength, -1.0f);
+    overflow.vec<float>()(i) = 0.01f * rand.RandFloat();
+  }
+
+  TF_ASSERT_OK(
+      NodeDefBuilder("pmf_to_cdf", "BatchedPmfToQuantizedCdfWithOverflow")
+          .Input(FakeInput(DT_FLOAT))
+          .Input(FakeInput(DT_INT32))
+          .Input(FakeInput(DT_FLOAT))
+          .Attr("precision", kPrecision)
+          .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&pmf);
+  inputs_.emplace_back(&pmf_length);
+  inputs_.emplace_back(&overflow);
+  TF_ASSERT_OK(RunOpKernel());
+  const Tensor cdf = *GetOutput(0);
+  ASSERT_EQ(cdf.shape(), (TensorShape{kRows, kMaxLength + 2}));
+
+  // Each row should match the unbatched op applied to the concatenated PMF.
+  for (int64 i = 0; i < kRows; ++i) {
+    const int32 length = pmf_length.vec<int32>()(i);
+    Tensor row(DT_FLOAT, {length + 1});
+    std::copy_n(&matrix(i, 0), length, row.flat<float>().data());
+    row.flat<float>()(length) = overflow.vec<float>()(i);
+    SetupOp(kPrecision, &row);
+    TF_ASSERT_OK(RunOpKernel());
+    auto expected = GetOutput(0)->vec<int32>();
+    for (int j = 0; j <= kMaxLength + 1; ++j) {
+      EXPECT_EQ(cdf.matrix<int32>()(i, j), j <= length + 1 ? expected(j) : 0)
+          << "i=" << i << ", j=" << j;
+    }
+  }
+}
+
+TEST_F(PmfToQuantizedCdfOpTest, BatchedInvalidLength) {
+  Tensor pmf(DT_FLOAT, {2, 4});
+  pmf.flat<float>().setConstant(0.25f);
+
+  for (const int32 length : {1, 5}) {
+    Tensor pmf_length(DT_INT32, {2});
+    pmf_length.vec<int32>().setValues({4, length});
+
+    TF_ASSERT_OK(NodeDefBuilder("pmf_to_cdf", "BatchedPmfToQuantizedCdf")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Attr("precision", 8)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    inputs_.clear();
+    inputs_.emplace_back(&pmf);
+    inputs_.emplace_back(&pmf_length);
+    EXPECT_FALSE(RunOpKernel().ok());
+  }
+}
+
 TEST_F(PmfToQuantizedCdfOpTest, ShapeFn) {
   ShapeInferenceTestOp op("PmfToQuantizedCdf");
 
@@ -150,6 +275,26 @@ TEST_F(PmfToQuantizedCdfOpTest, ShapeFn) {
   INFER_OK(op, "[3,4,5]", "[d0_0,d0_1,6]");
 }
 
+TEST_F(PmfToQuantizedCdfOpTest, BatchedShapeFn) {
+  ShapeInferenceTestOp op("BatchedPmfToQuantizedCdf");
+
+  INFER_OK(op, "?;?", "[?,?]");
+  INFER_OK(op, "[3,4];?", "[d0_0,5]");
+  INFER_OK(op, "[?,4];[3]", "[d1_0,5]");
+  INFER_ERROR("Shape must be rank 2", op, "[3];?");
+  INFER_ERROR("Dimensions must be equal", op, "[3,4];[2]");
+}
+
+TEST_F(PmfToQuantizedCdfOpTest, BatchedWithOverflowShapeFn) {
+  ShapeInferenceTestOp op("BatchedPmfToQuantizedCdfWithOverflow");
+
+  INFER_OK(op, "?;?;?", "[?,?]");
+  INFER_OK(op, "[3,4];?;?", "[d0_0,6]");
+  INFER_OK(op, "[?,4];?;[3]", "[d2_0,6]");
+  INFER_ERROR("Shape must be rank 1", op, "[3,4];[3];[3,1]");
+  INFER_ERROR("Dimensions must be equal", op, "[3,4];[3];[2]");
+}
+
 }  // namespace
 }  // namespace tensorflow_compression
 
@@ -21,6 +21,7 @@ limitations under the License.
 #include <type_traits>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -33,11 +34,13 @@ limitations under the License.
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_compression/cc/kernels/range_coder.h"
 #include "tensorflow_compression/cc/kernels/range_coding_kernels_util.h"
+#include "tensorflow_compression/cc/kernels/range_coding_metrics.h"
 
 namespace tensorflow_compression {
 namespace {
 namespace errors = tensorflow::errors;
 using tensorflow::DEVICE_CPU;
+using tensorflow::DEVICE_GPU;
 using tensorflow::int16;
 using tensorflow::int32;
 using tensorflow::int64;
@@ -175,6 +178,11 @@ tensorflow::Status CheckCdfValues(int precision,
   return tensorflow::Status::OK();
 }
 
+bool IsValidInterleave(int interleave) {
+  return interleave == 1 || interleave == 2 || interleave == 4 ||
+         interleave == 8;
+}
+
 class RangeEncodeOp : public OpKernel {
  public:
   explicit RangeEncodeOp(OpKernelConstruction* context) : OpKernel(context) {
@@ -186,19 +194,26 @@ class RangeEncodeOp : public OpKernel {
     OP_REQUIRES(context, debug_level_ == 0 || debug_level_ == 1,
                 errors::InvalidArgument("`debug_level` must be 0 or 1: ",
                                         debug_level_));
+    OP_REQUIRES_OK(context, context->GetAttr("interleave", &interleave_));
+    OP_REQUIRES(context, IsValidInterleave(interleave_),
+                errors::InvalidArgument("`interleave` must be 1, 2, 4, or 8: ",
+                                        interleave_));
   }
 
   void Compute(OpKernelContext* context) override {
     const Tensor& data = context->input(0);
     const Tensor& cdf = context->input(1);
 
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
     OP_REQUIRES_OK(context, CheckCdfShape(data.shape(), cdf.shape()));
 
     if (debug_level_ > 0) {
       OP_REQUIRES_OK(context, CheckCdfValues(precision_, cdf));
     }
 
-    std::vector<int64> data_shape, cdf_shape;
+    MergedShape data_shape, cdf_shape;
     OP_REQUIRES_OK(
         context, MergeAxes(data.shape(), cdf.shape(), &data_shape, &cdf_shape));
 
@@ -206,14 +221,17 @@ class RangeEncodeOp : public OpKernel {
     OP_REQUIRES_OK(context,
                    context->allocate_output(0, TensorShape{}, &output_tensor));
     tstring* output = &output_tensor->scalar<tstring>()();
+    validation.Stop();
 
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
     switch (data_shape.size()) {
 #define RANGE_ENCODE_CASE(dims)                                           \
   case dims: {                                                            \
     OP_REQUIRES_OK(context,                                               \
                    RangeEncodeImpl<dims>(data.flat<int16>(), data_shape,  \
                                          cdf.flat_inner_dims<int32, 2>(), \
-                                         cdf_shape, output));             \
+                                         cdf_shape, output, &metrics));   \
   } break
       RANGE_ENCODE_CASE(1);
       RANGE_ENCODE_CASE(2);
@@ -228,6 +246,8 @@ class RangeEncodeOp : public OpKernel {
             cdf.shape().DebugString()));
         return;
     }
+    metrics.AddSymbols(data.NumElements());
+    metrics.AddBytes(output->size());
   }
 
  private:
@@ -236,45 +256,124 @@ class RangeEncodeOp : public OpKernel {
                                      absl::Span<const int64> data_shape,
                                      TTypes<int32>::ConstMatrix cdf,
                                      absl::Span<const int64> cdf_shape,
-                                     tstring* output) const {
+                                     tstring* output,
+                                     RangeCodingMetrics* metrics) const {
+    switch (interleave_) {
+      case 1:
+        return RangeEncodePrecision<N, 1>(data, data_shape, cdf, cdf_shape,
+                                            output, metrics);
+      case 2:
+        return RangeEncodePrecision<N, 2>(data, data_shape, cdf, cdf_shape,
+                                            output, metrics);
+      case 4:
+        return RangeEncodePrecision<N, 4>(data, data_shape, cdf, cdf_shape,
+                                            output, metrics);
+      case 8:
+        return RangeEncodePrecision<N, 8>(data, data_shape, cdf, cdf_shape,
+                                            output, metrics);
+      default:
+        return errors::Internal("Unexpected interleave: ", interleave_);
+    }
+  }
+
+  // Specializes the coding loop for the commonly used precisions.
+  template <int N, int kNumLanes>
+  tensorflow::Status RangeEncodePrecision(TTypes<int16>::ConstFlat data,
+                                          absl::Span<const int64> data_shape,
+                                          TTypes<int32>::ConstMatrix cdf,
+                                          absl::Span<const int64> cdf_shape,
+                                          tstring* output,
+                                          RangeCodingMetrics* metrics) const {
+    switch (precision_) {
+#define RANGE_ENCODE_PRECISION_CASE(p)                                      \
+  case p:                                                                   \
+    return RangeEncodeLanes<N, kNumLanes>(data, data_shape, cdf, cdf_shape, \
+                                          StaticPrecision<p>(), output,     \
+                                          metrics);
+      RANGE_ENCODE_PRECISION_CASE(12);
+      RANGE_ENCODE_PRECISION_CASE(14);
+      RANGE_ENCODE_PRECISION_CASE(15);
+      RANGE_ENCODE_PRECISION_CASE(16);
+#undef RANGE_ENCODE_PRECISION_CASE
+      default:
+        return RangeEncodeLanes<N, kNumLanes>(data, data_shape, cdf, cdf_shape,
+                                              precision_, output, metrics);
+    }
+  }
+
+  template <int N, int kNumLanes, typename Precision>
+  tensorflow::Status RangeEncodeLanes(TTypes<int16>::ConstFlat data,
+                                      absl::Span<const int64> data_shape,
+                                      TTypes<int32>::ConstMatrix cdf,
+                                      absl::Span<const int64> cdf_shape,
+                                      Precision precision, tstring* output,
+                                      RangeCodingMetrics* metrics) const {
     const int64 data_size = data.size();
     const int64 cdf_size = cdf.size();
     const int64 chip_size = cdf.dimension(1);
 
     BroadcastRange<const int16, int32, N> view{data.data(), data_shape,
                                                cdf.data(), cdf_shape};
-    RangeEncoder encoder;
-    for (int64 linear = 0; linear < data_size; ++linear) {
-      const auto pair = view.Next();
-
-      const int64 index = *pair.first;
-      if (debug_level_ > 0) {
-        if (index < 0 || chip_size <= index + 1) {
-          return errors::InvalidArgument("'data' value not in [0, ",
-                                         chip_size - 1, "): value=", index);
+    // A single lane writes directly to `output`.
+    std::array<tstring, kNumLanes> lanes;
+    InterleavedRangeEncoder<kNumLanes> encoder(
+        kNumLanes > 1 ? absl::MakeSpan(lanes) : absl::MakeSpan(output, 1));
+    // The intervals of each block are looked up before the block is coded.
+    std::array<int32, kIntervalBlockSize> lowers;
+    std::array<int32, kIntervalBlockSize> uppers;
+    for (int64 start = 0; start < data_size; start += kIntervalBlockSize) {
+      const int block_size =
+          std::min<int64>(kIntervalBlockSize, data_size - start);
+      for (int j = 0; j < block_size; ++j) {
+        const auto pair = view.Next();
+
+        const int64 index = *pair.first;
+        if (debug_level_ > 0) {
+          if (index < 0 || chip_size <= index + 1) {
+            return errors::InvalidArgument("'data' value not in [0, ",
+                                           chip_size - 1, "): value=", index);
+          }
+        } else {
+          DCHECK_GE(index, 0);
+          DCHECK_LT(index + 1, chip_size);
         }
-      } else {
-        DCHECK_GE(index, 0);
-        DCHECK_LT(index + 1, chip_size);
-      }
 
-      const int32* cdf_slice = pair.second;
-      DCHECK_LE(cdf_slice + chip_size, cdf.data() + cdf_size);
+        const int32* cdf_slice = pair.second;
+        DCHECK_LE(cdf_slice + chip_size, cdf.data() + cdf_size);
+
+        lowers[j] = cdf_slice[index];
+        uppers[j] = cdf_slice[index + 1];
+      }
 
-      const int32 lower = cdf_slice[index];
-      const int32 upper = cdf_slice[index + 1];
-      encoder.Encode(lower, upper, precision_, output);
+      for (int j = 0; j < block_size; ++j) {
+        encoder.Encode(lowers[j], uppers[j], precision);
+      }
     }
 
-    encoder.Finalize(output);
+    encoder.Finalize();
+    if (kNumLanes > 1) {
+      AppendSegments(lanes, output);
+    }
+    metrics->AddCarries(encoder.num_carries());
     return tensorflow::Status::OK();
   }
 
   int precision_;
   int debug_level_;
+  int interleave_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("RangeEncode").Device(DEVICE_CPU), RangeEncodeOp);
+REGISTER_KERNEL_BUILDER(Name("RangeEncode").Device(DEVICE_CPU).Label("async"),
+                        AsyncCodingKernel<RangeEncodeOp>);
+// The range coder runs on the host. The GPU kernels let the op be placed next
+// to the ops that produce its inputs, with all tensors in host memory.
+REGISTER_KERNEL_BUILDER(Name("RangeEncode")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("data")
+                            .HostMemory("cdf")
+                            .HostMemory("encoded"),
+                        RangeEncodeOp);
 
 class RangeDecodeOp : public OpKernel {
  public:
@@ -287,6 +386,10 @@ class RangeDecodeOp : public OpKernel {
     OP_REQUIRES(context, debug_level_ == 0 || debug_level_ == 1,
                 errors::InvalidArgument("`debug_level` must be 0 or 1: ",
                                         debug_level_));
+    OP_REQUIRES_OK(context, context->GetAttr("interleave", &interleave_));
+    OP_REQUIRES(context, IsValidInterleave(interleave_),
+                errors::InvalidArgument("`interleave` must be 1, 2, 4, or 8: ",
+                                        interleave_));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -294,6 +397,9 @@ class RangeDecodeOp : public OpKernel {
     const Tensor& shape = context->input(1);
     const Tensor& cdf = context->input(2);
 
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
     OP_REQUIRES(context, TensorShapeUtils::IsScalar(encoded_tensor.shape()),
                 errors::InvalidArgument("Invalid `encoded` shape: ",
                                         encoded_tensor.shape().DebugString()));
@@ -310,14 +416,31 @@ class RangeDecodeOp : public OpKernel {
       OP_REQUIRES_OK(context, CheckCdfValues(precision_, cdf));
     }
 
-    std::vector<int64> data_shape, cdf_shape;
+    MergedShape data_shape, cdf_shape;
     OP_REQUIRES_OK(
         context, MergeAxes(output_shape, cdf.shape(), &data_shape, &cdf_shape));
 
+    // RangeDecodeWithTable op has the decode table as an extra input. Its axes
+    // are merged in the same way as `cdf`.
+    DecodeTable table;
+    MergedShape table_shape = cdf_shape;
+    if (context->num_inputs() > 3) {
+      const Tensor& table_tensor = context->input(3);
+      OP_REQUIRES_OK(context,
+                     CheckDecodeTableShape(cdf.shape(), table_tensor.shape(),
+                                           precision_, &table.bits));
+      table.data = table_tensor.flat<int16>().data();
+      table_shape.back() = int64{1} << table.bits;
+    }
+
     const tstring& encoded = encoded_tensor.scalar<tstring>()();
 
     Tensor* output;
     OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &output));
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
 
     switch (data_shape.size()) {
 #define RANGE_DECODE_CASE(dim)                                                 \
@@ -325,7 +448,7 @@ class RangeDecodeOp : public OpKernel {
     OP_REQUIRES_OK(                                                            \
         context, RangeDecodeImpl<dim>(output->flat<int16>(), data_shape,       \
                                       cdf.flat_inner_dims<int32>(), cdf_shape, \
-                                      encoded));                               \
+                                      table, table_shape, encoded));           \
   } break
       RANGE_DECODE_CASE(1);
       RANGE_DECODE_CASE(2);
@@ -340,6 +463,8 @@ class RangeDecodeOp : public OpKernel {
             cdf.shape().DebugString()));
         return;
     }
+    metrics.AddSymbols(output->NumElements());
+    metrics.AddBytes(encoded.size());
   }
 
  private:
@@ -348,11 +473,80 @@ class RangeDecodeOp : public OpKernel {
                                      absl::Span<const int64> output_shape,
                                      TTypes<int32>::ConstMatrix cdf,
                                      absl::Span<const int64> cdf_shape,
+                                     const DecodeTable& table,
+                                     absl::Span<const int64> table_shape,
                                      const tstring& encoded) const {
+    switch (interleave_) {
+      case 1:
+        return RangeDecodePrecision<N, 1>(output, output_shape, cdf,
+                                            cdf_shape, table, table_shape,
+                                            encoded);
+      case 2:
+        return RangeDecodePrecision<N, 2>(output, output_shape, cdf,
+                                            cdf_shape, table, table_shape,
+                                            encoded);
+      case 4:
+        return RangeDecodePrecision<N, 4>(output, output_shape, cdf,
+                                            cdf_shape, table, table_shape,
+                                            encoded);
+      case 8:
+        return RangeDecodePrecision<N, 8>(output, output_shape, cdf,
+                                            cdf_shape, table, table_shape,
+                                            encoded);
+      default:
+        return errors::Internal("Unexpected interleave: ", interleave_);
+    }
+  }
+
+  // Specializes the coding loop for the commonly used precisions.
+  template <int N, int kNumLanes>
+  tensorflow::Status RangeDecodePrecision(TTypes<int16>::Flat output,
+                                          absl::Span<const int64> output_shape,
+                                          TTypes<int32>::ConstMatrix cdf,
+                                          absl::Span<const int64> cdf_shape,
+                                          const DecodeTable& table,
+                                          absl::Span<const int64> table_shape,
+                                          const tstring& encoded) const {
+    switch (precision_) {
+#define RANGE_DECODE_PRECISION_CASE(p)                                   \
+  case p:                                                                \
+    return RangeDecodeLanes<N, kNumLanes>(output, output_shape, cdf,     \
+                                          cdf_shape, table, table_shape, \
+                                          StaticPrecision<p>(), encoded);
+      RANGE_DECODE_PRECISION_CASE(12);
+      RANGE_DECODE_PRECISION_CASE(14);
+      RANGE_DECODE_PRECISION_CASE(15);
+      RANGE_DECODE_PRECISION_CASE(16);
+#undef RANGE_DECODE_PRECISION_CASE
+      default:
+        return RangeDecodeLanes<N, kNumLanes>(output, output_shape, cdf,
+                                              cdf_shape, table, table_shape,
+                                              precision_, encoded);
+    }
+  }
+
+  template <int N, int kNumLanes, typename Precision>
+  tensorflow::Status RangeDecodeLanes(TTypes<int16>::Flat output,
+                                      absl::Span<const int64> output_shape,
+                                      TTypes<int32>::ConstMatrix cdf,
+                                      absl::Span<const int64> cdf_shape,
+                                      const DecodeTable& table,
+                                      absl::Span<const int64> table_shape,
+                                      Precision precision,
+                                      const tstring& encoded) const {
     BroadcastRange<int16, int32, N> view{output.data(), output_shape,
                                          cdf.data(), cdf_shape};
-
-    RangeDecoder decoder(encoded);
+    // Only advanced when there is a decode table.
+    BroadcastRange<int16, int16, N> table_view{output.data(), output_shape,
+                                               table.data, table_shape};
+    const auto table_size =
+        static_cast<absl::Span<const int16>::size_type>(1) << table.bits;
+
+    std::array<absl::string_view, kNumLanes> lanes;
+    TF_RETURN_IF_ERROR(
+        SplitSegments(absl::string_view(encoded.data(), encoded.size()),
+                      absl::MakeSpan(lanes)));
+    InterleavedRangeDecoder<kNumLanes> decoder(lanes);
 
     const int64 output_size = output.size();
     const int64 cdf_size = cdf.size();
@@ -368,16 +562,50 @@ class RangeDecodeOp : public OpKernel {
       const int32* cdf_slice = pair.second;
       DCHECK_LE(cdf_slice + chip_size, cdf.data() + cdf_size);
 
-      *data = decoder.Decode({cdf_slice, chip_size}, precision_);
+      if (table.data != nullptr) {
+        const int16* table_slice = table_view.Next().second;
+        *data = decoder.Decode({cdf_slice, chip_size},
+                               {table_slice, table_size}, table.bits,
+                               precision);
+      } else {
+        *data = decoder.Decode({cdf_slice, chip_size}, precision);
+      }
+    }
+    // Decoding errors are sticky, and checked once for the whole tensor.
+    if (TF_PREDICT_FALSE(decoder.corrupted())) {
+      return errors::InvalidArgument("`encoded` is corrupt");
     }
     return tensorflow::Status::OK();
   }
 
   int precision_;
   int debug_level_;
+  int interleave_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("RangeDecode").Device(DEVICE_CPU), RangeDecodeOp);
+REGISTER_KERNEL_BUILDER(Name("RangeDecodeWithTable").Device(DEVICE_CPU),
+                        RangeDecodeOp);
+REGISTER_KERNEL_BUILDER(Name("RangeDecode").Device(DEVICE_CPU).Label("async"),
+                        AsyncCodingKernel<RangeDecodeOp>);
+REGISTER_KERNEL_BUILDER(
+    Name("RangeDecodeWithTable").Device(DEVICE_CPU).Label("async"),
+    AsyncCodingKernel<RangeDecodeOp>);
+REGISTER_KERNEL_BUILDER(Name("RangeDecode")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("encoded")
+                            .HostMemory("shape")
+                            .HostMemory("cdf")
+                            .HostMemory("decoded"),
+                        RangeDecodeOp);
+REGISTER_KERNEL_BUILDER(Name("RangeDecodeWithTable")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("encoded")
+                            .HostMemory("shape")
+                            .HostMemory("cdf")
+                            .HostMemory("decode_table")
+                            .HostMemory("decoded"),
+                        RangeDecodeOp);
 
 }  // namespace
 }  // namespace tensorflow_compression
@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <memory>
 #include <random>
 #include <vector>
@@ -55,6 +56,7 @@ using tensorflow::OpRegistry;
 using tensorflow::OpsTestBase;
 using tensorflow::ShapeRefiner;
 using tensorflow::Status;
+using tensorflow::string;
 using tensorflow::Tensor;
 using tensorflow::TensorShape;
 using tensorflow::TensorShapeUtils;
@@ -108,12 +110,13 @@ class RangeCoderOpsTest : public OpsTestBase {
   }
 
   Status RunEncodeOpImpl(int precision, absl::Span<const Tensor> input,
-                         int debug_level, Tensor* output) {
+                         int debug_level, Tensor* output, int interleave = 1) {
     TF_RETURN_IF_ERROR(NodeDefBuilder("encode", "RangeEncode")
                            .Input(tensorflow::FakeInput(DT_INT16))
                            .Input(tensorflow::FakeInput(DT_INT32))
                            .Attr("precision", precision)
                            .Attr("debug_level", debug_level)
+                           .Attr("interleave", interleave)
                            .Finalize(node_def()));
     TF_RETURN_IF_ERROR(InitOp());
 
@@ -143,13 +146,14 @@ class RangeCoderOpsTest : public OpsTestBase {
   }
 
   Status RunDecodeOpImpl(int precision, absl::Span<const Tensor> input,
-                         int debug_level, Tensor* output) {
+                         int debug_level, Tensor* output, int interleave = 1) {
     TF_RETURN_IF_ERROR(NodeDefBuilder("decode", "RangeDecode")
                            .Input(tensorflow::FakeInput(DT_STRING))
                            .Input(tensorflow::FakeInput(DT_INT32))
                            .Input(tensorflow::FakeInput(DT_INT32))
                            .Attr("precision", precision)
                            .Attr("debug_level", debug_level)
+                           .Attr("interleave", interleave)
                            .Finalize(node_def()));
     TF_RETURN_IF_ERROR(InitOp());
 
@@ -168,10 +172,37 @@ class RangeCoderOpsTest : public OpsTestBase {
     return Status::OK();
   }
 
+  // Runs `op_name` with `precision` and default values for the other attrs.
+  Status RunOp(const string& op_name, int precision,
+               absl::Span<const Tensor> input, Tensor* output) {
+    NodeDefBuilder builder("op", op_name);
+    for (const Tensor& tensor : input) {
+      builder.Input(tensorflow::FakeInput(tensor.dtype()));
+    }
+    TF_RETURN_IF_ERROR(
+        builder.Attr("precision", precision).Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+
+    inputs_.clear();
+    std::vector<Tensor> copies(input.size());
+    for (int i = 0; i < input.size(); ++i) {
+      copies[i] = input[i];
+      inputs_.emplace_back(&copies[i]);
+    }
+
+    TF_RETURN_IF_ERROR(RunOpKernel());
+
+    *output = *GetOutput(0);
+    inputs_.clear();
+
+    return Status::OK();
+  }
+
   void TestEncodeAndDecode(int precision, const Tensor& data,
-                           const Tensor& cdf) {
+                           const Tensor& cdf, int interleave = 1) {
     Tensor encoded;
-    TF_ASSERT_OK(RunEncodeOp(precision, {data, cdf}, &encoded));
+    TF_ASSERT_OK(
+        RunEncodeOpImpl(precision, {data, cdf}, 0, &encoded, interleave));
 
     const TensorShape& data_shape = data.shape();
     Tensor shape{DT_INT32, {data_shape.dims()}};
@@ -180,7 +211,8 @@ class RangeCoderOpsTest : public OpsTestBase {
     }
 
     Tensor decoded;
-    TF_ASSERT_OK(RunDecodeOp(precision, {encoded, shape, cdf}, &decoded));
+    TF_ASSERT_OK(RunDecodeOpImpl(precision, {encoded, shape, cdf}, 0,
+                                 &decoded, interleave));
 
     EXPECT_EQ(decoded.dtype(), data.dtype());
     EXPECT_EQ(decoded.shape(), data.shape());
@@ -266,6 +298,74 @@ TEST_F(RangeCoderOpsTest, NoBroadcast) {
   TestEncodeAndDecode(kPrecision, data, cdf);
 }
 
+TEST_F(RangeCoderOpsTest, Interleave) {
+  // Each CDF row is built from 32 * 32 = 2^10 samples.
+  constexpr int kPrecision = 10;
+  constexpr int kMaxValue = 10;
+
+  Tensor data{DT_INT16, {1, 32, 32, 16}};
+  Tensor cdf{DT_INT32, {1, 1, 1, 16, kMaxValue + 2}};
+  Tensor maxvalue{DT_INT16, {1, 1, 1, 16}};
+  maxvalue.flat<int16>().setConstant(kMaxValue);
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+  BuildCdf(&gen, &data, &cdf, maxvalue);
+
+  for (int interleave : {1, 2, 4, 8}) {
+    TestEncodeAndDecode(kPrecision, data, cdf, interleave);
+  }
+
+  Tensor unused;
+  EXPECT_FALSE(RunEncodeOpImpl(kPrecision, {data, cdf}, 0, &unused, 3).ok());
+}
+
+TEST_F(RangeCoderOpsTest, DecodeTable) {
+  constexpr int kMaxValue = 10;
+
+  Tensor data{DT_INT16, {1, 32, 32, 16}};
+  Tensor maxvalue{DT_INT16, {1, 1, 1, 16}};
+  maxvalue.flat<int16>().setConstant(kMaxValue);
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor shape{DT_INT32, {data.dims()}};
+  for (int i = 0; i < data.dims(); ++i) {
+    shape.flat<int32>()(i) = data.dim_size(i);
+  }
+
+  // Each CDF row is built from 2^10 samples. Scaling the CDF covers both the
+  // complete and the bucketed decode tables.
+  for (const int precision : {10, 14}) {
+    Tensor cdf{DT_INT32, {1, 1, 1, 16, kMaxValue + 2}};
+    BuildCdf(&gen, &data, &cdf, maxvalue);
+    cdf.flat<int32>() = cdf.flat<int32>() * (1 << (precision - 10));
+
+    Tensor table;
+    TF_ASSERT_OK(RunOp("CdfToDecodeTable", precision, {cdf}, &table));
+    EXPECT_EQ(table.shape(), (TensorShape{1, 1, 1, 16,
+                                          1 << std::min(precision, 12)}));
+
+    Tensor encoded;
+    TF_ASSERT_OK(RunEncodeOp(precision, {data, cdf}, &encoded));
+
+    Tensor decoded;
+    TF_ASSERT_OK(RunOp("RangeDecodeWithTable", precision,
+                       {encoded, shape, cdf, table}, &decoded));
+    EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+
+    Tensor bad_table{DT_INT16, {1, 1, 1, 16, 8}};
+    bad_table.flat<int16>().setZero();
+    Tensor unused;
+    EXPECT_FALSE(RunOp("RangeDecodeWithTable", precision,
+                       {encoded, shape, cdf, bad_table}, &unused)
+                     .ok());
+  }
+}
+
 TEST_F(RangeCoderOpsTest, Broadcast1Axis) {
   constexpr int kPrecision = 9;
   constexpr int kDimensionSize = 1 << kPrecision;
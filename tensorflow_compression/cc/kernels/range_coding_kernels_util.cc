@@ -13,10 +13,15 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
 
@@ -29,18 +34,19 @@ using tensorflow::errors::InvalidArgument;
 using tensorflow::int32;
 using tensorflow::int64;
 using tensorflow::string;
+using tensorflow::tstring;
 using tensorflow::uint8;
 using tensorflow::uint32;
 using tensorflow::uint64;
 
 Status MergeAxes(const TensorShape& broadcast_shape,
                  const TensorShape& storage_shape,
-                 std::vector<int64>* merged_broadcast_shape_pointer,
-                 std::vector<int64>* merged_storage_shape_pointer) {
+                 MergedShape* merged_broadcast_shape_pointer,
+                 MergedShape* merged_storage_shape_pointer) {
   CHECK_EQ(storage_shape.dims(), broadcast_shape.dims() + 1);
 
-  std::vector<int64>& merged_broadcast_shape = *merged_broadcast_shape_pointer;
-  std::vector<int64>& merged_storage_shape = *merged_storage_shape_pointer;
+  MergedShape& merged_broadcast_shape = *merged_broadcast_shape_pointer;
+  MergedShape& merged_storage_shape = *merged_storage_shape_pointer;
 
   // The shapes are simplified so that the conversions between linear index
   // and coordinates takes less CPU cycles. Two adjacent dimensions are
@@ -91,4 +97,132 @@ Status MergeAxes(const TensorShape& broadcast_shape,
   return Status::OK();
 }
 
+Status CheckDecodeTableShape(const TensorShape& cdf_shape,
+                             const TensorShape& table_shape, int precision,
+                             int* table_bits) {
+  const int dims = cdf_shape.dims();
+  bool valid = dims > 0 && table_shape.dims() == dims;
+  for (int i = 0; valid && i + 1 < dims; ++i) {
+    valid = table_shape.dim_size(i) == cdf_shape.dim_size(i);
+  }
+  const int bits = std::min(precision, kMaxDecodeTableBits);
+  if (TF_PREDICT_FALSE(!valid || table_shape.dim_size(dims - 1) != 1 << bits)) {
+    return InvalidArgument(
+        "`decode_table` does not match `cdf` and `precision`: decode_table "
+        "shape=",
+        table_shape.DebugString(), ", cdf shape=", cdf_shape.DebugString(),
+        ", precision=", precision);
+  }
+  *table_bits = bits;
+  return Status::OK();
+}
+
+float CdfEntropy(absl::Span<const int32> cdf, int precision) {
+  // With m_i := cdf[i + 1] - cdf[i], the entropy is
+  //   -sum_i m_i / 2^precision * log2(m_i / 2^precision)
+  //     = precision - sum_i m_i * log2(m_i) / 2^precision.
+  double sum = 0;
+  for (size_t i = 0; i + 1 < cdf.size(); ++i) {
+    const int32 mass = cdf[i + 1] - cdf[i];
+    if (mass > 0) {
+      sum += mass * std::log2(static_cast<double>(mass));
+    }
+  }
+  const double entropy = precision - std::ldexp(sum, -precision);
+  return std::min<double>(std::max(entropy, 0.0), precision);
+}
+
+void AppendSegments(absl::Span<const tstring> segments, tstring* sink) {
+  if (segments.empty()) return;
+  size_t total_size = sink->size();
+  for (const tstring& segment : segments) {
+    // Includes the upper bound of the varint length.
+    total_size += segment.size() + 10;
+  }
+  sink->reserve(total_size);
+  for (size_t i = 0; i + 1 < segments.size(); ++i) {
+    uint64 length = segments[i].size();
+    while (length >= 0x80) {
+      sink->push_back(static_cast<char>((length & 0x7F) | 0x80));
+      length >>= 7;
+    }
+    sink->push_back(static_cast<char>(length));
+  }
+  for (const tstring& segment : segments) {
+    sink->append(segment.data(), segment.size());
+  }
+}
+
+namespace {
+
+// Reads a varint-coded segment length from the front of `source`.
+bool ReadSegmentLength(absl::string_view* source, uint64* length) {
+  *length = 0;
+  for (int shift = 0;; shift += 7) {
+    if (TF_PREDICT_FALSE(source->empty() || shift > 56)) {
+      return false;
+    }
+    const uint8 byte = static_cast<uint8>(source->front());
+    source->remove_prefix(1);
+    *length |= static_cast<uint64>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+}
+
+}  // namespace
+
+Status SplitSegments(absl::string_view source,
+                     absl::Span<absl::string_view> segments) {
+  if (segments.empty()) return Status::OK();
+
+  // The table is read twice, first to find where the segments start, so that
+  // the lengths do not need to be stored.
+  absl::string_view data = source;
+  for (size_t i = 0; i + 1 < segments.size(); ++i) {
+    uint64 length;
+    if (!ReadSegmentLength(&data, &length)) {
+      return InvalidArgument("Corrupt segment table");
+    }
+  }
+  for (size_t i = 0; i + 1 < segments.size(); ++i) {
+    uint64 length;
+    ReadSegmentLength(&source, &length);
+    if (TF_PREDICT_FALSE(data.size() < length)) {
+      return InvalidArgument("Segment ", i, " has length ", length,
+                             " but only ", data.size(), " bytes remain");
+    }
+    segments[i] = data.substr(0, length);
+    data.remove_prefix(length);
+  }
+  segments.back() = data;
+  return Status::OK();
+}
+
+void AppendChecksum(tstring* sink) {
+  const uint32 checksum = tensorflow::crc32c::Mask(
+      tensorflow::crc32c::Value(sink->data(), sink->size()));
+  for (int i = 0; i < 4; ++i) {
+    sink->push_back(static_cast<char>(checksum >> (8 * i)));
+  }
+}
+
+Status RemoveChecksum(absl::string_view* source) {
+  if (TF_PREDICT_FALSE(source->size() < 4)) {
+    return InvalidArgument("Encoded string of ", source->size(),
+                           " bytes is too short to hold a checksum");
+  }
+  const size_t size = source->size() - 4;
+  uint32 checksum = 0;
+  for (int i = 0; i < 4; ++i) {
+    checksum |= static_cast<uint32>(static_cast<uint8>((*source)[size + i]))
+                << (8 * i);
+  }
+  if (TF_PREDICT_FALSE(tensorflow::crc32c::Unmask(checksum) !=
+                       tensorflow::crc32c::Value(source->data(), size))) {
+    return InvalidArgument("Checksum mismatch: the encoded string is corrupt");
+  }
+  source->remove_suffix(4);
+  return Status::OK();
+}
+
 }  // namespace tensorflow_compression
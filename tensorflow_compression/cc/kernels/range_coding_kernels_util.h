@@ -16,20 +16,116 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPRESSION_CC_KERNELS_RANGE_CODING_KERNELS_UTIL_H_
 #define TENSORFLOW_COMPRESSION_CC_KERNELS_RANGE_CODING_KERNELS_UTIL_H_
 
+#include <cstddef>
 #include <vector>
 
+#include "absl/container/inlined_vector.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow_compression {
 
+// A shape produced by MergeAxes(). It is stored inline for the few axes that
+// are left after merging, so that the kernels do not allocate it on each run.
+using MergedShape = absl::InlinedVector<tensorflow::int64, 8>;
+
 // The shapes are simplified to reduce indexing cost.
-tensorflow::Status MergeAxes(
-    const tensorflow::TensorShape& broadcast_shape,
-    const tensorflow::TensorShape& storage_shape,
-    std::vector<tensorflow::int64>* merged_broadcast_shape_pointer,
-    std::vector<tensorflow::int64>* merged_storage_shape_pointer);
+tensorflow::Status MergeAxes(const tensorflow::TensorShape& broadcast_shape,
+                             const tensorflow::TensorShape& storage_shape,
+                             MergedShape* merged_broadcast_shape_pointer,
+                             MergedShape* merged_storage_shape_pointer);
+
+// The decode tables created by CdfToDecodeTable op have
+// 2^min(precision, kMaxDecodeTableBits) entries per CDF.
+constexpr int kMaxDecodeTableBits = 12;
+
+// A decode table created by CdfToDecodeTable op, or none if `data` is null.
+struct DecodeTable {
+  const tensorflow::int16* data = nullptr;
+  // log2 of the number of table entries per CDF.
+  int bits = 0;
+};
+
+// Checks that `table_shape` is the shape of decode tables created by
+// CdfToDecodeTable op for `cdf_shape`, and sets `*table_bits` to log2 of the
+// number of entries per CDF.
+tensorflow::Status CheckDecodeTableShape(
+    const tensorflow::TensorShape& cdf_shape,
+    const tensorflow::TensorShape& table_shape, int precision,
+    int* table_bits);
+
+// Returns the position of the first element of the `chunk`-th chunk when `size`
+// elements are split into `num_chunks` chunks of nearly equal size.
+inline tensorflow::int64 ChunkStart(tensorflow::int64 size,
+                                    tensorflow::int64 num_chunks,
+                                    tensorflow::int64 chunk) {
+  return size * chunk / num_chunks;
+}
+
+// Returns the entropy in bits of the distribution represented by `cdf`, i.e.,
+// an estimate of the cost to range code a symbol with it. The result is clamped
+// to [0, precision], so that invalid CDFs cannot lead to unbounded estimates.
+float CdfEntropy(absl::Span<const tensorflow::int32> cdf, int precision);
+
+// Returns the buffer size to reserve for range coding about `bits` bits, with
+// some headroom for the coding overhead and the final bytes.
+inline size_t EncodedSizeHint(double bits) {
+  return static_cast<size_t>(bits * (17.0 / 128.0)) + 8;
+}
+
+// The encode loops look up the intervals of this many characters at a time,
+// ahead of the range coder. The lookups within a block do not depend on each
+// other or on the coder state, so the CPU can overlap them, and the serial
+// coder loop only consumes intervals that are ready.
+constexpr int kIntervalBlockSize = 256;
+
+// Appends `segments` to `sink`, preceded by a table of varint-coded segment
+// lengths. The length of the last segment is omitted from the table because it
+// is implied by the length of the whole string.
+void AppendSegments(absl::Span<const tensorflow::tstring> segments,
+                    tensorflow::tstring* sink);
+
+// Reverse of AppendSegments(). Splits `source` into `segments->size()` pieces.
+// The pieces point into `source`, which should outlive them.
+tensorflow::Status SplitSegments(absl::string_view source,
+                                 absl::Span<absl::string_view> segments);
+
+// Appends a 4-byte checksum of the bytes in `sink`, a masked CRC32C in
+// little-endian order, to `sink`.
+void AppendChecksum(tensorflow::tstring* sink);
+
+// Reverse of AppendChecksum(). Verifies the checksum at the end of `*source`,
+// and removes it from `*source`.
+tensorflow::Status RemoveChecksum(absl::string_view* source);
+
+// Runs the synchronous `Kernel` as an AsyncOpKernel. ComputeAsync() returns at
+// once and the coding runs on the CPU worker pool, so that the executor can go
+// on with other ops meanwhile, e.g., the transforms of the next batch. These
+// kernels are registered with label "async", and are picked over the default
+// kernels by setting the "_kernel" attr of a node to that label.
+template <typename Kernel>
+class AsyncCodingKernel : public tensorflow::AsyncOpKernel {
+ public:
+  explicit AsyncCodingKernel(tensorflow::OpKernelConstruction* context)
+      : AsyncOpKernel(context), kernel_(context) {}
+
+  void ComputeAsync(tensorflow::OpKernelContext* context,
+                    DoneCallback done) override {
+    context->device()->tensorflow_cpu_worker_threads()->workers->Schedule(
+        [this, context, done]() {
+          kernel_.Compute(context);
+          done();
+        });
+  }
+
+ private:
+  Kernel kernel_;
+};
 
 }  // namespace tensorflow_compression
 
@@ -0,0 +1,118 @@
+/* Copyright 2020 Google LLC. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_compression/cc/kernels/range_coding_metrics.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace tensorflow_compression {
+namespace {
+namespace monitoring = tensorflow::monitoring;
+using tensorflow::int64;
+
+monitoring::Counter<1>* NewCounter(const char* name, const char* description) {
+  return monitoring::Counter<1>::New(
+      std::string("/tensorflow_compression/range_coding/") + name, description,
+      "op");
+}
+
+struct Counters {
+  monitoring::Counter<1>* const symbols =
+      NewCounter("symbols", "Number of values coded.");
+  monitoring::Counter<1>* const bytes =
+      NewCounter("bytes", "Number of bytes of the encoded strings.");
+  monitoring::Counter<1>* const overflows = NewCounter(
+      "overflows", "Number of values coded with the overflow escape.");
+  monitoring::Counter<1>* const carries = NewCounter(
+      "carries", "Number of times the encoder delayed bytes for a carry.");
+  monitoring::Counter<1>* const validation_usecs = NewCounter(
+      "validation_usecs", "Time spent checking the arguments in microseconds.");
+  monitoring::Counter<1>* const coding_usecs =
+      NewCounter("coding_usecs", "Time spent coding in microseconds.");
+};
+
+// The counters are created on first use, and never deleted.
+const Counters& GetCounters() {
+  static const Counters* counters = new Counters;
+  return *counters;
+}
+
+void Export(monitoring::Counter<1>* counter, const std::string& op,
+            const std::atomic<int64>& value) {
+  const int64 v = value.load(std::memory_order_relaxed);
+  if (v != 0) {
+    counter->GetCell(op)->IncrementBy(v);
+  }
+}
+
+}  // namespace
+
+bool RangeCodingMetricsEnabled() {
+  static const bool enabled = [] {
+    const char* value = std::getenv("TFC_RANGE_CODING_METRICS");
+    return value != nullptr && std::strcmp(value, "1") == 0;
+  }();
+  return enabled;
+}
+
+RangeCodingMetrics::RangeCodingMetrics(absl::string_view op)
+    : enabled_(RangeCodingMetricsEnabled()), op_(op) {}
+
+RangeCodingMetrics::~RangeCodingMetrics() {
+  if (!enabled_) return;
+  const Counters& counters = GetCounters();
+  const std::string op(op_);
+  Export(counters.symbols, op, symbols_);
+  Export(counters.bytes, op, bytes_);
+  Export(counters.overflows, op, overflows_);
+  Export(counters.carries, op, carries_);
+  Export(counters.validation_usecs, op, validation_usecs_);
+  Export(counters.coding_usecs, op, coding_usecs_);
+}
+
+RangeCodingMetrics::ScopedStage::ScopedStage(RangeCodingMetrics* metrics,
+                                             Stage stage)
+    : metrics_(metrics),
+      stage_(stage),
+      trace_(stage == kValidation ? "RangeCodingValidate"
+                                  : "RangeCodingCode") {
+  if (metrics_->enabled()) {
+    start_micros_ = tensorflow::Env::Default()->NowMicros();
+  }
+}
+
+RangeCodingMetrics::ScopedStage::~ScopedStage() { Stop(); }
+
+void RangeCodingMetrics::ScopedStage::Stop() {
+  if (stopped_) return;
+  stopped_ = true;
+  trace_.Stop();
+  if (!metrics_->enabled()) return;
+  const int64 elapsed =
+      tensorflow::Env::Default()->NowMicros() - start_micros_;
+  metrics_->Add(stage_ == kValidation ? &metrics_->validation_usecs_
+                                      : &metrics_->coding_usecs_,
+                elapsed);
+}
+
+}  // namespace tensorflow_compression
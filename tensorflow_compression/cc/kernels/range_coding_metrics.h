@@ -0,0 +1,105 @@
+/* Copyright 2020 Google LLC. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPRESSION_CC_KERNELS_RANGE_CODING_METRICS_H_
+#define TENSORFLOW_COMPRESSION_CC_KERNELS_RANGE_CODING_METRICS_H_
+
+#include <atomic>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace tensorflow_compression {
+
+// Returns true if the range coding kernels collect metrics, which is the case
+// if the environment variable TFC_RANGE_CODING_METRICS is set to 1 when the
+// library is loaded. Otherwise the kernels skip all counting and timing, and
+// only emit TraceMe events, which are free while the profiler is inactive.
+bool RangeCodingMetricsEnabled();
+
+// Metrics of one run of a range coding kernel. When the object is destroyed,
+// the metrics are added to the monitoring counters under
+// /tensorflow_compression/range_coding/, labeled with the op type:
+//
+//   symbols: Number of values coded.
+//   bytes: Number of bytes of the encoded strings.
+//   overflows: Number of values coded with the overflow escape.
+//   carries: Number of times RangeEncoder delayed output bytes for a carry.
+//   validation_usecs: Time spent checking the arguments.
+//   coding_usecs: Time spent encoding or decoding.
+//
+// The Add*() functions are thread-safe, and do nothing if the metrics are
+// disabled. Callers should check enabled() before computing values that are
+// only needed for the metrics.
+class RangeCodingMetrics {
+ public:
+  enum Stage { kValidation, kCoding };
+
+  // `op` is usually OpKernel::type_string(), and has to outlive the object.
+  explicit RangeCodingMetrics(absl::string_view op);
+  ~RangeCodingMetrics();
+
+  RangeCodingMetrics(const RangeCodingMetrics&) = delete;
+  RangeCodingMetrics& operator=(const RangeCodingMetrics&) = delete;
+
+  bool enabled() const { return enabled_; }
+
+  void AddSymbols(tensorflow::int64 count) { Add(&symbols_, count); }
+  void AddBytes(tensorflow::int64 count) { Add(&bytes_, count); }
+  void AddOverflows(tensorflow::int64 count) { Add(&overflows_, count); }
+  void AddCarries(tensorflow::int64 count) { Add(&carries_, count); }
+
+  // Records the time spent in a stage of the kernel until the object goes out
+  // of scope, both as a TraceMe event and in the counters.
+  class ScopedStage {
+   public:
+    ScopedStage(RangeCodingMetrics* metrics, Stage stage);
+    ~ScopedStage();
+
+    ScopedStage(const ScopedStage&) = delete;
+    ScopedStage& operator=(const ScopedStage&) = delete;
+
+    // Ends the stage before the object goes out of scope.
+    void Stop();
+
+   private:
+    RangeCodingMetrics* const metrics_;
+    const Stage stage_;
+    tensorflow::uint64 start_micros_ = 0;
+    bool stopped_ = false;
+    tensorflow::profiler::TraceMe trace_;
+  };
+
+ private:
+  void Add(std::atomic<tensorflow::int64>* counter, tensorflow::int64 count) {
+    if (enabled_) {
+      counter->fetch_add(count, std::memory_order_relaxed);
+    }
+  }
+
+  const bool enabled_;
+  const absl::string_view op_;
+  std::atomic<tensorflow::int64> symbols_{0};
+  std::atomic<tensorflow::int64> bytes_{0};
+  std::atomic<tensorflow::int64> overflows_{0};
+  std::atomic<tensorflow::int64> carries_{0};
+  std::atomic<tensorflow::int64> validation_usecs_{0};
+  std::atomic<tensorflow::int64> coding_usecs_{0};
+};
+
+}  // namespace tensorflow_compression
+
+#endif  // TENSORFLOW_COMPRESSION_CC_KERNELS_RANGE_CODING_METRICS_H_
@@ -15,29 +15,50 @@ limitations under the License.
 
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
 #include <limits>
-#include <numeric>
+#include <memory>
+#include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #define EIGEN_USE_THREADS
 
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow_compression/cc/kernels/cdf_table.h"
 #include "tensorflow_compression/cc/kernels/range_coder.h"
+#include "tensorflow_compression/cc/kernels/range_coding_kernels_util.h"
+#include "tensorflow_compression/cc/kernels/range_coding_metrics.h"
 
 namespace tensorflow_compression {
 namespace {
 namespace errors = tensorflow::errors;
+namespace thread = tensorflow::thread;
 using tensorflow::DEVICE_CPU;
+using tensorflow::DEVICE_GPU;
 using tensorflow::int16;
 using tensorflow::int32;
 using tensorflow::int64;
@@ -51,10 +72,29 @@ using tensorflow::TensorShape;
 using tensorflow::TensorShapeUtils;
 using tensorflow::tstring;
 using tensorflow::TTypes;
+using tensorflow::uint16;
 using tensorflow::uint32;
 using tensorflow::uint64;
 using tensorflow::uint8;
 
+// A rough estimate of the cost to range code a single symbol, used to shard
+// the batched ops over the CPU worker threads.
+constexpr int64 kCostPerSymbol = 100;
+
+// The same for looking up the cost of a symbol in RangeCodingCost op.
+constexpr int64 kCostPerValue = 5;
+
+// Returns the number of chunks a string of `size` symbols is split into. Each
+// chunk holds at least one symbol, except when the string is empty.
+int64 NumChunks(int64 num_chunks_attr, int64 size) {
+  return std::max<int64>(1, std::min<int64>(num_chunks_attr, size));
+}
+
+bool IsValidInterleave(int interleave) {
+  return interleave == 1 || interleave == 2 || interleave == 4 ||
+         interleave == 8;
+}
+
 tensorflow::Status CheckIndex(int64 upper_bound, const Tensor& index) {
   auto flat = index.flat<int32>();
   for (int64 i = 0; i < flat.size(); ++i) {
@@ -103,7 +143,7 @@ tensorflow::Status CheckCdf(int precision, const Tensor& cdf,
   return tensorflow::Status::OK();
 }
 
-// Assumes that CheckArgumentShapes().ok().
+// Assumes that CheckCdfShapes().ok().
 tensorflow::Status CheckArgumentValues(int precision, const Tensor& index,
                                        const Tensor& cdf,
                                        const Tensor& cdf_size,
@@ -114,9 +154,30 @@ tensorflow::Status CheckArgumentValues(int precision, const Tensor& index,
   return tensorflow::Status::OK();
 }
 
-tensorflow::Status CheckArgumentShapes(const Tensor& index, const Tensor& cdf,
-                                       const Tensor& cdf_size,
-                                       const Tensor& offset) {
+// Checks the shape of `index` for the batched ops. `index` should have the
+// same shape as a batch of `batch_size` strings, except that its leading axis
+// may be 1, in which case the same index is used for every string.
+tensorflow::Status CheckBatchedIndexShape(int64 batch_size,
+                                          const TensorShape& string_shape,
+                                          const TensorShape& index_shape) {
+  if (index_shape.dims() != string_shape.dims() + 1 ||
+      (index_shape.dim_size(0) != 1 && index_shape.dim_size(0) != batch_size)) {
+    return errors::InvalidArgument(
+        "`index` should have a leading axis of size 1 or ", batch_size,
+        ", followed by ", string_shape, ": index.shape=", index_shape);
+  }
+  for (int i = 0; i < string_shape.dims(); ++i) {
+    if (index_shape.dim_size(i + 1) != string_shape.dim_size(i)) {
+      return errors::InvalidArgument(
+          "`index` should have a leading axis of size 1 or ", batch_size,
+          ", followed by ", string_shape, ": index.shape=", index_shape);
+    }
+  }
+  return tensorflow::Status::OK();
+}
+
+tensorflow::Status CheckCdfShapes(const Tensor& cdf, const Tensor& cdf_size,
+                                  const Tensor& offset) {
   if (!TensorShapeUtils::IsMatrix(cdf.shape()) || cdf.dim_size(1) < 3) {
     return errors::InvalidArgument(
         "'cdf' should be 2-D and cdf.dim_size(1) >= 3: ", cdf.shape());
@@ -138,6 +199,512 @@ tensorflow::Status CheckArgumentShapes(const Tensor& index, const Tensor& cdf,
   return tensorflow::Status::OK();
 }
 
+// Returns the entropy of each CDF, used to size the encoder output. Does not
+// assume that the CDFs are valid.
+std::vector<float> CdfEntropies(int precision, const Tensor& cdf,
+                                const Tensor& cdf_size) {
+  auto matrix = cdf.matrix<int32>();
+  auto size = cdf_size.vec<int32>();
+  std::vector<float> entropy(matrix.dimension(0));
+  for (int64 i = 0; i < matrix.dimension(0); ++i) {
+    const int64 length =
+        std::min<int64>(std::max<int32>(size(i), 0), matrix.dimension(1));
+    entropy[i] =
+        CdfEntropy(absl::MakeConstSpan(&matrix(i, 0), length), precision);
+  }
+  return entropy;
+}
+
+// The CDFs passed to the coding ops as `cdf` and `cdf_size`, i.e., the rows of
+// a padded matrix. PaddedCdfs and PackedCdfs provide the same interface to the
+// coding loops:
+//
+//   num_cdfs(): The number of CDFs.
+//   size(i): The number of elements of the i-th CDF, including the last one.
+//   row(i): The i-th CDF, indexable by [0, size(i)) to get int32 values.
+//   slice(i): The i-th CDF in the form taken by RangeDecoder::Decode().
+class PaddedCdfs {
+ public:
+  PaddedCdfs(const Tensor& cdf, const Tensor& cdf_size)
+      : cdf_(cdf.matrix<int32>()), cdf_size_(cdf_size.vec<int32>()) {}
+
+  int64 num_cdfs() const { return cdf_.dimension(0); }
+  int32 size(int64 i) const { return cdf_size_(i); }
+  const int32* row(int64 i) const { return &cdf_(i, 0); }
+  absl::Span<const int32> slice(int64 i) const {
+    return absl::MakeConstSpan(row(i), size(i));
+  }
+
+ private:
+  TTypes<int32>::ConstMatrix cdf_;
+  TTypes<int32>::ConstVec cdf_size_;
+};
+
+// A CDF of a CdfTable, indexable like a full CDF. The last element, which is
+// not stored, is 2^precision.
+class PackedCdfRow {
+ public:
+  PackedCdfRow(const uint16* values, int32 num_values, int32 last)
+      : values_(values), num_values_(num_values), last_(last) {}
+
+  int32 operator[](int32 i) const {
+    return TF_PREDICT_TRUE(i < num_values_) ? values_[i] : last_;
+  }
+
+ private:
+  const uint16* values_;
+  int32 num_values_;
+  int32 last_;
+};
+
+// The CDFs stored in a CdfTable. See PaddedCdfs for the interface. The table
+// has to outlive the object.
+class PackedCdfs {
+ public:
+  explicit PackedCdfs(const CdfTable& table)
+      : values_(table.cdf_values().flat<uint16>().data()),
+        row_splits_(table.cdf_row_splits().flat<int32>().data()),
+        num_cdfs_(table.num_cdfs()),
+        last_(1 << table.precision()) {}
+
+  int64 num_cdfs() const { return num_cdfs_; }
+  int32 size(int64 i) const { return row_splits_[i + 1] - row_splits_[i] + 1; }
+  PackedCdfRow row(int64 i) const {
+    return PackedCdfRow(values_ + row_splits_[i], size(i) - 1, last_);
+  }
+  absl::Span<const uint16> slice(int64 i) const {
+    return absl::MakeConstSpan(values_ + row_splits_[i], size(i) - 1);
+  }
+
+ private:
+  const uint16* values_;
+  const int32* row_splits_;
+  int64 num_cdfs_;
+  int32 last_;
+};
+
+// Decodes a symbol with `cdf`, the `cdf_index`-th CDF, using its decode table
+// in `table` if there is one. `Decoder` is either RangeDecoder or
+// InterleavedRangeDecoder.
+template <typename Decoder, typename Precision>
+int32 DecodeSymbol(Decoder* decoder, absl::Span<const int32> cdf,
+                   const DecodeTable& table, int64 cdf_index,
+                   Precision precision) {
+  if (table.data == nullptr) {
+    return decoder->Decode(cdf, precision);
+  }
+  const auto table_size =
+      static_cast<absl::Span<const int16>::size_type>(1) << table.bits;
+  return decoder->Decode(cdf, {table.data + cdf_index * table_size, table_size},
+                         table.bits, precision);
+}
+
+// Same as above for a CDF of a CdfTable, which always has a decode table.
+template <typename Decoder, typename Precision>
+int32 DecodeSymbol(Decoder* decoder, absl::Span<const uint16> cdf,
+                   const DecodeTable& table, int64 cdf_index,
+                   Precision precision) {
+  DCHECK(table.data != nullptr);
+  const auto table_size =
+      static_cast<absl::Span<const int16>::size_type>(1) << table.bits;
+  return decoder->Decode(cdf, {table.data + cdf_index * table_size, table_size},
+                         table.bits, precision);
+}
+
+// Decodes the overflow of a value that was coded as `max_value`, i.e., the
+// escape symbol, and returns the value before adding the offset. `Decoder` is
+// either RangeDecoder or InterleavedRangeDecoder. Sets `*corrupted` to true if
+// the number of digits is more than a 32-bit overflow can have, and leaves it
+// unchanged otherwise.
+template <typename Decoder>
+int32 DecodeOverflow(Decoder* decoder, int overflow_width, int32 max_value,
+                     bool* corrupted) {
+  const uint32 max_overflow = (1 << overflow_width) - 1;
+  const int32 max_widths = (32 + overflow_width - 1) / overflow_width;
+
+  // Decode overflow using variable length code.
+  int32 widths = 0;
+  uint32 val;
+  do {
+    val = decoder->DecodeUniform(overflow_width);
+    widths += val;
+  } while (val == max_overflow && widths <= max_widths);
+  if (TF_PREDICT_FALSE(widths > max_widths)) {
+    *corrupted = true;
+    widths = max_widths;
+  }
+  uint32 overflow = 0;
+  for (int32 j = 0; j < widths; ++j) {
+    const uint32 val = decoder->DecodeUniform(overflow_width);
+    DCHECK_LE(val, max_overflow);
+    overflow |= val << (j * overflow_width);
+  }
+  // Map positive values back to integer values.
+  int32 value = overflow >> 1;
+  if (overflow & 1) {
+    value = -value - 1;
+  } else {
+    value += max_value;
+  }
+  return value;
+}
+
+// The values of a floating point tensor, which are quantized as they are
+// coded: the i-th value, coded with the cdf_index-th CDF, is
+// round(data[i] - quantization_offset[cdf_index]). The encode loops take
+// either a span of int32 values or QuantizedValues as `data`, for which size(),
+// subspan(), and Value() are defined.
+template <typename T>
+class QuantizedValues {
+ public:
+  QuantizedValues(const T* data, int64 size, const T* quantization_offset)
+      : data_(data), size_(size), quantization_offset_(quantization_offset) {}
+
+  int64 size() const { return size_; }
+  QuantizedValues subspan(int64 pos, int64 len) const {
+    return QuantizedValues(data_ + pos, len, quantization_offset_);
+  }
+
+  int32 value(int64 i, int32 cdf_index) const {
+    // The difference is rounded to T first, and then rounded half to even,
+    // which matches tf.round(data - quantization_offset).
+    const T difference = data_[i] - quantization_offset_[cdf_index];
+    return static_cast<int32>(std::nearbyint(static_cast<double>(difference)));
+  }
+
+ private:
+  const T* data_;
+  int64 size_;
+  const T* quantization_offset_;
+};
+
+// Returns the i-th value of `data`, which is coded with the cdf_index-th CDF.
+inline int32 Value(absl::Span<const int32> data, int64 i, int32 cdf_index) {
+  return data[i];
+}
+
+template <typename T>
+int32 Value(const QuantizedValues<T>& data, int64 i, int32 cdf_index) {
+  return data.value(i, cdf_index);
+}
+
+// The reverse of QuantizedValues: the i-th decoded value, decoded with the
+// cdf_index-th CDF, is stored as value + quantization_offset[cdf_index] in a
+// floating point tensor. The decode loops take either a span of int32 values
+// or DequantizedValues as `output`, for which size(), subspan(), SetValue(),
+// and DecodedValues() are defined.
+template <typename T>
+class DequantizedValues {
+ public:
+  DequantizedValues(T* data, int64 size, const T* quantization_offset)
+      : data_(data), size_(size), quantization_offset_(quantization_offset) {}
+
+  int64 size() const { return size_; }
+  DequantizedValues subspan(int64 pos, int64 len) const {
+    return DequantizedValues(data_ + pos, len, quantization_offset_);
+  }
+
+  // Same as tf.cast(value, T) + quantization_offset.
+  void set(int64 i, int32 cdf_index, int32 value) const {
+    data_[i] = static_cast<T>(value) + quantization_offset_[cdf_index];
+  }
+
+  // Returns the quantized values. Only used for the metrics, as they can be
+  // inexact for large values in half precision types.
+  QuantizedValues<T> quantized() const {
+    return QuantizedValues<T>(data_, size_, quantization_offset_);
+  }
+
+ private:
+  T* data_;
+  int64 size_;
+  const T* quantization_offset_;
+};
+
+// Stores `value` as the i-th element of `output`.
+inline void SetValue(absl::Span<int32> output, int64 i, int32 cdf_index,
+                     int32 value) {
+  output[i] = value;
+}
+
+template <typename T>
+void SetValue(const DequantizedValues<T>& output, int64 i, int32 cdf_index,
+              int32 value) {
+  output.set(i, cdf_index, value);
+}
+
+// Returns the values stored in `output` in a form accepted by Value().
+inline absl::Span<const int32> DecodedValues(absl::Span<int32> output) {
+  return output;
+}
+
+template <typename T>
+QuantizedValues<T> DecodedValues(const DequantizedValues<T>& output) {
+  return output.quantized();
+}
+
+// The maximum number of axes after MergeAxes() for which `index` can be
+// broadcast to `data`, the same as for `cdf` in RangeEncodeOp.
+constexpr int kMaxBroadcastAxes = 6;
+
+// An `index` tensor broadcast to the shape of `data`, without storing the
+// broadcast values. The coding loops take either a span of int32 values or
+// BroadcastIndex as `index`, for which size(), subspan(), and begin() are
+// defined. The iterator returned by begin() only supports operator* and
+// operator++, and visits the values in the order of the flattened `data`.
+//
+// The iteration is the same as in BroadcastRange of RangeEncodeOp.
+class BroadcastIndex {
+ public:
+  class Iterator {
+   public:
+    int32 operator*() const { return *pointer_; }
+
+    // Does not check whether the iterator runs past the end of the index.
+    Iterator& operator++() {
+      int i = index_->num_axes_ - 1;
+      for (; i > 0; --i) {
+        if (++coordinates_[i] < index_->shape_[i]) {
+          break;
+        }
+        coordinates_[i] = 0;
+      }
+      pointer_ += index_->displace_[i];
+      return *this;
+    }
+
+   private:
+    friend class BroadcastIndex;
+    Iterator(const BroadcastIndex* index, int64 position);
+
+    const BroadcastIndex* index_;
+    const int32* pointer_;
+    std::array<int64, kMaxBroadcastAxes> coordinates_;
+  };
+
+  BroadcastIndex() = default;
+
+  // Returns `index` broadcast to `data_shape` following the NumPy broadcasting
+  // rules. `index` has to outlive the object.
+  static Status Create(const TensorShape& data_shape, const Tensor& index,
+                       BroadcastIndex* broadcast_index);
+
+  int64 size() const { return size_; }
+  BroadcastIndex subspan(int64 pos, int64 len) const {
+    BroadcastIndex result = *this;
+    result.start_ += pos;
+    result.size_ = len;
+    return result;
+  }
+  Iterator begin() const { return Iterator(this, start_); }
+
+ private:
+  const int32* data_ = nullptr;
+  int num_axes_ = 0;
+  std::array<int64, kMaxBroadcastAxes> shape_;
+  // The stride of `index` along each axis, which is 0 for broadcasting axes.
+  std::array<int64, kMaxBroadcastAxes> strides_;
+  // The displacement of the index pointer when the coordinate along an axis
+  // increases by one and all axes after it wrap around to 0.
+  std::array<int64, kMaxBroadcastAxes> displace_;
+  int64 start_ = 0;
+  int64 size_ = 0;
+};
+
+BroadcastIndex::Iterator::Iterator(const BroadcastIndex* index,
+                                   int64 position)
+    : index_(index), pointer_(index->data_) {
+  coordinates_.fill(0);
+  // The shape may have zero-sized axes only if the position is 0.
+  for (int i = index->num_axes_ - 1; i >= 0 && position > 0; --i) {
+    coordinates_[i] = position % index->shape_[i];
+    position /= index->shape_[i];
+    pointer_ += coordinates_[i] * index->strides_[i];
+  }
+}
+
+Status BroadcastIndex::Create(const TensorShape& data_shape,
+                              const Tensor& index,
+                              BroadcastIndex* broadcast_index) {
+  if (index.dims() > data_shape.dims()) {
+    return errors::InvalidArgument(
+        "`index` should be broadcastable to the shape of `data`: data.shape=",
+        data_shape, ", index.shape=", index.shape());
+  }
+  // MergeAxes() takes the shape of `index` with the same number of axes as
+  // `data`, followed by the size of the elements, which is 1.
+  TensorShape storage_shape;
+  for (int i = index.dims(); i < data_shape.dims(); ++i) {
+    storage_shape.AddDim(1);
+  }
+  storage_shape.AppendShape(index.shape());
+  storage_shape.AddDim(1);
+
+  MergedShape merged_data_shape, merged_index_shape;
+  TF_RETURN_IF_ERROR(MergeAxes(data_shape, storage_shape, &merged_data_shape,
+                               &merged_index_shape));
+  const int num_axes = merged_data_shape.size();
+  if (num_axes > kMaxBroadcastAxes) {
+    return errors::InvalidArgument("Irregular broadcast pattern: ", data_shape,
+                                   ", ", index.shape());
+  }
+
+  BroadcastIndex& result = *broadcast_index;
+  result.data_ = index.flat<int32>().data();
+  result.num_axes_ = num_axes;
+  result.start_ = 0;
+  result.size_ = data_shape.num_elements();
+  int64 stride = merged_index_shape[num_axes];
+  for (int i = num_axes - 1; i >= 0; --i) {
+    const bool broadcasting = (merged_index_shape[i] <= 1);
+    result.shape_[i] = merged_data_shape[i];
+    result.strides_[i] = broadcasting ? 0 : stride;
+    result.displace_[i] = merged_index_shape[num_axes];
+    if (broadcasting) {
+      result.displace_[i] -= stride;
+    }
+    stride *= merged_index_shape[i];
+  }
+  return Status::OK();
+}
+
+// Returns the values of `index` as a span, which are copied into `storage` if
+// they are not stored as such.
+inline absl::Span<const int32> IndexSpan(absl::Span<const int32> index,
+                                         std::vector<int32>* storage) {
+  return index;
+}
+
+absl::Span<const int32> IndexSpan(const BroadcastIndex& index,
+                                  std::vector<int32>* storage) {
+  storage->resize(index.size());
+  auto cdf_index = index.begin();
+  for (int64 i = 0; i < index.size(); ++i, ++cdf_index) {
+    (*storage)[i] = *cdf_index;
+  }
+  return *storage;
+}
+
+// Returns the number of values in `data` that are coded with the overflow
+// escape. Only computed for the metrics.
+template <typename Data, typename Index, typename Cdfs>
+int64 CountOverflows(const Data& data, const Index& index, const Cdfs& cdfs,
+                     TTypes<int32>::ConstVec offset) {
+  int64 count = 0;
+  auto cdf_index = index.begin();
+  for (int64 i = 0; i < data.size(); ++i, ++cdf_index) {
+    const int32 value = Value(data, i, *cdf_index) - offset(*cdf_index);
+    count += (value < 0 || value >= cdfs.size(*cdf_index) - 2);
+  }
+  return count;
+}
+
+// Returns the coding order of the values with `index` when the values are
+// grouped by index, i.e., the positions of the values for index 0 in their
+// original order, followed by those for index 1, and so on. The order is
+// derived from `index` alone, so that the encoder and the decoder agree on it.
+//
+// REQUIRES: All elements of `index` are in [0, num_cdfs).
+std::vector<int64> GroupByIndex(absl::Span<const int32> index,
+                                int64 num_cdfs) {
+  // Counting sort, which is stable.
+  std::vector<int64> start(num_cdfs + 1, 0);
+  for (const int32 cdf_index : index) {
+    ++start[cdf_index + 1];
+  }
+  for (int64 i = 0; i < num_cdfs; ++i) {
+    start[i + 1] += start[i];
+  }
+  std::vector<int64> order(index.size());
+  for (int64 i = 0; i < index.size(); ++i) {
+    order[start[index[i]]++] = i;
+  }
+  return order;
+}
+
+// Encodes the overflow of a value that was coded as the escape symbol
+// `max_value`. `value` is the value after subtracting the offset, which is
+// outside of [0, max_value). `Encoder` is either InterleavedRangeEncoder or
+// SinkRangeEncoder.
+template <typename Encoder>
+void EncodeOverflow(Encoder* encoder, int32 value, int32 max_value,
+                    int overflow_width) {
+  // Map value to non-negative integer overflow.
+  // NOTE: It might be a good idea to check overflow is within uint32 range.
+  const uint32 overflow =
+      value < 0 ? -2 * value - 1 : 2 * (value - max_value);
+
+  // Encode overflow using variable length code. The digits are uniformly
+  // distributed, which does not need a CDF.
+  const uint32 max_overflow = (1 << overflow_width) - 1;
+  // The number of digits needed for `overflow`, i.e., the smallest `widths`
+  // such that overflow >> (widths * overflow_width) == 0.
+  const int32 widths =
+      (tensorflow::Log2Floor(overflow) + overflow_width) / overflow_width;
+  uint32 val = widths;
+  while (val >= max_overflow) {
+    encoder->EncodeUniform(max_overflow, overflow_width);
+    val -= max_overflow;
+  }
+  encoder->EncodeUniform(val, overflow_width);
+  for (int32 j = 0; j < widths; ++j) {
+    const uint32 val = (overflow >> (j * overflow_width)) & max_overflow;
+    encoder->EncodeUniform(val, overflow_width);
+  }
+}
+
+// Returns the number of `overflow_width`-bit digits that EncodeOverflow() codes
+// for `value`.
+int32 NumOverflowDigits(int32 value, int32 max_value, int overflow_width) {
+  const uint32 overflow =
+      value < 0 ? -2 * value - 1 : 2 * (value - max_value);
+  const uint32 max_overflow = (1 << overflow_width) - 1;
+  const int32 widths =
+      (tensorflow::Log2Floor(overflow) + overflow_width) / overflow_width;
+  // The digits of `widths`, followed by the digits of `overflow`.
+  return widths / max_overflow + 1 + widths;
+}
+
+// Encodes `value`, after subtracting the offset, with `cdf_slice`, which has
+// `max_value` + 2 entries. Values outside of [0, max_value) are coded as the
+// escape symbol `max_value`, followed by the overflow. `Encoder` is either
+// InterleavedRangeEncoder or SinkRangeEncoder, and `Cdf` is the type returned
+// by PaddedCdfs::row() or PackedCdfs::row().
+template <typename Encoder, typename Cdf, typename Precision>
+void EncodeValue(Encoder* encoder, int32 value, const Cdf& cdf_slice,
+                 int32 max_value, int overflow_width, Precision precision) {
+  if (TF_PREDICT_TRUE(0 <= value && value < max_value)) {
+    encoder->Encode(cdf_slice[value], cdf_slice[value + 1], precision);
+  } else {
+    encoder->Encode(cdf_slice[max_value], cdf_slice[max_value + 1], precision);
+    EncodeOverflow(encoder, value, max_value, overflow_width);
+  }
+}
+
+// A RangeEncoder writing to `sink`, with the interface of
+// InterleavedRangeEncoder. The encoder state may outlive the sink, so that a
+// stream of characters can be encoded into several pieces of output.
+template <typename Sink>
+class SinkRangeEncoder {
+ public:
+  SinkRangeEncoder(RangeEncoder* encoder, Sink* sink)
+      : encoder_(encoder), sink_(sink) {}
+
+  template <typename Precision>
+  void Encode(int32 lower, int32 upper, Precision precision) {
+    encoder_->Encode(lower, upper, precision, sink_);
+  }
+
+  template <typename Precision>
+  void EncodeUniform(int32 value, Precision precision) {
+    encoder_->EncodeUniform(value, precision, sink_);
+  }
+
+ private:
+  RangeEncoder* const encoder_;
+  Sink* const sink_;
+};
+
 class UnboundedIndexRangeEncodeOp : public OpKernel {
  public:
   explicit UnboundedIndexRangeEncodeOp(OpKernelConstruction* context)
@@ -155,6 +722,21 @@ class UnboundedIndexRangeEncodeOp : public OpKernel {
     OP_REQUIRES(context, debug_level_ == 0 || debug_level_ == 1,
                 errors::InvalidArgument("`debug_level` must be 0 or 1: ",
                                         debug_level_));
+    OP_REQUIRES_OK(context, context->GetAttr("num_chunks", &num_chunks_));
+    OP_REQUIRES(context, num_chunks_ > 0,
+                errors::InvalidArgument("`num_chunks` must be positive: ",
+                                        num_chunks_));
+    OP_REQUIRES_OK(context, context->GetAttr("interleave", &interleave_));
+    OP_REQUIRES(context, IsValidInterleave(interleave_),
+                errors::InvalidArgument("`interleave` must be 1, 2, 4, or 8: ",
+                                        interleave_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("group_by_index", &group_by_index_));
+    OP_REQUIRES_OK(context, context->GetAttr("coder_version", &coder_version_));
+    OP_REQUIRES(context, coder_version_ == 1 || coder_version_ == 2,
+                errors::InvalidArgument("`coder_version` must be 1 or 2: ",
+                                        coder_version_));
+    OP_REQUIRES_OK(context, context->GetAttr("checksum", &checksum_));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -164,103 +746,422 @@ class UnboundedIndexRangeEncodeOp : public OpKernel {
     const Tensor& cdf_size = context->input(3);
     const Tensor& offset = context->input(4);
 
-    OP_REQUIRES(
-        context, data.shape() == index.shape(),
-        errors::InvalidArgument(
-            "`data` and `index` should have the same shape: data.shape=",
-            data.shape(), ", index.shape=", index.shape()));
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    // An index of a different shape is broadcast to `data`, which is slower
+    // than indexing a tensor of the same shape.
+    const bool broadcast = (data.shape() != index.shape());
+    BroadcastIndex broadcast_index;
+    if (broadcast) {
+      OP_REQUIRES_OK(context, BroadcastIndex::Create(data.shape(), index,
+                                                     &broadcast_index));
+    }
 
-    OP_REQUIRES_OK(context, CheckArgumentShapes(index, cdf, cdf_size, offset));
+    OP_REQUIRES_OK(context, CheckCdfShapes(cdf, cdf_size, offset));
     if (debug_level_ > 0) {
       OP_REQUIRES_OK(context, CheckArgumentValues(precision_, index, cdf,
                                                   cdf_size, offset));
     }
+    validation.Stop();
 
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
     Tensor* output;
     OP_REQUIRES_OK(context,
                    context->allocate_output(0, TensorShape{}, &output));
 
-    RangeEncodeImpl(data.flat<int32>(), index.flat<int32>(),
-                    cdf.matrix<int32>(), cdf_size.vec<int32>(),
-                    offset.vec<int32>(), &output->flat<tstring>()(0));
+    auto data_flat = data.flat<int32>();
+    auto index_flat = index.flat<int32>();
+    const absl::Span<const int32> data_span(data_flat.data(), data_flat.size());
+    const std::vector<float> entropy =
+        CdfEntropies(precision_, cdf, cdf_size);
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    if (broadcast) {
+      RangeEncodeImpl(data_span, broadcast_index, PaddedCdfs(cdf, cdf_size),
+                      offset.vec<int32>(), entropy, thread_pool,
+                      &output->flat<tstring>()(0), &metrics);
+    } else {
+      RangeEncodeImpl(data_span,
+                      absl::MakeConstSpan(index_flat.data(), index_flat.size()),
+                      PaddedCdfs(cdf, cdf_size), offset.vec<int32>(), entropy,
+                      thread_pool, &output->flat<tstring>()(0), &metrics);
+    }
+  }
+
+ protected:
+  // Encodes `data` into `output`. If `num_chunks` is greater than 1, the
+  // symbols are split into chunks that are coded independently, on
+  // `thread_pool` if it is not null. `entropy` holds the entropy of each CDF,
+  // used to size the output up front. The work is added to `metrics`.
+  template <typename Data, typename Index, typename Cdfs>
+  void RangeEncodeImpl(const Data& data, const Index& index, const Cdfs& cdfs,
+                       TTypes<int32>::ConstVec offset,
+                       absl::Span<const float> entropy,
+                       thread::ThreadPool* thread_pool, tstring* output,
+                       RangeCodingMetrics* metrics) const {
+    if (group_by_index_) {
+      // Codes the values for each CDF consecutively, so that the CDF stays in
+      // cache.
+      std::vector<int32> index_storage;
+      const absl::Span<const int32> index_span =
+          IndexSpan(index, &index_storage);
+      const std::vector<int64> order =
+          GroupByIndex(index_span, cdfs.num_cdfs());
+      std::vector<int32> grouped_data(order.size());
+      std::vector<int32> grouped_index(order.size());
+      for (int64 i = 0; i < order.size(); ++i) {
+        grouped_data[i] = Value(data, order[i], index_span[order[i]]);
+        grouped_index[i] = index_span[order[i]];
+      }
+      RangeEncodeChunks(absl::Span<const int32>(grouped_data),
+                        absl::Span<const int32>(grouped_index), cdfs, offset,
+                        entropy, thread_pool, output, metrics);
+    } else {
+      RangeEncodeChunks(data, index, cdfs, offset, entropy, thread_pool,
+                        output, metrics);
+    }
+    if (checksum_) {
+      AppendChecksum(output);
+    }
+    if (metrics->enabled()) {
+      metrics->AddSymbols(data.size());
+      metrics->AddBytes(output->size());
+      metrics->AddOverflows(CountOverflows(data, index, cdfs, offset));
+    }
   }
 
  private:
-  void RangeEncodeImpl(TTypes<int32>::ConstFlat data,
-                       TTypes<int32>::ConstFlat index,
-                       TTypes<int32>::ConstMatrix cdf,
-                       TTypes<int32>::ConstVec cdf_size,
-                       TTypes<int32>::ConstVec offset, tstring* output) const {
-    RangeEncoder encoder;
+  template <typename Data, typename Index, typename Cdfs>
+  void RangeEncodeChunks(const Data& data, const Index& index,
+                         const Cdfs& cdfs, TTypes<int32>::ConstVec offset,
+                         absl::Span<const float> entropy,
+                         thread::ThreadPool* thread_pool, tstring* output,
+                         RangeCodingMetrics* metrics) const {
+    const int64 size = data.size();
+    const int64 num_chunks = NumChunks(num_chunks_, size);
+    if (num_chunks == 1) {
+      RangeEncodeChunk(data, index, cdfs, offset, entropy, output, metrics);
+      return;
+    }
 
-    DCHECK_GE(cdf.dimension(1), 2);
-    DCHECK_LE(cdf.dimension(1), std::numeric_limits<int16>::max());
-    DCHECK_EQ(cdf.dimension(0), cdf_size.size());
+    std::vector<tstring> chunks(num_chunks);
+    auto encode_chunks = [&](int64 start, int64 limit) {
+      for (int64 i = start; i < limit; ++i) {
+        const int64 chunk_start = ChunkStart(size, num_chunks, i);
+        const int64 chunk_size =
+            ChunkStart(size, num_chunks, i + 1) - chunk_start;
+        RangeEncodeChunk(data.subspan(chunk_start, chunk_size),
+                         index.subspan(chunk_start, chunk_size), cdfs,
+                         offset, entropy, &chunks[i], metrics);
+      }
+    };
+    if (thread_pool != nullptr) {
+      thread_pool->ParallelFor(num_chunks, kCostPerSymbol * size / num_chunks,
+                               encode_chunks);
+    } else {
+      encode_chunks(0, num_chunks);
+    }
+    AppendSegments(chunks, output);
+  }
 
-    const uint32 max_overflow = (1 << overflow_width_) - 1;
+  template <typename Data, typename Index, typename Cdfs>
+  void RangeEncodeChunk(const Data& data, const Index& index,
+                        const Cdfs& cdfs, TTypes<int32>::ConstVec offset,
+                        absl::Span<const float> entropy, tstring* output,
+                        RangeCodingMetrics* metrics) const {
+    if (coder_version_ == 2) {
+      return RangeEncodeInterleave<RangeEncoder64>(data, index, cdfs, offset,
+                                                   entropy, output, metrics);
+    }
+    return RangeEncodeInterleave<RangeEncoder>(data, index, cdfs, offset,
+                                               entropy, output, metrics);
+  }
 
-    const int64 data_size = data.size();
-    for (int64 i = 0; i < data_size; ++i) {
-      const int32 cdf_index = index(i);
+  template <typename Encoder, typename Data, typename Index, typename Cdfs>
+  void RangeEncodeInterleave(const Data& data, const Index& index,
+                             const Cdfs& cdfs, TTypes<int32>::ConstVec offset,
+                             absl::Span<const float> entropy, tstring* output,
+                             RangeCodingMetrics* metrics) const {
+    switch (interleave_) {
+      case 1:
+        return RangeEncodePrecision<Encoder, 1>(data, index, cdfs, offset,
+                                                entropy, output, metrics);
+      case 2:
+        return RangeEncodePrecision<Encoder, 2>(data, index, cdfs, offset,
+                                                entropy, output, metrics);
+      case 4:
+        return RangeEncodePrecision<Encoder, 4>(data, index, cdfs, offset,
+                                                entropy, output, metrics);
+      case 8:
+        return RangeEncodePrecision<Encoder, 8>(data, index, cdfs, offset,
+                                                entropy, output, metrics);
+      default:
+        LOG(FATAL) << "Unexpected interleave: " << interleave_;
+    }
+  }
 
-      DCHECK_GE(cdf_index, 0);
-      DCHECK_LT(cdf_index, cdf.dimension(0));
+  // Specializes the coding loop for the commonly used precisions.
+  template <typename Encoder, int kNumLanes, typename Data, typename Index,
+            typename Cdfs>
+  void RangeEncodePrecision(const Data& data, const Index& index,
+                            const Cdfs& cdfs, TTypes<int32>::ConstVec offset,
+                            absl::Span<const float> entropy, tstring* output,
+                            RangeCodingMetrics* metrics) const {
+    switch (precision_) {
+#define RANGE_ENCODE_PRECISION_CASE(p)                                    \
+  case p:                                                                 \
+    return RangeEncodeLanes<Encoder, kNumLanes>(                          \
+        data, index, cdfs, offset, entropy, StaticPrecision<p>(), output, \
+        metrics);
+      RANGE_ENCODE_PRECISION_CASE(12);
+      RANGE_ENCODE_PRECISION_CASE(14);
+      RANGE_ENCODE_PRECISION_CASE(15);
+      RANGE_ENCODE_PRECISION_CASE(16);
+#undef RANGE_ENCODE_PRECISION_CASE
+      default:
+        return RangeEncodeLanes<Encoder, kNumLanes>(
+            data, index, cdfs, offset, entropy, precision_, output, metrics);
+    }
+  }
 
-      const int32 max_value = cdf_size(cdf_index) - 2;
-      DCHECK_GE(max_value, 0);
-      DCHECK_LT(max_value + 1, cdf.dimension(1));
-
-      int32 value = data(i);
-      // Map values with tracked probabilities to 0..max_value range.
-      value -= offset(cdf_index);
-      // If outside of this range, map value to non-negative integer overflow.
-      // NOTE: It might be a good idea to check overflow is within uint32 range.
-      uint32 overflow = 0;
-      if (value < 0) {
-        overflow = -2 * value - 1;
-        value = max_value;
-      } else if (value >= max_value) {
-        overflow = 2 * (value - max_value);
-        value = max_value;
+  template <typename Encoder, int kNumLanes, typename Data, typename Index,
+            typename Cdfs, typename Precision>
+  void RangeEncodeLanes(const Data& data, const Index& index,
+                        const Cdfs& cdfs, TTypes<int32>::ConstVec offset,
+                        absl::Span<const float> entropy, Precision precision,
+                        tstring* output, RangeCodingMetrics* metrics) const {
+    const int64 data_size = data.size();
+    double bits = 0;
+    auto index_it = index.begin();
+    for (int64 i = 0; i < data_size; ++i, ++index_it) {
+      const int32 cdf_index = *index_it;
+      // Indexes are only checked with debug_level > 0.
+      if (TF_PREDICT_TRUE(0 <= cdf_index && cdf_index < entropy.size())) {
+        bits += entropy[cdf_index];
       }
+    }
 
-      const int32* cdf_slice = &cdf(cdf_index, 0);
-      encoder.Encode(cdf_slice[value], cdf_slice[value + 1], precision_,
-                     output);
+    // A single lane writes directly to `output`.
+    std::array<tstring, kNumLanes> lanes;
+    InterleavedRangeEncoder<kNumLanes, Encoder> encoder(
+        kNumLanes > 1 ? absl::MakeSpan(lanes) : absl::MakeSpan(output, 1),
+        EncodedSizeHint(bits));
 
-      // Encode overflow using variable length code.
-      if (value == max_value) {
-        int32 widths = 0;
-        while (overflow >> (widths * overflow_width_) != 0) {
-          ++widths;
-        }
-        uint32 val = widths;
-        while (val >= max_overflow) {
-          encoder.Encode(max_overflow, max_overflow + 1, overflow_width_,
-                         output);
-          val -= max_overflow;
-        }
-        encoder.Encode(val, val + 1, overflow_width_, output);
-        for (int32 j = 0; j < widths; ++j) {
-          const uint32 val = (overflow >> (j * overflow_width_)) & max_overflow;
-          encoder.Encode(val, val + 1, overflow_width_, output);
+    // The intervals of each block are looked up before the block is coded.
+    // Escaped values keep their value, to code the overflow.
+    std::array<int32, kIntervalBlockSize> lowers;
+    std::array<int32, kIntervalBlockSize> uppers;
+    std::array<int32, kIntervalBlockSize> values;
+    std::array<int32, kIntervalBlockSize> max_values;
+    index_it = index.begin();
+    for (int64 start = 0; start < data_size; start += kIntervalBlockSize) {
+      const int block_size =
+          std::min<int64>(kIntervalBlockSize, data_size - start);
+      for (int j = 0; j < block_size; ++j, ++index_it) {
+        const int32 cdf_index = *index_it;
+
+        DCHECK_GE(cdf_index, 0);
+        DCHECK_LT(cdf_index, cdfs.num_cdfs());
+
+        const int32 max_value = cdfs.size(cdf_index) - 2;
+        DCHECK_GE(max_value, 0);
+
+        const int32 value =
+            Value(data, start + j, cdf_index) - offset(cdf_index);
+        const int32 symbol =
+            (0 <= value && value < max_value) ? value : max_value;
+        const auto cdf_slice = cdfs.row(cdf_index);
+        lowers[j] = cdf_slice[symbol];
+        uppers[j] = cdf_slice[symbol + 1];
+        values[j] = value;
+        max_values[j] = max_value;
+      }
+
+      for (int j = 0; j < block_size; ++j) {
+        encoder.Encode(lowers[j], uppers[j], precision);
+        if (TF_PREDICT_FALSE(values[j] < 0 || values[j] >= max_values[j])) {
+          EncodeOverflow(&encoder, values[j], max_values[j], overflow_width_);
         }
       }
     }
-    encoder.Finalize(output);
+    encoder.Finalize();
+    if (kNumLanes > 1) {
+      AppendSegments(lanes, output);
+    }
+    metrics->AddCarries(encoder.num_carries());
   }
 
+ protected:
   int precision_;
   int overflow_width_;
   int debug_level_;
+  int num_chunks_;
+  int interleave_;
+  bool group_by_index_;
+  int coder_version_;
+  bool checksum_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("UnboundedIndexRangeEncode").Device(DEVICE_CPU),
                         UnboundedIndexRangeEncodeOp);
+// Same as above, but the coding runs on the CPU worker pool after
+// ComputeAsync() returns. See AsyncCodingKernel.
+REGISTER_KERNEL_BUILDER(
+    Name("UnboundedIndexRangeEncode").Device(DEVICE_CPU).Label("async"),
+    AsyncCodingKernel<UnboundedIndexRangeEncodeOp>);
+// The range coder runs on the host. The GPU kernels let the coding ops be
+// placed next to the ops that produce their inputs, with all tensors in host
+// memory. The ops that take a CdfTable are CPU only, as the table is a CPU
+// resource.
+REGISTER_KERNEL_BUILDER(Name("UnboundedIndexRangeEncode")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("data")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("encoded"),
+                        UnboundedIndexRangeEncodeOp);
 
-class UnboundedIndexRangeDecodeOp : public OpKernel {
+class BatchedUnboundedIndexRangeEncodeOp : public UnboundedIndexRangeEncodeOp {
  public:
-  explicit UnboundedIndexRangeDecodeOp(OpKernelConstruction* context)
+  explicit BatchedUnboundedIndexRangeEncodeOp(OpKernelConstruction* context)
+      : UnboundedIndexRangeEncodeOp(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& data = context->input(0);
+    const Tensor& index = context->input(1);
+    const Tensor& cdf = context->input(2);
+    const Tensor& cdf_size = context->input(3);
+    const Tensor& offset = context->input(4);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    OP_REQUIRES_OK(context, CheckCdfShapes(cdf, cdf_size, offset));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckCdfSize(cdf.dim_size(1), cdf_size));
+      OP_REQUIRES_OK(context, CheckCdf(precision_, cdf, cdf_size));
+    }
+    validation.Stop();
+
+    const std::vector<float> entropy =
+        CdfEntropies(precision_, cdf, cdf_size);
+    EncodeBatch(context, data, index, PaddedCdfs(cdf, cdf_size), offset,
+                entropy, &metrics);
+  }
+
+ protected:
+  // Encodes each string in `data` into `output`. Checks the arguments other
+  // than the CDFs, which have been checked by the caller.
+  template <typename Cdfs>
+  void EncodeBatch(OpKernelContext* context, const Tensor& data,
+                   const Tensor& index, const Cdfs& cdfs, const Tensor& offset,
+                   absl::Span<const float> entropy,
+                   RangeCodingMetrics* metrics) const {
+    RangeCodingMetrics::ScopedStage validation(
+        metrics, RangeCodingMetrics::kValidation);
+    OP_REQUIRES(context, data.dims() > 0,
+                errors::InvalidArgument("`data` should be at least 1-D: ",
+                                        data.shape()));
+    const int64 batch_size = data.dim_size(0);
+    TensorShape string_shape = data.shape();
+    string_shape.RemoveDim(0);
+
+    OP_REQUIRES_OK(context, CheckBatchedIndexShape(batch_size, string_shape,
+                                                   index.shape()));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckIndex(cdfs.num_cdfs(), index));
+    }
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(metrics,
+                                           RangeCodingMetrics::kCoding);
+    Tensor* output;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape{batch_size}, &output));
+
+    const int64 string_size = string_shape.num_elements();
+    const bool broadcast_index = (index.dim_size(0) != batch_size);
+    auto data_flat = data.flat<int32>();
+    auto index_flat = index.flat<int32>();
+    auto offset_vec = offset.vec<int32>();
+    auto output_vec = output->vec<tstring>();
+
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        batch_size, kCostPerSymbol * string_size,
+        [&](int64 start, int64 limit) {
+          for (int64 i = start; i < limit; ++i) {
+            const int64 index_start = broadcast_index ? 0 : i * string_size;
+            RangeEncodeImpl(
+                absl::MakeConstSpan(data_flat.data() + i * string_size,
+                                    string_size),
+                absl::MakeConstSpan(index_flat.data() + index_start,
+                                    string_size),
+                cdfs, offset_vec, entropy, nullptr, &output_vec(i), metrics);
+          }
+        });
+  }
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeEncode").Device(DEVICE_CPU),
+    BatchedUnboundedIndexRangeEncodeOp);
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeEncode").Device(DEVICE_CPU).Label("async"),
+    AsyncCodingKernel<BatchedUnboundedIndexRangeEncodeOp>);
+REGISTER_KERNEL_BUILDER(Name("BatchedUnboundedIndexRangeEncode")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("data")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("encoded"),
+                        BatchedUnboundedIndexRangeEncodeOp);
+
+// The cost in bits of coding each symbol, i.e., precision - log2(m) for
+// a symbol of probability mass m / 2^precision, stored like `cdf`, where the
+// last element of each row is unused.
+class SymbolCosts {
+ public:
+  SymbolCosts(int precision, const Tensor& cdf, const Tensor& cdf_size)
+      : cdf_size_(cdf_size.vec<int32>()),
+        stride_(cdf.dim_size(1)),
+        costs_(cdf.NumElements()) {
+    auto matrix = cdf.matrix<int32>();
+    for (int64 i = 0; i < matrix.dimension(0); ++i) {
+      const int64 length =
+          std::min<int64>(std::max<int32>(cdf_size_(i), 1), stride_);
+      for (int64 j = 0; j + 1 < length; ++j) {
+        const int32 mass = matrix(i, j + 1) - matrix(i, j);
+        costs_[i * stride_ + j] =
+            precision - std::log2(static_cast<double>(mass));
+      }
+    }
+  }
+
+  // The escape symbol of the `cdf_index`-th CDF.
+  int32 max_value(int32 cdf_index) const { return cdf_size_(cdf_index) - 2; }
+  float operator()(int32 cdf_index, int32 symbol) const {
+    return costs_[cdf_index * stride_ + symbol];
+  }
+
+ private:
+  TTypes<int32>::ConstVec cdf_size_;
+  int64 stride_;
+  std::vector<float> costs_;
+};
+
+// Kernel of RangeCodingCost op. Sums up the information content of the coded
+// symbols, without running the range coder.
+class RangeCodingCostOp : public OpKernel {
+ public:
+  explicit RangeCodingCostOp(OpKernelConstruction* context)
       : OpKernel(context) {
     OP_REQUIRES_OK(context, context->GetAttr("precision", &precision_));
     OP_REQUIRES(context, 0 < precision_ && precision_ <= 16,
@@ -278,17 +1179,20 @@ class UnboundedIndexRangeDecodeOp : public OpKernel {
   }
 
   void Compute(OpKernelContext* context) override {
-    const Tensor& encoded = context->input(0);
+    const Tensor& data = context->input(0);
     const Tensor& index = context->input(1);
     const Tensor& cdf = context->input(2);
     const Tensor& cdf_size = context->input(3);
     const Tensor& offset = context->input(4);
 
-    OP_REQUIRES(context, encoded.dims() == 0,
-                errors::InvalidArgument("`encoded` should be a scalar: ",
-                                        encoded.shape()));
+    const bool broadcast = (data.shape() != index.shape());
+    BroadcastIndex broadcast_index;
+    if (broadcast) {
+      OP_REQUIRES_OK(context, BroadcastIndex::Create(data.shape(), index,
+                                                     &broadcast_index));
+    }
 
-    OP_REQUIRES_OK(context, CheckArgumentShapes(index, cdf, cdf_size, offset));
+    OP_REQUIRES_OK(context, CheckCdfShapes(cdf, cdf_size, offset));
     if (debug_level_ > 0) {
       OP_REQUIRES_OK(context, CheckArgumentValues(precision_, index, cdf,
                                                   cdf_size, offset));
@@ -296,84 +1200,2414 @@ class UnboundedIndexRangeDecodeOp : public OpKernel {
 
     Tensor* output;
     OP_REQUIRES_OK(context,
-                   context->allocate_output(0, index.shape(), &output));
+                   context->allocate_output(0, TensorShape{}, &output));
 
-    OP_REQUIRES_OK(
-        context, RangeDecodeImpl(output->flat<int32>(), index.flat<int32>(),
-                                 cdf.matrix<int32>(), cdf_size.vec<int32>(),
-                                 offset.vec<int32>(), encoded.flat<tstring>()));
+    auto data_flat = data.flat<int32>();
+    auto index_flat = index.flat<int32>();
+    const absl::Span<const int32> data_span(data_flat.data(), data_flat.size());
+    const SymbolCosts costs(precision_, cdf, cdf_size);
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    double bits;
+    if (broadcast) {
+      bits = Cost(data_span, broadcast_index, costs, offset.vec<int32>(),
+                  thread_pool);
+    } else {
+      bits = Cost(data_span,
+                  absl::MakeConstSpan(index_flat.data(), index_flat.size()),
+                  costs, offset.vec<int32>(), thread_pool);
+    }
+    output->scalar<float>()() = bits;
   }
 
- private:
-  tensorflow::Status RangeDecodeImpl(TTypes<int32>::Flat output,
-                                     TTypes<int32>::ConstFlat index,
-                                     TTypes<int32>::ConstMatrix cdf,
-                                     TTypes<int32>::ConstVec cdf_size,
-                                     TTypes<int32>::ConstVec offset,
-                                     TTypes<tstring>::ConstFlat encoded) const {
-    RangeDecoder decoder(encoded(0));
-
-    DCHECK_GE(cdf.dimension(1), 2);
-    DCHECK_LE(cdf.dimension(1), std::numeric_limits<int16>::max());
+ protected:
+  // Returns the cost of coding `data` in bits. If `thread_pool` is not null,
+  // the values are summed up in blocks on its threads. The result does not
+  // depend on the number of threads.
+  template <typename Index>
+  double Cost(absl::Span<const int32> data, const Index& index,
+              const SymbolCosts& costs, TTypes<int32>::ConstVec offset,
+              thread::ThreadPool* thread_pool) const {
+    constexpr int64 kBlockSize = 1 << 16;
+    const int64 num_blocks = (data.size() + kBlockSize - 1) / kBlockSize;
+    if (thread_pool == nullptr || num_blocks <= 1) {
+      return BlockCost(data, index, costs, offset);
+    }
+    std::vector<double> block_bits(num_blocks);
+    thread_pool->ParallelFor(
+        num_blocks, kCostPerValue * kBlockSize, [&](int64 start, int64 limit) {
+          for (int64 i = start; i < limit; ++i) {
+            const int64 block_start = i * kBlockSize;
+            const int64 block_size =
+                std::min<int64>(kBlockSize, data.size() - block_start);
+            block_bits[i] = BlockCost(data.subspan(block_start, block_size),
+                                      index.subspan(block_start, block_size),
+                                      costs, offset);
+          }
+        });
+    double bits = 0;
+    for (const double b : block_bits) {
+      bits += b;
+    }
+    return bits;
+  }
 
-    const uint32 max_overflow = (1 << overflow_width_) - 1;
-    const int32 overflow_cdf_size = (1 << overflow_width_) + 1;
-    std::vector<int32> overflow_cdf(overflow_cdf_size);
-    std::iota(overflow_cdf.begin(), overflow_cdf.end(), 0);
+  int precision_;
+  int overflow_width_;
+  int debug_level_;
 
-    const int64 output_size = output.size();
-    for (int64 i = 0; i < output_size; ++i) {
-      const int32 cdf_index = index(i);
+ private:
+  template <typename Index>
+  double BlockCost(absl::Span<const int32> data, const Index& index,
+                   const SymbolCosts& costs,
+                   TTypes<int32>::ConstVec offset) const {
+    // Several partial sums, so that the additions do not form a single chain
+    // of dependent instructions.
+    constexpr int kNumSums = 4;
+    std::array<double, kNumSums> sums;
+    sums.fill(0);
+    int64 overflow_digits = 0;
+    auto index_it = index.begin();
+    for (int64 i = 0; i < data.size(); ++i, ++index_it) {
+      const int32 cdf_index = *index_it;
 
       DCHECK_GE(cdf_index, 0);
-      DCHECK_LT(cdf_index, cdf.dimension(0));
+      DCHECK_LT(cdf_index, offset.size());
 
-      const int32 max_value = cdf_size(cdf_index) - 2;
-      DCHECK_GE(max_value, 0);
-      DCHECK_LT(max_value + 1, cdf.dimension(1));
-
-      const int32* cdf_slice = &cdf(cdf_index, 0);
-      int32 value = decoder.Decode(
-          absl::Span<const int32>(cdf_slice, max_value + 2), precision_);
-
-      // Decode overflow using variable length code.
-      if (value == max_value) {
-        int32 widths = 0;
-        uint32 val;
-        do {
-          val = decoder.Decode(overflow_cdf, overflow_width_);
-          widths += val;
-        } while (val == max_overflow);
-        uint32 overflow = 0;
-        for (int32 j = 0; j < widths; ++j) {
-          const uint32 val = decoder.Decode(overflow_cdf, overflow_width_);
-          DCHECK_LE(val, max_overflow);
-          overflow |= val << (j * overflow_width_);
-        }
-        // Map positive values back to integer values.
-        value = overflow >> 1;
-        if (overflow & 1) {
-          value = -value - 1;
-        } else {
-          value += max_value;
-        }
+      const int32 max_value = costs.max_value(cdf_index);
+      const int32 value = data[i] - offset(cdf_index);
+      if (TF_PREDICT_TRUE(0 <= value && value < max_value)) {
+        sums[i % kNumSums] += costs(cdf_index, value);
+      } else {
+        sums[i % kNumSums] += costs(cdf_index, max_value);
+        overflow_digits +=
+            NumOverflowDigits(value, max_value, overflow_width_);
       }
-
-      // Map values in 0..max_range range back to original integer range.
-      value += offset(cdf_index);
-      output(i) = value;
     }
-
-    return tensorflow::Status::OK();
+    double bits = static_cast<double>(overflow_digits) * overflow_width_;
+    for (const double sum : sums) {
+      bits += sum;
+    }
+    return bits;
   }
-
-  int precision_;
-  int overflow_width_;
-  int debug_level_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("RangeCodingCost").Device(DEVICE_CPU),
+                        RangeCodingCostOp);
+REGISTER_KERNEL_BUILDER(Name("RangeCodingCost")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("data")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("cost"),
+                        RangeCodingCostOp);
+
+class BatchedRangeCodingCostOp : public RangeCodingCostOp {
+ public:
+  explicit BatchedRangeCodingCostOp(OpKernelConstruction* context)
+      : RangeCodingCostOp(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& data = context->input(0);
+    const Tensor& index = context->input(1);
+    const Tensor& cdf = context->input(2);
+    const Tensor& cdf_size = context->input(3);
+    const Tensor& offset = context->input(4);
+
+    OP_REQUIRES(context, data.dims() > 0,
+                errors::InvalidArgument("`data` should be at least 1-D: ",
+                                        data.shape()));
+    const int64 batch_size = data.dim_size(0);
+    TensorShape string_shape = data.shape();
+    string_shape.RemoveDim(0);
+
+    OP_REQUIRES_OK(context, CheckBatchedIndexShape(batch_size, string_shape,
+                                                   index.shape()));
+    OP_REQUIRES_OK(context, CheckCdfShapes(cdf, cdf_size, offset));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckArgumentValues(precision_, index, cdf,
+                                                  cdf_size, offset));
+    }
+
+    Tensor* output;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape{batch_size}, &output));
+
+    const int64 string_size = string_shape.num_elements();
+    const bool broadcast_index = (index.dim_size(0) != batch_size);
+    auto data_flat = data.flat<int32>();
+    auto index_flat = index.flat<int32>();
+    auto offset_vec = offset.vec<int32>();
+    auto output_vec = output->vec<float>();
+    const SymbolCosts costs(precision_, cdf, cdf_size);
+
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        batch_size, kCostPerValue * string_size,
+        [&](int64 start, int64 limit) {
+          for (int64 i = start; i < limit; ++i) {
+            const int64 index_start = broadcast_index ? 0 : i * string_size;
+            output_vec(i) =
+                Cost(absl::MakeConstSpan(data_flat.data() + i * string_size,
+                                         string_size),
+                     absl::MakeConstSpan(index_flat.data() + index_start,
+                                         string_size),
+                     costs, offset_vec, nullptr);
+          }
+        });
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("BatchedRangeCodingCost").Device(DEVICE_CPU),
+                        BatchedRangeCodingCostOp);
+REGISTER_KERNEL_BUILDER(Name("BatchedRangeCodingCost")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("data")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("cost"),
+                        BatchedRangeCodingCostOp);
+
+class UnboundedIndexRangeDecodeOp : public OpKernel {
+ public:
+  explicit UnboundedIndexRangeDecodeOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("precision", &precision_));
+    OP_REQUIRES(context, 0 < precision_ && precision_ <= 16,
+                errors::InvalidArgument("`precision` must be in [1, 16]: ",
+                                        precision_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("overflow_width", &overflow_width_));
+    OP_REQUIRES(context, 0 < overflow_width_ && overflow_width_ <= 16,
+                errors::InvalidArgument("`overflow_width` must be in [1, 16]: ",
+                                        overflow_width_));
+    OP_REQUIRES_OK(context, context->GetAttr("debug_level", &debug_level_));
+    OP_REQUIRES(context, debug_level_ == 0 || debug_level_ == 1,
+                errors::InvalidArgument("`debug_level` must be 0 or 1: ",
+                                        debug_level_));
+    OP_REQUIRES_OK(context, context->GetAttr("num_chunks", &num_chunks_));
+    OP_REQUIRES(context, num_chunks_ > 0,
+                errors::InvalidArgument("`num_chunks` must be positive: ",
+                                        num_chunks_));
+    OP_REQUIRES_OK(context, context->GetAttr("interleave", &interleave_));
+    OP_REQUIRES(context, IsValidInterleave(interleave_),
+                errors::InvalidArgument("`interleave` must be 1, 2, 4, or 8: ",
+                                        interleave_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("group_by_index", &group_by_index_));
+    OP_REQUIRES_OK(context, context->GetAttr("coder_version", &coder_version_));
+    OP_REQUIRES(context, coder_version_ == 1 || coder_version_ == 2,
+                errors::InvalidArgument("`coder_version` must be 1 or 2: ",
+                                        coder_version_));
+    OP_REQUIRES_OK(context, context->GetAttr("checksum", &checksum_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& encoded = context->input(0);
+    const Tensor& index = context->input(1);
+    const Tensor& cdf = context->input(2);
+    const Tensor& cdf_size = context->input(3);
+    const Tensor& offset = context->input(4);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    OP_REQUIRES(context, encoded.dims() == 0,
+                errors::InvalidArgument("`encoded` should be a scalar: ",
+                                        encoded.shape()));
+
+    OP_REQUIRES_OK(context, CheckCdfShapes(cdf, cdf_size, offset));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckArgumentValues(precision_, index, cdf,
+                                                  cdf_size, offset));
+    }
+    DecodeTable table;
+    OP_REQUIRES_OK(context, GetDecodeTable(context, 5, cdf, &table));
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
+    Tensor* output;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, index.shape(), &output));
+
+    auto output_flat = output->flat<int32>();
+    auto index_flat = index.flat<int32>();
+    OP_REQUIRES_OK(
+        context,
+        RangeDecodeImpl(
+            absl::MakeSpan(output_flat.data(), output_flat.size()),
+            absl::MakeConstSpan(index_flat.data(), index_flat.size()),
+            PaddedCdfs(cdf, cdf_size), offset.vec<int32>(), table,
+            encoded.scalar<tstring>()(),
+            context->device()->tensorflow_cpu_worker_threads()->workers,
+            &metrics));
+  }
+
+ protected:
+  // The *WithTable ops have a decode table from CdfToDecodeTable op as an
+  // extra input at `table_input`. Otherwise, `table->data` is set to null.
+  tensorflow::Status GetDecodeTable(OpKernelContext* context, int table_input,
+                                    const Tensor& cdf,
+                                    DecodeTable* table) const {
+    if (context->num_inputs() > table_input) {
+      const Tensor& table_tensor = context->input(table_input);
+      TF_RETURN_IF_ERROR(CheckDecodeTableShape(
+          cdf.shape(), table_tensor.shape(), precision_, &table->bits));
+      table->data = table_tensor.flat<int16>().data();
+    } else {
+      table->data = nullptr;
+    }
+    return tensorflow::Status::OK();
+  }
+
+  // Decodes `encoded` into `output`. If `num_chunks` is greater than 1, the
+  // chunks are decoded independently, on `thread_pool` if it is not null. The
+  // work is added to `metrics`.
+  template <typename Output, typename Index, typename Cdfs>
+  tensorflow::Status RangeDecodeImpl(const Output& output, const Index& index,
+                                     const Cdfs& cdfs,
+                                     TTypes<int32>::ConstVec offset,
+                                     const DecodeTable& table,
+                                     const tstring& encoded,
+                                     thread::ThreadPool* thread_pool,
+                                     RangeCodingMetrics* metrics) const {
+    return RangeDecodeImpl(output, index, cdfs, offset, table,
+                           absl::string_view(encoded.data(), encoded.size()),
+                           thread_pool, metrics);
+  }
+
+  // Same as above, but decodes a part of a string, e.g., one of its segments.
+  template <typename Output, typename Index, typename Cdfs>
+  tensorflow::Status RangeDecodeImpl(const Output& output, const Index& index,
+                                     const Cdfs& cdfs,
+                                     TTypes<int32>::ConstVec offset,
+                                     const DecodeTable& table,
+                                     absl::string_view encoded,
+                                     thread::ThreadPool* thread_pool,
+                                     RangeCodingMetrics* metrics) const {
+    absl::string_view bitstream = encoded;
+    if (checksum_) {
+      TF_RETURN_IF_ERROR(RemoveChecksum(&bitstream));
+    }
+    if (group_by_index_) {
+      // Reverse of the grouping in UnboundedIndexRangeEncodeOp.
+      std::vector<int32> index_storage;
+      const absl::Span<const int32> index_span =
+          IndexSpan(index, &index_storage);
+      const std::vector<int64> order =
+          GroupByIndex(index_span, cdfs.num_cdfs());
+      std::vector<int32> grouped_index(order.size());
+      for (int64 i = 0; i < order.size(); ++i) {
+        grouped_index[i] = index_span[order[i]];
+      }
+      std::vector<int32> grouped_output(order.size());
+      TF_RETURN_IF_ERROR(RangeDecodeChunks(
+          absl::MakeSpan(grouped_output),
+          absl::Span<const int32>(grouped_index), cdfs, offset, table,
+          bitstream, thread_pool));
+      for (int64 i = 0; i < order.size(); ++i) {
+        SetValue(output, order[i], index_span[order[i]], grouped_output[i]);
+      }
+    } else {
+      TF_RETURN_IF_ERROR(RangeDecodeChunks(output, index, cdfs, offset, table,
+                                           bitstream, thread_pool));
+    }
+    if (metrics->enabled()) {
+      metrics->AddSymbols(output.size());
+      metrics->AddBytes(encoded.size());
+      metrics->AddOverflows(
+          CountOverflows(DecodedValues(output), index, cdfs, offset));
+    }
+    return tensorflow::Status::OK();
+  }
+
+ private:
+  template <typename Output, typename Index, typename Cdfs>
+  tensorflow::Status RangeDecodeChunks(const Output& output,
+                                       const Index& index,
+                                       const Cdfs& cdfs,
+                                       TTypes<int32>::ConstVec offset,
+                                       const DecodeTable& table,
+                                       absl::string_view encoded,
+                                       thread::ThreadPool* thread_pool) const {
+    const int64 size = output.size();
+    const int64 num_chunks = NumChunks(num_chunks_, size);
+    if (num_chunks == 1) {
+      return RangeDecodeChunk(output, index, cdfs, offset, table, encoded);
+    }
+
+    std::vector<absl::string_view> chunks(num_chunks);
+    TF_RETURN_IF_ERROR(SplitSegments(encoded, absl::MakeSpan(chunks)));
+    std::vector<tensorflow::Status> status(num_chunks);
+    auto decode_chunks = [&](int64 start, int64 limit) {
+      for (int64 i = start; i < limit; ++i) {
+        const int64 chunk_start = ChunkStart(size, num_chunks, i);
+        const int64 chunk_size =
+            ChunkStart(size, num_chunks, i + 1) - chunk_start;
+        status[i] = RangeDecodeChunk(output.subspan(chunk_start, chunk_size),
+                                     index.subspan(chunk_start, chunk_size),
+                                     cdfs, offset, table, chunks[i]);
+      }
+    };
+    if (thread_pool != nullptr) {
+      thread_pool->ParallelFor(num_chunks, kCostPerSymbol * size / num_chunks,
+                               decode_chunks);
+    } else {
+      decode_chunks(0, num_chunks);
+    }
+    for (const tensorflow::Status& s : status) {
+      TF_RETURN_IF_ERROR(s);
+    }
+    return tensorflow::Status::OK();
+  }
+
+  template <typename Output, typename Index, typename Cdfs>
+  tensorflow::Status RangeDecodeChunk(const Output& output,
+                                      const Index& index,
+                                      const Cdfs& cdfs,
+                                      TTypes<int32>::ConstVec offset,
+                                      const DecodeTable& table,
+                                      absl::string_view encoded) const {
+    if (coder_version_ == 2) {
+      return RangeDecodeInterleave<RangeDecoder64>(output, index, cdfs, offset,
+                                                   table, encoded);
+    }
+    return RangeDecodeInterleave<RangeDecoder>(output, index, cdfs, offset,
+                                               table, encoded);
+  }
+
+  template <typename Decoder, typename Output, typename Index, typename Cdfs>
+  tensorflow::Status RangeDecodeInterleave(const Output& output,
+                                           const Index& index,
+                                           const Cdfs& cdfs,
+                                           TTypes<int32>::ConstVec offset,
+                                           const DecodeTable& table,
+                                           absl::string_view encoded) const {
+    switch (interleave_) {
+      case 1:
+        return RangeDecodePrecision<Decoder, 1>(output, index, cdfs, offset,
+                                                table, encoded);
+      case 2:
+        return RangeDecodePrecision<Decoder, 2>(output, index, cdfs, offset,
+                                                table, encoded);
+      case 4:
+        return RangeDecodePrecision<Decoder, 4>(output, index, cdfs, offset,
+                                                table, encoded);
+      case 8:
+        return RangeDecodePrecision<Decoder, 8>(output, index, cdfs, offset,
+                                                table, encoded);
+      default:
+        return errors::Internal("Unexpected interleave: ", interleave_);
+    }
+  }
+
+  // Specializes the coding loop for the commonly used precisions.
+  template <typename Decoder, int kNumLanes, typename Output, typename Index,
+            typename Cdfs>
+  tensorflow::Status RangeDecodePrecision(const Output& output,
+                                          const Index& index,
+                                          const Cdfs& cdfs,
+                                          TTypes<int32>::ConstVec offset,
+                                          const DecodeTable& table,
+                                          absl::string_view encoded) const {
+    switch (precision_) {
+#define RANGE_DECODE_PRECISION_CASE(p)           \
+  case p:                                        \
+    return RangeDecodeLanes<Decoder, kNumLanes>( \
+        output, index, cdfs, offset, table, StaticPrecision<p>(), encoded);
+      RANGE_DECODE_PRECISION_CASE(12);
+      RANGE_DECODE_PRECISION_CASE(14);
+      RANGE_DECODE_PRECISION_CASE(15);
+      RANGE_DECODE_PRECISION_CASE(16);
+#undef RANGE_DECODE_PRECISION_CASE
+      default:
+        return RangeDecodeLanes<Decoder, kNumLanes>(
+            output, index, cdfs, offset, table, precision_, encoded);
+    }
+  }
+
+  template <typename Decoder, int kNumLanes, typename Output, typename Index,
+            typename Cdfs, typename Precision>
+  tensorflow::Status RangeDecodeLanes(const Output& output,
+                                      const Index& index,
+                                      const Cdfs& cdfs,
+                                      TTypes<int32>::ConstVec offset,
+                                      const DecodeTable& table,
+                                      Precision precision,
+                                      absl::string_view encoded) const {
+    std::array<absl::string_view, kNumLanes> lanes;
+    TF_RETURN_IF_ERROR(SplitSegments(encoded, absl::MakeSpan(lanes)));
+    InterleavedRangeDecoder<kNumLanes, Decoder> decoder(lanes);
+    bool corrupted = false;
+
+    const int64 output_size = output.size();
+    auto index_it = index.begin();
+    for (int64 i = 0; i < output_size; ++i, ++index_it) {
+      const int32 cdf_index = *index_it;
+
+      DCHECK_GE(cdf_index, 0);
+      DCHECK_LT(cdf_index, cdfs.num_cdfs());
+
+      const int32 max_value = cdfs.size(cdf_index) - 2;
+      DCHECK_GE(max_value, 0);
+
+      int32 value = DecodeSymbol(&decoder, cdfs.slice(cdf_index), table,
+                                 cdf_index, precision);
+
+      if (TF_PREDICT_FALSE(value == max_value)) {
+        value = DecodeOverflow(&decoder, overflow_width_, max_value,
+                               &corrupted);
+      }
+
+      // Map values in 0..max_range range back to original integer range.
+      value += offset(cdf_index);
+      SetValue(output, i, cdf_index, value);
+    }
+    // Decoding errors are sticky, and checked once for the whole chunk.
+    if (TF_PREDICT_FALSE(corrupted || decoder.corrupted())) {
+      return errors::InvalidArgument("`encoded` is corrupt");
+    }
+    return tensorflow::Status::OK();
+  }
+
+ protected:
+  int precision_;
+  int overflow_width_;
+  int debug_level_;
+  int num_chunks_;
+  int interleave_;
+  bool group_by_index_;
+  int coder_version_;
+  bool checksum_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("UnboundedIndexRangeDecode").Device(DEVICE_CPU),
                         UnboundedIndexRangeDecodeOp);
+REGISTER_KERNEL_BUILDER(
+    Name("UnboundedIndexRangeDecodeWithTable").Device(DEVICE_CPU),
+    UnboundedIndexRangeDecodeOp);
+REGISTER_KERNEL_BUILDER(
+    Name("UnboundedIndexRangeDecode").Device(DEVICE_CPU).Label("async"),
+    AsyncCodingKernel<UnboundedIndexRangeDecodeOp>);
+REGISTER_KERNEL_BUILDER(
+    Name("UnboundedIndexRangeDecodeWithTable")
+        .Device(DEVICE_CPU)
+        .Label("async"),
+    AsyncCodingKernel<UnboundedIndexRangeDecodeOp>);
+REGISTER_KERNEL_BUILDER(Name("UnboundedIndexRangeDecode")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("encoded")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("decoded"),
+                        UnboundedIndexRangeDecodeOp);
+REGISTER_KERNEL_BUILDER(Name("UnboundedIndexRangeDecodeWithTable")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("encoded")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("decode_table")
+                            .HostMemory("decoded"),
+                        UnboundedIndexRangeDecodeOp);
+
+// Same as UnboundedIndexRangeDecodeOp, except that the output shape is given
+// by `shape`, to which `index` is broadcast.
+class UnboundedIndexRangeDecodeWithShapeOp
+    : public UnboundedIndexRangeDecodeOp {
+ public:
+  explicit UnboundedIndexRangeDecodeWithShapeOp(OpKernelConstruction* context)
+      : UnboundedIndexRangeDecodeOp(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& encoded = context->input(0);
+    const Tensor& shape = context->input(1);
+    const Tensor& index = context->input(2);
+    const Tensor& cdf = context->input(3);
+    const Tensor& cdf_size = context->input(4);
+    const Tensor& offset = context->input(5);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    OP_REQUIRES(context, encoded.dims() == 0,
+                errors::InvalidArgument("`encoded` should be a scalar: ",
+                                        encoded.shape()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(shape.shape()),
+                errors::InvalidArgument("`shape` should be a vector: ",
+                                        shape.shape()));
+    TensorShape output_shape;
+    OP_REQUIRES_OK(context, TensorShapeUtils::MakeShape(shape.vec<int32>(),
+                                                        &output_shape));
+    const bool broadcast = (output_shape != index.shape());
+    BroadcastIndex broadcast_index;
+    if (broadcast) {
+      OP_REQUIRES_OK(context, BroadcastIndex::Create(output_shape, index,
+                                                     &broadcast_index));
+    }
+
+    OP_REQUIRES_OK(context, CheckCdfShapes(cdf, cdf_size, offset));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckArgumentValues(precision_, index, cdf,
+                                                  cdf_size, offset));
+    }
+    DecodeTable table;
+    OP_REQUIRES_OK(context, GetDecodeTable(context, 6, cdf, &table));
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
+    Tensor* output;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, output_shape, &output));
+
+    auto output_flat = output->flat<int32>();
+    auto index_flat = index.flat<int32>();
+    const absl::Span<int32> output_span(output_flat.data(), output_flat.size());
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    if (broadcast) {
+      OP_REQUIRES_OK(
+          context, RangeDecodeImpl(output_span, broadcast_index,
+                                   PaddedCdfs(cdf, cdf_size),
+                                   offset.vec<int32>(), table,
+                                   encoded.scalar<tstring>()(), thread_pool,
+                                   &metrics));
+    } else {
+      OP_REQUIRES_OK(
+          context,
+          RangeDecodeImpl(
+              output_span,
+              absl::MakeConstSpan(index_flat.data(), index_flat.size()),
+              PaddedCdfs(cdf, cdf_size), offset.vec<int32>(), table,
+              encoded.scalar<tstring>()(), thread_pool, &metrics));
+    }
+  }
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("UnboundedIndexRangeDecodeWithShape").Device(DEVICE_CPU),
+    UnboundedIndexRangeDecodeWithShapeOp);
+REGISTER_KERNEL_BUILDER(
+    Name("UnboundedIndexRangeDecodeWithShapeAndTable").Device(DEVICE_CPU),
+    UnboundedIndexRangeDecodeWithShapeOp);
+REGISTER_KERNEL_BUILDER(
+    Name("UnboundedIndexRangeDecodeWithShape")
+        .Device(DEVICE_CPU)
+        .Label("async"),
+    AsyncCodingKernel<UnboundedIndexRangeDecodeWithShapeOp>);
+REGISTER_KERNEL_BUILDER(
+    Name("UnboundedIndexRangeDecodeWithShapeAndTable")
+        .Device(DEVICE_CPU)
+        .Label("async"),
+    AsyncCodingKernel<UnboundedIndexRangeDecodeWithShapeOp>);
+REGISTER_KERNEL_BUILDER(Name("UnboundedIndexRangeDecodeWithShape")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("encoded")
+                            .HostMemory("shape")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("decoded"),
+                        UnboundedIndexRangeDecodeWithShapeOp);
+REGISTER_KERNEL_BUILDER(Name("UnboundedIndexRangeDecodeWithShapeAndTable")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("encoded")
+                            .HostMemory("shape")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("decode_table")
+                            .HostMemory("decoded"),
+                        UnboundedIndexRangeDecodeWithShapeOp);
+
+// Splits the leading axes of a tensor into tiles for the tiled range coding
+// ops. The tiles are ordered in row-major order of their positions in the
+// grid, and the elements of each tile are in row-major order as well. The
+// index is broadcast to the tensor, as in UnboundedIndexRangeEncode.
+class TileGrid {
+ public:
+  // Checks that `tile_shape` has positive elements, and at most as many as
+  // `shape` has dimensions, and that `index_shape` can be broadcast to
+  // `shape`.
+  static tensorflow::Status Create(const TensorShape& shape,
+                                   absl::Span<const int32> tile_shape,
+                                   const TensorShape& index_shape,
+                                   TileGrid* grid) {
+    if (tile_shape.empty() ||
+        shape.dims() < static_cast<int>(tile_shape.size())) {
+      return errors::InvalidArgument(
+          "`tile_shape` should have at least 1 and at most ", shape.dims(),
+          " elements: ", tile_shape.size());
+    }
+    for (const int32 tile_size : tile_shape) {
+      if (tile_size <= 0) {
+        return errors::InvalidArgument(
+            "The elements of `tile_shape` should be positive: ", tile_size);
+      }
+    }
+    const int dims = shape.dims();
+    const int index_dims = index_shape.dims();
+    if (dims < index_dims) {
+      return errors::InvalidArgument(
+          "`index` should have at most as many dimensions as the data: ",
+          index_shape, " vs. ", shape);
+    }
+    grid->shape_.resize(dims);
+    grid->data_strides_.resize(dims);
+    grid->index_strides_.resize(dims);
+    int64 data_stride = 1;
+    int64 index_stride = 1;
+    for (int i = dims - 1; i >= 0; --i) {
+      const int64 size = shape.dim_size(i);
+      const int j = i - (dims - index_dims);
+      const int64 index_size = j >= 0 ? index_shape.dim_size(j) : 1;
+      if (index_size != size && index_size != 1) {
+        return errors::InvalidArgument(
+            "`index` cannot be broadcast to the shape of the data: ",
+            index_shape, " vs. ", shape);
+      }
+      grid->shape_[i] = size;
+      grid->data_strides_[i] = data_stride;
+      grid->index_strides_[i] = index_size == 1 ? 0 : index_stride;
+      data_stride *= size;
+      index_stride *= index_size;
+    }
+
+    grid->tile_shape_.assign(tile_shape.begin(), tile_shape.end());
+    grid->grid_shape_.resize(tile_shape.size());
+    grid->num_tiles_ = 1;
+    for (size_t i = 0; i < tile_shape.size(); ++i) {
+      grid->grid_shape_[i] = (shape.dim_size(i) + tile_shape[i] - 1) /
+                             tile_shape[i];
+      grid->num_tiles_ *= grid->grid_shape_[i];
+    }
+    return tensorflow::Status::OK();
+  }
+
+  int dims() const { return shape_.size(); }
+  int tiled_dims() const { return tile_shape_.size(); }
+  int64 num_tiles() const { return num_tiles_; }
+  absl::Span<const int64> shape() const { return shape_; }
+  absl::Span<const int64> tile_shape() const { return tile_shape_; }
+  absl::Span<const int64> grid_shape() const { return grid_shape_; }
+
+  // Sets `*start` and `*size` to the box of elements in tile `tile`.
+  void TileBox(int64 tile, std::vector<int64>* start,
+               std::vector<int64>* size) const {
+    start->assign(dims(), 0);
+    size->assign(shape_.begin(), shape_.end());
+    for (int i = tiled_dims() - 1; i >= 0; --i) {
+      const int64 position = tile % grid_shape_[i];
+      tile /= grid_shape_[i];
+      (*start)[i] = position * tile_shape_[i];
+      (*size)[i] = std::min(tile_shape_[i], shape_[i] - (*start)[i]);
+    }
+  }
+
+  // Calls `fn(data_offset, index_offset, element)` for each element of the box
+  // [`start`, `start` + `size`) in row-major order, where `element` holds its
+  // coordinates, and the offsets are its positions in the flattened data and
+  // index.
+  template <typename Fn>
+  void ForEachElement(absl::Span<const int64> start,
+                      absl::Span<const int64> size, Fn fn) const {
+    for (const int64 s : size) {
+      if (s == 0) return;
+    }
+    std::vector<int64> element(start.begin(), start.end());
+    int64 data_offset = 0;
+    int64 index_offset = 0;
+    for (int i = 0; i < dims(); ++i) {
+      data_offset += start[i] * data_strides_[i];
+      index_offset += start[i] * index_strides_[i];
+    }
+    while (true) {
+      fn(data_offset, index_offset, absl::Span<const int64>(element));
+      // Advances to the next element like an odometer.
+      int i = dims() - 1;
+      for (; i >= 0; --i) {
+        ++element[i];
+        data_offset += data_strides_[i];
+        index_offset += index_strides_[i];
+        if (element[i] < start[i] + size[i]) break;
+        data_offset -= size[i] * data_strides_[i];
+        index_offset -= size[i] * index_strides_[i];
+        element[i] = start[i];
+      }
+      if (i < 0) return;
+    }
+  }
+
+ private:
+  std::vector<int64> shape_;
+  std::vector<int64> tile_shape_;
+  std::vector<int64> grid_shape_;
+  std::vector<int64> data_strides_;
+  std::vector<int64> index_strides_;
+  int64 num_tiles_;
+};
+
+class TiledUnboundedIndexRangeEncodeOp : public UnboundedIndexRangeEncodeOp {
+ public:
+  explicit TiledUnboundedIndexRangeEncodeOp(OpKernelConstruction* context)
+      : UnboundedIndexRangeEncodeOp(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("tile_shape", &tile_shape_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& data = context->input(0);
+    const Tensor& index = context->input(1);
+    const Tensor& cdf = context->input(2);
+    const Tensor& cdf_size = context->input(3);
+    const Tensor& offset = context->input(4);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    TileGrid grid;
+    OP_REQUIRES_OK(context, TileGrid::Create(data.shape(), tile_shape_,
+                                             index.shape(), &grid));
+    OP_REQUIRES_OK(context, CheckCdfShapes(cdf, cdf_size, offset));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckArgumentValues(precision_, index, cdf,
+                                                  cdf_size, offset));
+    }
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
+    Tensor* output;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape{}, &output));
+
+    auto data_flat = data.flat<int32>();
+    auto index_flat = index.flat<int32>();
+    const PaddedCdfs cdfs(cdf, cdf_size);
+    auto offset_vec = offset.vec<int32>();
+    const std::vector<float> entropy =
+        CdfEntropies(precision_, cdf, cdf_size);
+
+    const int64 num_tiles = grid.num_tiles();
+    std::vector<tstring> tiles(num_tiles);
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    const int64 cost_per_tile =
+        kCostPerSymbol * data.NumElements() / std::max<int64>(num_tiles, 1);
+    thread_pool->ParallelFor(
+        num_tiles, cost_per_tile, [&](int64 start, int64 limit) {
+          std::vector<int64> tile_start, tile_size;
+          std::vector<int32> tile_data;
+          std::vector<int32> tile_index;
+          for (int64 i = start; i < limit; ++i) {
+            // Each tile is gathered and coded like a tensor of its own.
+            grid.TileBox(i, &tile_start, &tile_size);
+            tile_data.clear();
+            tile_index.clear();
+            grid.ForEachElement(
+                tile_start, tile_size,
+                [&](int64 data_offset, int64 index_offset,
+                    absl::Span<const int64>) {
+                  tile_data.push_back(data_flat(data_offset));
+                  tile_index.push_back(index_flat(index_offset));
+                });
+            RangeEncodeImpl(absl::Span<const int32>(tile_data),
+                            absl::Span<const int32>(tile_index), cdfs,
+                            offset_vec, entropy, nullptr, &tiles[i],
+                            &metrics);
+          }
+        });
+    AppendSegments(tiles, &output->scalar<tstring>()());
+  }
+
+ private:
+  std::vector<int32> tile_shape_;
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("TiledUnboundedIndexRangeEncode").Device(DEVICE_CPU),
+    TiledUnboundedIndexRangeEncodeOp);
+
+class TiledUnboundedIndexRangeDecodeOp : public UnboundedIndexRangeDecodeOp {
+ public:
+  explicit TiledUnboundedIndexRangeDecodeOp(OpKernelConstruction* context)
+      : UnboundedIndexRangeDecodeOp(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("tile_shape", &tile_shape_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& encoded = context->input(0);
+    const Tensor& shape = context->input(1);
+    const Tensor& begin = context->input(2);
+    const Tensor& size = context->input(3);
+    const Tensor& index = context->input(4);
+    const Tensor& cdf = context->input(5);
+    const Tensor& cdf_size = context->input(6);
+    const Tensor& offset = context->input(7);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    OP_REQUIRES(context, encoded.dims() == 0,
+                errors::InvalidArgument("`encoded` should be a scalar: ",
+                                        encoded.shape()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(shape.shape()),
+                errors::InvalidArgument("`shape` should be a vector: ",
+                                        shape.shape()));
+    TensorShape data_shape;
+    OP_REQUIRES_OK(context, TensorShapeUtils::MakeShape(shape.vec<int32>(),
+                                                        &data_shape));
+    TileGrid grid;
+    OP_REQUIRES_OK(context, TileGrid::Create(data_shape, tile_shape_,
+                                             index.shape(), &grid));
+
+    // The region covers the tiled axes as given, and the other axes entirely.
+    const int tiled_dims = grid.tiled_dims();
+    OP_REQUIRES(
+        context,
+        TensorShapeUtils::IsVector(begin.shape()) &&
+            begin.NumElements() == tiled_dims && begin.shape() == size.shape(),
+        errors::InvalidArgument(
+            "`begin` and `size` should be vectors with one element per "
+            "element of `tile_shape`: begin.shape=",
+            begin.shape(), ", size.shape=", size.shape()));
+    std::vector<int64> region_start(grid.shape().size(), 0);
+    std::vector<int64> region_size(grid.shape().begin(), grid.shape().end());
+    TensorShape output_shape;
+    for (int i = 0; i < grid.dims(); ++i) {
+      if (i < tiled_dims) {
+        region_start[i] = begin.vec<int32>()(i);
+        region_size[i] = size.vec<int32>()(i);
+        OP_REQUIRES(context,
+                    0 <= region_start[i] && 0 <= region_size[i] &&
+                        region_start[i] + region_size[i] <= grid.shape()[i],
+                    errors::InvalidArgument(
+                        "The region should be inside the data along axis ", i,
+                        ": begin=", region_start[i], ", size=", region_size[i],
+                        ", shape=", grid.shape()[i]));
+      }
+      output_shape.AddDim(region_size[i]);
+    }
+
+    OP_REQUIRES_OK(context, CheckCdfShapes(cdf, cdf_size, offset));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckArgumentValues(precision_, index, cdf,
+                                                  cdf_size, offset));
+    }
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
+    Tensor* output;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, output_shape, &output));
+
+    // The segment table is read once to find the tiles, then only the tiles
+    // that overlap the region are decoded.
+    const tstring& encoded_string = encoded.scalar<tstring>()();
+    std::vector<absl::string_view> segments(grid.num_tiles());
+    OP_REQUIRES_OK(context,
+                   SplitSegments(absl::string_view(encoded_string.data(),
+                                                   encoded_string.size()),
+                                 absl::MakeSpan(segments)));
+    if (output_shape.num_elements() == 0) return;
+
+    std::vector<int64> tiles;
+    std::vector<int64> box_start, box_size;
+    for (int64 tile = 0; tile < grid.num_tiles(); ++tile) {
+      grid.TileBox(tile, &box_start, &box_size);
+      bool overlaps = true;
+      for (int i = 0; i < tiled_dims; ++i) {
+        overlaps &= box_start[i] < region_start[i] + region_size[i] &&
+                    region_start[i] < box_start[i] + box_size[i];
+      }
+      if (overlaps) tiles.push_back(tile);
+    }
+
+    auto index_flat = index.flat<int32>();
+    const PaddedCdfs cdfs(cdf, cdf_size);
+    auto offset_vec = offset.vec<int32>();
+    DecodeTable table;
+    auto output_flat = output->flat<int32>();
+    std::vector<int64> output_strides(grid.dims());
+    int64 output_stride = 1;
+    for (int i = grid.dims() - 1; i >= 0; --i) {
+      output_strides[i] = output_stride;
+      output_stride *= region_size[i];
+    }
+
+    std::vector<tensorflow::Status> status(tiles.size());
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        tiles.size(),
+        kCostPerSymbol * output_shape.num_elements() / tiles.size(),
+        [&](int64 start, int64 limit) {
+          std::vector<int64> tile_start, tile_size;
+          std::vector<int32> tile_index;
+          std::vector<int32> tile_output;
+          for (int64 i = start; i < limit; ++i) {
+            grid.TileBox(tiles[i], &tile_start, &tile_size);
+            tile_index.clear();
+            grid.ForEachElement(
+                tile_start, tile_size,
+                [&](int64, int64 index_offset, absl::Span<const int64>) {
+                  tile_index.push_back(index_flat(index_offset));
+                });
+            tile_output.resize(tile_index.size());
+            status[i] = RangeDecodeImpl(
+                absl::MakeSpan(tile_output),
+                absl::Span<const int32>(tile_index), cdfs, offset_vec, table,
+                segments[tiles[i]], nullptr, &metrics);
+            if (!status[i].ok()) continue;
+
+            // Copies the elements inside the region to the output.
+            int64 j = 0;
+            grid.ForEachElement(
+                tile_start, tile_size,
+                [&](int64, int64, absl::Span<const int64> element) {
+                  const int32 value = tile_output[j++];
+                  int64 output_offset = 0;
+                  for (int k = 0; k < grid.dims(); ++k) {
+                    const int64 position = element[k] - region_start[k];
+                    if (position < 0 || region_size[k] <= position) return;
+                    output_offset += position * output_strides[k];
+                  }
+                  output_flat(output_offset) = value;
+                });
+          }
+        });
+    for (const tensorflow::Status& s : status) {
+      OP_REQUIRES_OK(context, s);
+    }
+  }
+
+ private:
+  std::vector<int32> tile_shape_;
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("TiledUnboundedIndexRangeDecode").Device(DEVICE_CPU),
+    TiledUnboundedIndexRangeDecodeOp);
+
+class BatchedUnboundedIndexRangeDecodeOp : public UnboundedIndexRangeDecodeOp {
+ public:
+  explicit BatchedUnboundedIndexRangeDecodeOp(OpKernelConstruction* context)
+      : UnboundedIndexRangeDecodeOp(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& encoded = context->input(0);
+    const Tensor& index = context->input(1);
+    const Tensor& cdf = context->input(2);
+    const Tensor& cdf_size = context->input(3);
+    const Tensor& offset = context->input(4);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    OP_REQUIRES_OK(context, CheckCdfShapes(cdf, cdf_size, offset));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckCdfSize(cdf.dim_size(1), cdf_size));
+      OP_REQUIRES_OK(context, CheckCdf(precision_, cdf, cdf_size));
+    }
+    DecodeTable table;
+    OP_REQUIRES_OK(context, GetDecodeTable(context, 5, cdf, &table));
+    validation.Stop();
+
+    DecodeBatch(context, encoded, index, PaddedCdfs(cdf, cdf_size), offset,
+                table, &metrics);
+  }
+
+ protected:
+  // Decodes each string in `encoded` into `output`. Checks the arguments other
+  // than the CDFs and `table`, which have been checked by the caller.
+  template <typename Cdfs>
+  void DecodeBatch(OpKernelContext* context, const Tensor& encoded,
+                   const Tensor& index, const Cdfs& cdfs, const Tensor& offset,
+                   const DecodeTable& table,
+                   RangeCodingMetrics* metrics) const {
+    RangeCodingMetrics::ScopedStage validation(
+        metrics, RangeCodingMetrics::kValidation);
+    OP_REQUIRES(context, encoded.dims() == 1,
+                errors::InvalidArgument("`encoded` should be a vector: ",
+                                        encoded.shape()));
+    OP_REQUIRES(context, index.dims() > 0,
+                errors::InvalidArgument("`index` should be at least 1-D: ",
+                                        index.shape()));
+    const int64 batch_size = encoded.dim_size(0);
+    TensorShape string_shape = index.shape();
+    string_shape.RemoveDim(0);
+
+    OP_REQUIRES_OK(context, CheckBatchedIndexShape(batch_size, string_shape,
+                                                   index.shape()));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckIndex(cdfs.num_cdfs(), index));
+    }
+
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(metrics,
+                                           RangeCodingMetrics::kCoding);
+    TensorShape output_shape = string_shape;
+    output_shape.InsertDim(0, batch_size);
+    Tensor* output;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, output_shape, &output));
+
+    const int64 string_size = string_shape.num_elements();
+    const bool broadcast_index = (index.dim_size(0) != batch_size);
+    auto encoded_vec = encoded.vec<tstring>();
+    auto index_flat = index.flat<int32>();
+    auto offset_vec = offset.vec<int32>();
+    auto output_flat = output->flat<int32>();
+
+    std::vector<tensorflow::Status> status(batch_size);
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        batch_size, kCostPerSymbol * string_size,
+        [&](int64 start, int64 limit) {
+          for (int64 i = start; i < limit; ++i) {
+            const int64 index_start = broadcast_index ? 0 : i * string_size;
+            status[i] = RangeDecodeImpl(
+                absl::MakeSpan(output_flat.data() + i * string_size,
+                               string_size),
+                absl::MakeConstSpan(index_flat.data() + index_start,
+                                    string_size),
+                cdfs, offset_vec, table, encoded_vec(i), nullptr, metrics);
+          }
+        });
+    for (const tensorflow::Status& s : status) {
+      OP_REQUIRES_OK(context, s);
+    }
+  }
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeDecode").Device(DEVICE_CPU),
+    BatchedUnboundedIndexRangeDecodeOp);
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeDecodeWithTable").Device(DEVICE_CPU),
+    BatchedUnboundedIndexRangeDecodeOp);
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeDecode").Device(DEVICE_CPU).Label("async"),
+    AsyncCodingKernel<BatchedUnboundedIndexRangeDecodeOp>);
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeDecodeWithTable")
+        .Device(DEVICE_CPU)
+        .Label("async"),
+    AsyncCodingKernel<BatchedUnboundedIndexRangeDecodeOp>);
+REGISTER_KERNEL_BUILDER(Name("BatchedUnboundedIndexRangeDecode")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("encoded")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("decoded"),
+                        BatchedUnboundedIndexRangeDecodeOp);
+REGISTER_KERNEL_BUILDER(Name("BatchedUnboundedIndexRangeDecodeWithTable")
+                            .Device(DEVICE_GPU)
+                            .HostMemory("encoded")
+                            .HostMemory("index")
+                            .HostMemory("cdf")
+                            .HostMemory("cdf_size")
+                            .HostMemory("offset")
+                            .HostMemory("decode_table")
+                            .HostMemory("decoded"),
+                        BatchedUnboundedIndexRangeDecodeOp);
+
+class CreateCdfTableOp : public OpKernel {
+ public:
+  explicit CreateCdfTableOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("precision", &precision_));
+    OP_REQUIRES(context, 0 < precision_ && precision_ <= 16,
+                errors::InvalidArgument("`precision` must be in [1, 16]: ",
+                                        precision_));
+  }
+
+  ~CreateCdfTableOp() override {
+    // If the table is not shared, delete it.
+    if (table_ != nullptr && cinfo_.resource_is_private_to_kernel()) {
+      cinfo_.resource_manager()
+          ->Delete<CdfTable>(cinfo_.container(), cinfo_.name())
+          .IgnoreError();
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    std::vector<Tensor> inputs;
+    for (int i = 0; i < context->num_inputs(); ++i) {
+      inputs.push_back(context->input(i));
+    }
+    OP_REQUIRES_OK(context, CheckShapes(inputs));
+
+    tensorflow::mutex_lock lock(mu_);
+    if (table_ == nullptr) {
+      OP_REQUIRES_OK(context, cinfo_.Init(context->resource_manager(), def()));
+    }
+    // The table is only recreated when the op is run with different tensors,
+    // e.g., after the variables holding the CDFs were assigned to.
+    if (table_ == nullptr || !table_->IsCreatedFrom(inputs)) {
+      tensorflow::core::RefCountPtr<CdfTable> table;
+      OP_REQUIRES_OK(context, MakeCdfTable(context, inputs, &table));
+
+      // Ops that have already looked up the previous table keep a reference
+      // to it, so it is safe to replace.
+      tensorflow::ResourceMgr* resource_manager = cinfo_.resource_manager();
+      resource_manager->Delete<CdfTable>(cinfo_.container(), cinfo_.name())
+          .IgnoreError();
+      // The resource manager takes ownership of one reference.
+      table->Ref();
+      OP_REQUIRES_OK(context, resource_manager->Create(
+                                  cinfo_.container(), cinfo_.name(),
+                                  table.get()));
+      table_ = std::move(table);
+    }
+
+    Tensor* handle;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape{}, &handle));
+    handle->scalar<tensorflow::ResourceHandle>()() =
+        tensorflow::MakeResourceHandle<CdfTable>(context, cinfo_.container(),
+                                                 cinfo_.name());
+  }
+
+ protected:
+  // Checks the shapes of the inputs, i.e., `cdf`, `cdf_size`, and `offset`.
+  virtual tensorflow::Status CheckShapes(
+      absl::Span<const Tensor> inputs) const {
+    return CheckCdfShapes(inputs[0], inputs[1], inputs[2]);
+  }
+
+  // Checks the CDFs, converts them to the packed format, and builds their
+  // decode tables.
+  virtual tensorflow::Status MakeCdfTable(
+      OpKernelContext* context, absl::Span<const Tensor> inputs,
+      tensorflow::core::RefCountPtr<CdfTable>* table) const {
+    const Tensor& cdf = inputs[0];
+    const Tensor& cdf_size = inputs[1];
+    TF_RETURN_IF_ERROR(CheckCdfSize(cdf.dim_size(1), cdf_size));
+    TF_RETURN_IF_ERROR(CheckCdf(precision_, cdf, cdf_size));
+
+    auto cdf_matrix = cdf.matrix<int32>();
+    auto cdf_size_vec = cdf_size.vec<int32>();
+    const int64 num_cdfs = cdf_matrix.dimension(0);
+
+    Tensor cdf_row_splits;
+    TF_RETURN_IF_ERROR(context->allocate_temp(
+        tensorflow::DT_INT32, TensorShape{num_cdfs + 1}, &cdf_row_splits));
+    auto row_splits = cdf_row_splits.vec<int32>();
+    row_splits(0) = 0;
+    for (int64 i = 0; i < num_cdfs; ++i) {
+      row_splits(i + 1) = row_splits(i) + cdf_size_vec(i) - 1;
+    }
+    Tensor cdf_values;
+    TF_RETURN_IF_ERROR(context->allocate_temp(
+        tensorflow::DT_UINT16, TensorShape{row_splits(num_cdfs)},
+        &cdf_values));
+    auto values = cdf_values.vec<uint16>();
+    for (int64 i = 0; i < num_cdfs; ++i) {
+      std::copy(&cdf_matrix(i, 0), &cdf_matrix(i, 0) + cdf_size_vec(i) - 1,
+                values.data() + row_splits(i));
+    }
+
+    const int table_bits = std::min(precision_, kMaxDecodeTableBits);
+    Tensor decode_table;
+    TF_RETURN_IF_ERROR(context->allocate_temp(
+        tensorflow::DT_INT16, TensorShape{num_cdfs, 1 << table_bits},
+        &decode_table));
+
+    auto table_matrix = decode_table.matrix<int16>();
+    const int64 cost_per_unit =
+        2 * (cdf_matrix.dimension(1) + table_matrix.dimension(1));
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        num_cdfs, cost_per_unit,
+        [this, cdf_matrix, &table_matrix](int64 start, int64 limit) {
+          const absl::Span<const int32>::size_type cdf_width =
+              cdf_matrix.dimension(1);
+          const absl::Span<int16>::size_type table_size =
+              table_matrix.dimension(1);
+          for (int64 i = start; i < limit; ++i) {
+            MakeDecodeTable({&cdf_matrix(i, 0), cdf_width}, precision_,
+                            {&table_matrix(i, 0), table_size});
+          }
+        });
+
+    table->reset(new CdfTable(
+        precision_, cdf_values, cdf_row_splits, inputs[2], decode_table,
+        table_bits, CdfEntropies(precision_, cdf, cdf_size),
+        std::vector<Tensor>(inputs.begin(), inputs.end())));
+    return tensorflow::Status::OK();
+  }
+
+  int precision_;
+
+ private:
+  tensorflow::mutex mu_;
+  tensorflow::ContainerInfo cinfo_ TF_GUARDED_BY(mu_);
+  tensorflow::core::RefCountPtr<CdfTable> table_ TF_GUARDED_BY(mu_);
+};
+
+REGISTER_KERNEL_BUILDER(Name("CreateCdfTable").Device(DEVICE_CPU),
+                        CreateCdfTableOp);
+
+// Checks the CDFs in the packed format of CdfTable. Each CDF should have at
+// least 2 elements besides the last one, as `cdf_size` >= 3 for the other ops.
+tensorflow::Status CheckPackedCdf(int precision, const Tensor& cdf_values,
+                                  const Tensor& cdf_row_splits) {
+  auto values = cdf_values.vec<uint16>();
+  auto row_splits = cdf_row_splits.vec<int32>();
+  const int64 num_cdfs = row_splits.size() - 1;
+  if (row_splits(0) != 0 || row_splits(num_cdfs) != values.size()) {
+    return errors::InvalidArgument(
+        "`cdf_row_splits` should start from 0 and end at the length of "
+        "`cdf_values`: cdf_row_splits[0]=",
+        row_splits(0), ", cdf_row_splits[^1]=", row_splits(num_cdfs),
+        ", cdf_values.size=", values.size());
+  }
+
+  for (int64 i = 0; i < num_cdfs; ++i) {
+    const int32 length = row_splits(i + 1) - row_splits(i);
+    // The decode table holds the symbols as int16.
+    if (length < 2 || std::numeric_limits<int16>::max() <= length) {
+      return errors::InvalidArgument(
+          "Each packed cdf should have a length in [2, ",
+          std::numeric_limits<int16>::max(), "): length=", length);
+    }
+  }
+
+  const int32 upper_bound = 1 << precision;
+  for (int64 i = 0; i < num_cdfs; ++i) {
+    const int32 start = row_splits(i);
+    const int32 length = row_splits(i + 1) - start;
+    if (values(start) != 0) {
+      return errors::InvalidArgument("Each cdf should start from 0: cdf[0]=",
+                                     values(start));
+    }
+    for (int32 j = start + 1; j < start + length; ++j) {
+      if (values(j) <= values(j - 1)) {
+        return errors::InvalidArgument("CDF is not monotonic");
+      }
+    }
+    if (upper_bound <= values(start + length - 1)) {
+      return errors::InvalidArgument(
+          "Each packed cdf should be less than ", upper_bound,
+          ": cdf[^1]=", values(start + length - 1));
+    }
+  }
+  return tensorflow::Status::OK();
+}
+
+class CreatePackedCdfTableOp : public CreateCdfTableOp {
+ public:
+  explicit CreatePackedCdfTableOp(OpKernelConstruction* context)
+      : CreateCdfTableOp(context) {}
+
+ protected:
+  // Checks the shapes of `cdf_values`, `cdf_row_splits`, and `offset`.
+  tensorflow::Status CheckShapes(
+      absl::Span<const Tensor> inputs) const override {
+    const Tensor& cdf_values = inputs[0];
+    const Tensor& cdf_row_splits = inputs[1];
+    const Tensor& offset = inputs[2];
+    if (!TensorShapeUtils::IsVector(cdf_values.shape())) {
+      return errors::InvalidArgument("`cdf_values` should be 1-D: ",
+                                     cdf_values.shape());
+    }
+    if (!TensorShapeUtils::IsVector(cdf_row_splits.shape()) ||
+        cdf_row_splits.dim_size(0) < 1) {
+      return errors::InvalidArgument(
+          "`cdf_row_splits` should be 1-D and non-empty: ",
+          cdf_row_splits.shape());
+    }
+    if (!TensorShapeUtils::IsVector(offset.shape()) ||
+        offset.dim_size(0) != cdf_row_splits.dim_size(0) - 1) {
+      return errors::InvalidArgument(
+          "`offset` should be 1-D and its length should be one less than that "
+          "of `cdf_row_splits`: offset.shape=",
+          offset.shape(), ", cdf_row_splits.shape=", cdf_row_splits.shape());
+    }
+    return tensorflow::Status::OK();
+  }
+
+  // Checks the CDFs and builds their decode tables. The table refers to the
+  // input tensors, which are already in the packed format.
+  tensorflow::Status MakeCdfTable(
+      OpKernelContext* context, absl::Span<const Tensor> inputs,
+      tensorflow::core::RefCountPtr<CdfTable>* table) const override {
+    const Tensor& cdf_values = inputs[0];
+    const Tensor& cdf_row_splits = inputs[1];
+    TF_RETURN_IF_ERROR(CheckPackedCdf(precision_, cdf_values, cdf_row_splits));
+
+    auto values = cdf_values.vec<uint16>();
+    auto row_splits = cdf_row_splits.vec<int32>();
+    const int64 num_cdfs = row_splits.size() - 1;
+
+    const int table_bits = std::min(precision_, kMaxDecodeTableBits);
+    Tensor decode_table;
+    TF_RETURN_IF_ERROR(context->allocate_temp(
+        tensorflow::DT_INT16, TensorShape{num_cdfs, 1 << table_bits},
+        &decode_table));
+    std::vector<float> entropy(num_cdfs);
+
+    auto table_matrix = decode_table.matrix<int16>();
+    const int64 cost_per_unit =
+        2 * (values.size() / std::max<int64>(num_cdfs, 1) +
+             table_matrix.dimension(1));
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        num_cdfs, cost_per_unit,
+        [this, values, row_splits, &table_matrix, &entropy](int64 start,
+                                                            int64 limit) {
+          const absl::Span<int16>::size_type table_size =
+              table_matrix.dimension(1);
+          // The full CDF, with the last element that is not stored.
+          std::vector<int32> cdf;
+          for (int64 i = start; i < limit; ++i) {
+            cdf.assign(values.data() + row_splits(i),
+                       values.data() + row_splits(i + 1));
+            cdf.push_back(1 << precision_);
+            MakeDecodeTable(cdf, precision_,
+                            {&table_matrix(i, 0), table_size});
+            entropy[i] = CdfEntropy(cdf, precision_);
+          }
+        });
+
+    table->reset(new CdfTable(
+        precision_, cdf_values, cdf_row_splits, inputs[2], decode_table,
+        table_bits, std::move(entropy),
+        std::vector<Tensor>(inputs.begin(), inputs.end())));
+    return tensorflow::Status::OK();
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("CreatePackedCdfTable").Device(DEVICE_CPU),
+                        CreatePackedCdfTableOp);
+
+// The file format of SaveCdfTable and LoadCdfTable op. The file starts with a
+// CdfTableFileHeader, followed by the sections of CdfTableFileLayout(). Each
+// section starts at a multiple of kCdfTableFileAlignment, so that the tensors
+// that refer to a memory-mapped file are aligned like those allocated by
+// TensorFlow. The values are in the byte order of the host writing the file.
+constexpr char kCdfTableFileMagic[8] = {'T', 'F', 'C', '-', 'C', 'D', 'F', 'T'};
+constexpr uint32 kCdfTableFileByteOrder = 0x01020304;
+constexpr uint32 kCdfTableFileVersion = 1;
+constexpr int64 kCdfTableFileAlignment = 64;
+
+struct CdfTableFileHeader {
+  char magic[8];
+  uint32 byte_order;
+  uint32 version;
+  int32 precision;
+  int32 table_bits;
+  int64 num_cdfs;
+  int64 num_values;
+  char reserved[24];
+};
+static_assert(sizeof(CdfTableFileHeader) == kCdfTableFileAlignment,
+              "The first section should start right after the header.");
+
+// The sections of the file, in the order of the arguments of the CdfTable
+// constructor.
+enum CdfTableFileSectionIndex {
+  kCdfValuesSection,
+  kCdfRowSplitsSection,
+  kOffsetSection,
+  kDecodeTableSection,
+  kEntropySection,
+};
+
+struct CdfTableFileSection {
+  tensorflow::DataType dtype;
+  TensorShape shape;
+  // The position of the section relative to the start of the file.
+  int64 position;
+
+  int64 size() const {
+    return shape.num_elements() * tensorflow::DataTypeSize(dtype);
+  }
+};
+
+// Returns the sections of a file with `header`, and sets `*file_size` to the
+// size of the file.
+//
+// REQUIRES: `num_cdfs` and `num_values` of `header` are non-negative and not
+// greater than the file size, and `table_bits` <= kMaxDecodeTableBits.
+std::vector<CdfTableFileSection> CdfTableFileLayout(
+    const CdfTableFileHeader& header, int64* file_size) {
+  const int64 num_cdfs = header.num_cdfs;
+  std::vector<CdfTableFileSection> sections = {
+      {tensorflow::DT_UINT16, TensorShape{header.num_values}, 0},
+      {tensorflow::DT_INT32, TensorShape{num_cdfs + 1}, 0},
+      {tensorflow::DT_INT32, TensorShape{num_cdfs}, 0},
+      {tensorflow::DT_INT16,
+       TensorShape{num_cdfs, int64{1} << header.table_bits}, 0},
+      {tensorflow::DT_FLOAT, TensorShape{num_cdfs}, 0},
+  };
+  int64 position = sizeof(CdfTableFileHeader);
+  for (CdfTableFileSection& section : sections) {
+    section.position = position;
+    position += (section.size() + kCdfTableFileAlignment - 1) /
+                kCdfTableFileAlignment * kCdfTableFileAlignment;
+  }
+  *file_size = position;
+  return sections;
+}
+
+// A tensor buffer that refers to a section of a memory-mapped file. The file
+// stays mapped as long as any tensor refers to it.
+class MemoryRegionBuffer : public tensorflow::TensorBuffer {
+ public:
+  MemoryRegionBuffer(std::shared_ptr<tensorflow::ReadOnlyMemoryRegion> region,
+                     int64 position, size_t size)
+      : TensorBuffer(const_cast<char*>(
+            static_cast<const char*>(region->data()) + position)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(
+      tensorflow::AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("ReadOnlyMemoryRegion");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<tensorflow::ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
+// Checks that the decode table entries are symbols of their CDFs, see
+// MakeDecodeTable(), so that the decoder does not read outside of the CDFs.
+tensorflow::Status CheckPackedDecodeTable(const Tensor& cdf_row_splits,
+                                          const Tensor& decode_table) {
+  auto row_splits = cdf_row_splits.vec<int32>();
+  auto table = decode_table.matrix<int16>();
+  for (int64 i = 0; i < table.dimension(0); ++i) {
+    const int32 length = row_splits(i + 1) - row_splits(i);
+    for (int64 j = 0; j < table.dimension(1); ++j) {
+      if (table(i, j) < 0 || length <= table(i, j)) {
+        return errors::InvalidArgument(
+            "Each decode table entry should be in [0, ", length,
+            "): entry=", table(i, j));
+      }
+    }
+  }
+  return tensorflow::Status::OK();
+}
+
+class LoadCdfTableOp : public CreateCdfTableOp {
+ public:
+  explicit LoadCdfTableOp(OpKernelConstruction* context)
+      : CreateCdfTableOp(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("debug_level", &debug_level_));
+    OP_REQUIRES(context, debug_level_ == 0 || debug_level_ == 1,
+                errors::InvalidArgument("`debug_level` must be 0 or 1: ",
+                                        debug_level_));
+  }
+
+ protected:
+  // Checks the shape of `filename`.
+  tensorflow::Status CheckShapes(
+      absl::Span<const Tensor> inputs) const override {
+    if (!TensorShapeUtils::IsScalar(inputs[0].shape())) {
+      return errors::InvalidArgument("`filename` should be a scalar: ",
+                                     inputs[0].shape());
+    }
+    return tensorflow::Status::OK();
+  }
+
+  // Maps the file, and makes a table whose tensors refer to the mapped file
+  // without copying it. With debug_level > 0, the CDFs and decode tables are
+  // checked, which reads the whole file once. Otherwise only the size of the
+  // file is checked against its header.
+  tensorflow::Status MakeCdfTable(
+      OpKernelContext* context, absl::Span<const Tensor> inputs,
+      tensorflow::core::RefCountPtr<CdfTable>* table) const override {
+    const string filename(inputs[0].scalar<tstring>()());
+    std::unique_ptr<tensorflow::ReadOnlyMemoryRegion> mapped;
+    TF_RETURN_IF_ERROR(
+        context->env()->NewReadOnlyMemoryRegionFromFile(filename, &mapped));
+    std::shared_ptr<tensorflow::ReadOnlyMemoryRegion> region(
+        std::move(mapped));
+    const int64 length = region->length();
+
+    CdfTableFileHeader header;
+    if (length < static_cast<int64>(sizeof(header))) {
+      return errors::InvalidArgument("CDF table file is too short: ",
+                                     filename);
+    }
+    std::memcpy(&header, region->data(), sizeof(header));
+    if (std::memcmp(header.magic, kCdfTableFileMagic, sizeof(header.magic)) !=
+        0) {
+      return errors::InvalidArgument("Not a CDF table file: ", filename);
+    }
+    if (header.byte_order != kCdfTableFileByteOrder) {
+      return errors::InvalidArgument(
+          "CDF table file was written on a host with a different byte order: ",
+          filename);
+    }
+    if (header.version != kCdfTableFileVersion) {
+      return errors::InvalidArgument("Unsupported CDF table file version ",
+                                     header.version, ": ", filename);
+    }
+    if (header.precision != precision_) {
+      return errors::InvalidArgument(
+          "`precision` should match the precision the table was saved with: ",
+          precision_, " vs. ", header.precision);
+    }
+    if (header.table_bits != std::min(precision_, kMaxDecodeTableBits) ||
+        header.num_cdfs < 0 || length < header.num_cdfs ||
+        header.num_values < 0 || length < header.num_values) {
+      return errors::InvalidArgument("CDF table file has an invalid header: ",
+                                     filename);
+    }
+    int64 file_size;
+    const std::vector<CdfTableFileSection> sections =
+        CdfTableFileLayout(header, &file_size);
+    if (length != file_size) {
+      return errors::InvalidArgument(
+          "CDF table file should have ", file_size,
+          " bytes according to its header: size=", length, ", ", filename);
+    }
+
+    std::vector<Tensor> tensors;
+    for (const CdfTableFileSection& section : sections) {
+      MemoryRegionBuffer* buffer =
+          new MemoryRegionBuffer(region, section.position, section.size());
+      tensors.emplace_back(section.dtype, section.shape, buffer);
+      buffer->Unref();
+    }
+    if (debug_level_ > 0) {
+      TF_RETURN_IF_ERROR(CheckPackedCdf(precision_,
+                                        tensors[kCdfValuesSection],
+                                        tensors[kCdfRowSplitsSection]));
+      TF_RETURN_IF_ERROR(CheckPackedDecodeTable(
+          tensors[kCdfRowSplitsSection], tensors[kDecodeTableSection]));
+    }
+
+    auto entropy = tensors[kEntropySection].vec<float>();
+    table->reset(new CdfTable(
+        precision_, tensors[kCdfValuesSection], tensors[kCdfRowSplitsSection],
+        tensors[kOffsetSection], tensors[kDecodeTableSection],
+        header.table_bits,
+        std::vector<float>(entropy.data(), entropy.data() + entropy.size()),
+        std::vector<Tensor>(inputs.begin(), inputs.end())));
+    return tensorflow::Status::OK();
+  }
+
+ private:
+  int debug_level_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("LoadCdfTable").Device(DEVICE_CPU),
+                        LoadCdfTableOp);
+
+// Looks up the CdfTable passed as input `input_index`, and checks that it was
+// created with `precision`.
+tensorflow::Status LookupCdfTable(
+    OpKernelContext* context, int input_index, int precision,
+    tensorflow::core::RefCountPtr<CdfTable>* table) {
+  TF_RETURN_IF_ERROR(tensorflow::LookupResource(
+      context, tensorflow::HandleFromInput(context, input_index), table));
+  if ((*table)->precision() != precision) {
+    return errors::InvalidArgument(
+        "`precision` should match the precision the table was created with: ",
+        precision, " vs. ", (*table)->precision());
+  }
+  return tensorflow::Status::OK();
+}
+
+class SaveCdfTableOp : public OpKernel {
+ public:
+  explicit SaveCdfTableOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("precision", &precision_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    tensorflow::core::RefCountPtr<CdfTable> table;
+    OP_REQUIRES_OK(context, LookupCdfTable(context, 0, precision_, &table));
+    const Tensor& filename = context->input(1);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(filename.shape()),
+                errors::InvalidArgument("`filename` should be a scalar: ",
+                                        filename.shape()));
+
+    const DecodeTable decode_table = table->decode_table();
+    CdfTableFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kCdfTableFileMagic, sizeof(header.magic));
+    header.byte_order = kCdfTableFileByteOrder;
+    header.version = kCdfTableFileVersion;
+    header.precision = table->precision();
+    header.table_bits = decode_table.bits;
+    header.num_cdfs = table->num_cdfs();
+    header.num_values = table->cdf_values().NumElements();
+
+    int64 file_size;
+    const std::vector<CdfTableFileSection> sections =
+        CdfTableFileLayout(header, &file_size);
+    const absl::Span<const float> entropy = table->entropy();
+    const absl::string_view data[] = {
+        table->cdf_values().tensor_data(),
+        table->cdf_row_splits().tensor_data(),
+        table->offset().tensor_data(),
+        {reinterpret_cast<const char*>(decode_table.data),
+         static_cast<size_t>(sections[kDecodeTableSection].size())},
+        {reinterpret_cast<const char*>(entropy.data()),
+         entropy.size() * sizeof(float)},
+    };
+
+    // The padding between the sections is filled with zeros.
+    string contents(file_size, '\0');
+    std::memcpy(&contents[0], &header, sizeof(header));
+    for (size_t i = 0; i < sections.size(); ++i) {
+      DCHECK_EQ(static_cast<int64>(data[i].size()), sections[i].size());
+      if (!data[i].empty()) {
+        std::memcpy(&contents[sections[i].position], data[i].data(),
+                    data[i].size());
+      }
+    }
+    OP_REQUIRES_OK(context,
+                   tensorflow::WriteStringToFile(
+                       context->env(), string(filename.scalar<tstring>()()),
+                       contents));
+  }
+
+ private:
+  int precision_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("SaveCdfTable").Device(DEVICE_CPU),
+                        SaveCdfTableOp);
+
+class BatchedUnboundedIndexRangeEncodeWithCdfTableOp
+    : public BatchedUnboundedIndexRangeEncodeOp {
+ public:
+  explicit BatchedUnboundedIndexRangeEncodeWithCdfTableOp(
+      OpKernelConstruction* context)
+      : BatchedUnboundedIndexRangeEncodeOp(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    RangeCodingMetrics metrics(type_string());
+    tensorflow::core::RefCountPtr<CdfTable> table;
+    OP_REQUIRES_OK(context, LookupCdfTable(context, 2, precision_, &table));
+    EncodeBatch(context, context->input(0), context->input(1),
+                PackedCdfs(*table), table->offset(), table->entropy(),
+                &metrics);
+  }
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeEncodeWithCdfTable").Device(DEVICE_CPU),
+    BatchedUnboundedIndexRangeEncodeWithCdfTableOp);
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeEncodeWithCdfTable")
+        .Device(DEVICE_CPU)
+        .Label("async"),
+    AsyncCodingKernel<BatchedUnboundedIndexRangeEncodeWithCdfTableOp>);
+
+// Checks the shape of `index` for BatchedQuantizeAndRangeEncodeWithCdfTable
+// op. In addition to the shapes allowed by CheckBatchedIndexShape(), `index`
+// may have the shape of the innermost axes of a string, in which case it is
+// tiled over the other axes of the string and over the batch.
+tensorflow::Status CheckTiledIndexShape(int64 batch_size,
+                                        const TensorShape& string_shape,
+                                        const TensorShape& index_shape) {
+  if (index_shape.dims() == string_shape.dims() + 1) {
+    return CheckBatchedIndexShape(batch_size, string_shape, index_shape);
+  }
+  const int leading_dims = string_shape.dims() - index_shape.dims();
+  bool valid = (leading_dims >= 0);
+  for (int i = 0; valid && i < index_shape.dims(); ++i) {
+    valid =
+        (index_shape.dim_size(i) == string_shape.dim_size(leading_dims + i));
+  }
+  if (!valid) {
+    return errors::InvalidArgument(
+        "`index` should have the shape of the innermost axes of ", string_shape,
+        ", or that shape preceded by an axis of size 1 or ", batch_size,
+        ": index.shape=", index_shape);
+  }
+  return tensorflow::Status::OK();
+}
+
+// Returns the index of the strings for an `index` checked by
+// CheckTiledIndexShape(), tiling it into `tiled_index` if necessary. If each
+// string has its own index, sets `*broadcast` to false, and the index of the
+// i-th string starts at i * string_size.
+absl::Span<const int32> TiledIndex(const Tensor& index, int string_dims,
+                                   int64 batch_size, int64 string_size,
+                                   std::vector<int32>* tiled_index,
+                                   bool* broadcast) {
+  auto index_flat = index.flat<int32>();
+  const bool batched_index = (index.dims() == string_dims + 1);
+  *broadcast = !batched_index || index.dim_size(0) != batch_size;
+  if (batched_index || index_flat.size() == string_size) {
+    return absl::MakeConstSpan(index_flat.data(), index_flat.size());
+  }
+  tiled_index->resize(string_size);
+  for (int64 i = 0; i < string_size; ++i) {
+    (*tiled_index)[i] = index_flat(i % index_flat.size());
+  }
+  return *tiled_index;
+}
+
+template <typename T>
+class BatchedQuantizeAndRangeEncodeWithCdfTableOp
+    : public BatchedUnboundedIndexRangeEncodeOp {
+ public:
+  explicit BatchedQuantizeAndRangeEncodeWithCdfTableOp(
+      OpKernelConstruction* context)
+      : BatchedUnboundedIndexRangeEncodeOp(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& data = context->input(0);
+    const Tensor& index = context->input(1);
+    const Tensor& quantization_offset = context->input(2);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    tensorflow::core::RefCountPtr<CdfTable> table;
+    OP_REQUIRES_OK(context, LookupCdfTable(context, 3, precision_, &table));
+    OP_REQUIRES(context, data.dims() > 0,
+                errors::InvalidArgument("`data` should be at least 1-D: ",
+                                        data.shape()));
+    const int64 batch_size = data.dim_size(0);
+    TensorShape string_shape = data.shape();
+    string_shape.RemoveDim(0);
+
+    OP_REQUIRES_OK(context, CheckTiledIndexShape(batch_size, string_shape,
+                                                 index.shape()));
+    OP_REQUIRES(
+        context,
+        quantization_offset.shape() == TensorShape{table->num_cdfs()},
+        errors::InvalidArgument(
+            "`quantization_offset` should be 1-D and its length should match "
+            "the number of CDFs in the table: quantization_offset.shape=",
+            quantization_offset.shape(), ", num_cdfs=", table->num_cdfs()));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckIndex(table->num_cdfs(), index));
+    }
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
+    Tensor* output;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape{batch_size}, &output));
+
+    const int64 string_size = string_shape.num_elements();
+    std::vector<int32> tiled_index;
+    bool broadcast_index;
+    const absl::Span<const int32> string_index =
+        TiledIndex(index, string_shape.dims(), batch_size, string_size,
+                   &tiled_index, &broadcast_index);
+
+    auto data_flat = data.flat<T>();
+    const T* quantization_offset_data = quantization_offset.flat<T>().data();
+    const PackedCdfs cdfs(*table);
+    auto offset_vec = table->offset().vec<int32>();
+    auto output_vec = output->vec<tstring>();
+
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        batch_size, kCostPerSymbol * string_size,
+        [&](int64 start, int64 limit) {
+          for (int64 i = start; i < limit; ++i) {
+            const int64 index_start = broadcast_index ? 0 : i * string_size;
+            RangeEncodeImpl(
+                QuantizedValues<T>(data_flat.data() + i * string_size,
+                                   string_size, quantization_offset_data),
+                string_index.subspan(index_start, string_size), cdfs,
+                offset_vec, table->entropy(), nullptr, &output_vec(i),
+                &metrics);
+          }
+        });
+  }
+};
+
+#define REGISTER_QUANTIZE_AND_ENCODE_KERNEL(T)          \
+  REGISTER_KERNEL_BUILDER(                              \
+      Name("BatchedQuantizeAndRangeEncodeWithCdfTable") \
+          .Device(DEVICE_CPU)                           \
+          .TypeConstraint<T>("T"),                      \
+      BatchedQuantizeAndRangeEncodeWithCdfTableOp<T>);  \
+  REGISTER_KERNEL_BUILDER(                              \
+      Name("BatchedQuantizeAndRangeEncodeWithCdfTable") \
+          .Device(DEVICE_CPU)                           \
+          .TypeConstraint<T>("T")                       \
+          .Label("async"),                              \
+      AsyncCodingKernel<BatchedQuantizeAndRangeEncodeWithCdfTableOp<T>>)
+REGISTER_QUANTIZE_AND_ENCODE_KERNEL(Eigen::half);
+REGISTER_QUANTIZE_AND_ENCODE_KERNEL(tensorflow::bfloat16);
+REGISTER_QUANTIZE_AND_ENCODE_KERNEL(float);
+REGISTER_QUANTIZE_AND_ENCODE_KERNEL(double);
+#undef REGISTER_QUANTIZE_AND_ENCODE_KERNEL
+
+template <typename T>
+class BatchedRangeDecodeAndDequantizeWithCdfTableOp
+    : public BatchedUnboundedIndexRangeDecodeOp {
+ public:
+  explicit BatchedRangeDecodeAndDequantizeWithCdfTableOp(
+      OpKernelConstruction* context)
+      : BatchedUnboundedIndexRangeDecodeOp(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& encoded = context->input(0);
+    const Tensor& shape = context->input(1);
+    const Tensor& index = context->input(2);
+    const Tensor& quantization_offset = context->input(3);
+
+    RangeCodingMetrics metrics(type_string());
+    RangeCodingMetrics::ScopedStage validation(
+        &metrics, RangeCodingMetrics::kValidation);
+    tensorflow::core::RefCountPtr<CdfTable> table;
+    OP_REQUIRES_OK(context, LookupCdfTable(context, 4, precision_, &table));
+    OP_REQUIRES(context, encoded.dims() == 1,
+                errors::InvalidArgument("`encoded` should be a vector: ",
+                                        encoded.shape()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(shape.shape()),
+                errors::InvalidArgument("`shape` should be a vector: ",
+                                        shape.shape()));
+    TensorShape string_shape;
+    OP_REQUIRES_OK(context, TensorShapeUtils::MakeShape(shape.vec<int32>(),
+                                                        &string_shape));
+    const int64 batch_size = encoded.dim_size(0);
+
+    OP_REQUIRES_OK(context, CheckTiledIndexShape(batch_size, string_shape,
+                                                 index.shape()));
+    OP_REQUIRES(
+        context,
+        quantization_offset.shape() == TensorShape{table->num_cdfs()},
+        errors::InvalidArgument(
+            "`quantization_offset` should be 1-D and its length should match "
+            "the number of CDFs in the table: quantization_offset.shape=",
+            quantization_offset.shape(), ", num_cdfs=", table->num_cdfs()));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckIndex(table->num_cdfs(), index));
+    }
+    validation.Stop();
+
+    RangeCodingMetrics::ScopedStage coding(&metrics,
+                                           RangeCodingMetrics::kCoding);
+    TensorShape output_shape = string_shape;
+    output_shape.InsertDim(0, batch_size);
+    Tensor* output;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, output_shape, &output));
+
+    const int64 string_size = string_shape.num_elements();
+    std::vector<int32> tiled_index;
+    bool broadcast_index;
+    const absl::Span<const int32> string_index =
+        TiledIndex(index, string_shape.dims(), batch_size, string_size,
+                   &tiled_index, &broadcast_index);
+
+    auto encoded_vec = encoded.vec<tstring>();
+    auto output_flat = output->flat<T>();
+    const T* quantization_offset_data = quantization_offset.flat<T>().data();
+    const PackedCdfs cdfs(*table);
+    auto offset_vec = table->offset().vec<int32>();
+
+    std::vector<tensorflow::Status> status(batch_size);
+    thread::ThreadPool* thread_pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    thread_pool->ParallelFor(
+        batch_size, kCostPerSymbol * string_size,
+        [&](int64 start, int64 limit) {
+          for (int64 i = start; i < limit; ++i) {
+            const int64 index_start = broadcast_index ? 0 : i * string_size;
+            status[i] = RangeDecodeImpl(
+                DequantizedValues<T>(output_flat.data() + i * string_size,
+                                     string_size, quantization_offset_data),
+                string_index.subspan(index_start, string_size), cdfs,
+                offset_vec, table->decode_table(), encoded_vec(i), nullptr,
+                &metrics);
+          }
+        });
+    for (const tensorflow::Status& s : status) {
+      OP_REQUIRES_OK(context, s);
+    }
+  }
+};
+
+#define REGISTER_DECODE_AND_DEQUANTIZE_KERNEL(T)          \
+  REGISTER_KERNEL_BUILDER(                                \
+      Name("BatchedRangeDecodeAndDequantizeWithCdfTable") \
+          .Device(DEVICE_CPU)                             \
+          .TypeConstraint<T>("T"),                        \
+      BatchedRangeDecodeAndDequantizeWithCdfTableOp<T>);  \
+  REGISTER_KERNEL_BUILDER(                                \
+      Name("BatchedRangeDecodeAndDequantizeWithCdfTable") \
+          .Device(DEVICE_CPU)                             \
+          .TypeConstraint<T>("T")                         \
+          .Label("async"),                                \
+      AsyncCodingKernel<BatchedRangeDecodeAndDequantizeWithCdfTableOp<T>>)
+REGISTER_DECODE_AND_DEQUANTIZE_KERNEL(Eigen::half);
+REGISTER_DECODE_AND_DEQUANTIZE_KERNEL(tensorflow::bfloat16);
+REGISTER_DECODE_AND_DEQUANTIZE_KERNEL(float);
+REGISTER_DECODE_AND_DEQUANTIZE_KERNEL(double);
+#undef REGISTER_DECODE_AND_DEQUANTIZE_KERNEL
+
+class BatchedUnboundedIndexRangeDecodeWithCdfTableOp
+    : public BatchedUnboundedIndexRangeDecodeOp {
+ public:
+  explicit BatchedUnboundedIndexRangeDecodeWithCdfTableOp(
+      OpKernelConstruction* context)
+      : BatchedUnboundedIndexRangeDecodeOp(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    RangeCodingMetrics metrics(type_string());
+    tensorflow::core::RefCountPtr<CdfTable> table;
+    OP_REQUIRES_OK(context, LookupCdfTable(context, 2, precision_, &table));
+    DecodeBatch(context, context->input(0), context->input(1),
+                PackedCdfs(*table), table->offset(), table->decode_table(),
+                &metrics);
+  }
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeDecodeWithCdfTable").Device(DEVICE_CPU),
+    BatchedUnboundedIndexRangeDecodeWithCdfTableOp);
+REGISTER_KERNEL_BUILDER(
+    Name("BatchedUnboundedIndexRangeDecodeWithCdfTable")
+        .Device(DEVICE_CPU)
+        .Label("async"),
+    AsyncCodingKernel<BatchedUnboundedIndexRangeDecodeWithCdfTableOp>);
+
+// State of a bitstream that is encoded piece by piece, created by
+// CreateRangeEncodeStream op and advanced by RangeEncodeStreamNext op. Only
+// the range encoder state is carried between the pieces; the bytes that are
+// determined are returned right away.
+class RangeEncodeStream : public tensorflow::ResourceBase {
+ public:
+  RangeEncodeStream(tensorflow::core::RefCountPtr<CdfTable> table,
+                    int overflow_width)
+      : table_(std::move(table)), overflow_width_(overflow_width) {}
+
+  // Encodes `data` with `index`, and writes the bytes that are determined so
+  // far to `fragment`. If `final` is true, the bitstream is finalized, and no
+  // more values can be encoded.
+  //
+  // REQUIRES: data.size() == index.size().
+  // REQUIRES: The values of `index` are valid for the table.
+  tensorflow::Status Next(absl::Span<const int32> data,
+                          absl::Span<const int32> index, bool final,
+                          tstring* fragment) {
+    tensorflow::mutex_lock lock(mu_);
+    if (finalized_) {
+      return errors::FailedPrecondition(
+          "The stream has already been finalized.");
+    }
+
+    const PackedCdfs cdfs(*table_);
+    auto offset = table_->offset().vec<int32>();
+    const absl::Span<const float> entropy = table_->entropy();
+    const int precision = table_->precision();
+
+    double bits = 0;
+    for (const int32 cdf_index : index) {
+      // Indexes are only checked with debug_level > 0.
+      if (TF_PREDICT_TRUE(0 <= cdf_index && cdf_index < entropy.size())) {
+        bits += entropy[cdf_index];
+      }
+    }
+    PresizedSink sink(fragment, EncodedSizeHint(bits));
+    SinkRangeEncoder<PresizedSink> encoder(&encoder_, &sink);
+    for (int64 i = 0; i < data.size(); ++i) {
+      const int32 cdf_index = index[i];
+      EncodeValue(&encoder, data[i] - offset(cdf_index), cdfs.row(cdf_index),
+                  cdfs.size(cdf_index) - 2, overflow_width_, precision);
+    }
+    if (final) {
+      encoder_.Finalize(&sink);
+      finalized_ = true;
+    }
+    sink.Finish();
+    num_encoded_ += data.size();
+    return tensorflow::Status::OK();
+  }
+
+  const CdfTable& table() const { return *table_; }
+
+  std::string DebugString() const override {
+    tensorflow::mutex_lock lock(mu_);
+    return absl::StrCat("RangeEncodeStream(num_encoded=", num_encoded_,
+                        ", finalized=", finalized_, ")");
+  }
+
+ private:
+  const tensorflow::core::RefCountPtr<CdfTable> table_;
+  const int overflow_width_;
+
+  mutable tensorflow::mutex mu_;
+  RangeEncoder encoder_ TF_GUARDED_BY(mu_);
+  int64 num_encoded_ TF_GUARDED_BY(mu_) = 0;
+  bool finalized_ TF_GUARDED_BY(mu_) = false;
+};
+
+class CreateRangeEncodeStreamOp : public OpKernel {
+ public:
+  explicit CreateRangeEncodeStreamOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("precision", &precision_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("overflow_width", &overflow_width_));
+    OP_REQUIRES(context, 0 < overflow_width_ && overflow_width_ <= 16,
+                errors::InvalidArgument("`overflow_width` must be in [1, 16]: ",
+                                        overflow_width_));
+  }
+
+  ~CreateRangeEncodeStreamOp() override {
+    // If the stream is not shared, delete it.
+    if (initialized_ && cinfo_.resource_is_private_to_kernel()) {
+      cinfo_.resource_manager()
+          ->Delete<RangeEncodeStream>(cinfo_.container(), cinfo_.name())
+          .IgnoreError();
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    tensorflow::core::RefCountPtr<CdfTable> table;
+    OP_REQUIRES_OK(context, LookupCdfTable(context, 0, precision_, &table));
+
+    tensorflow::mutex_lock lock(mu_);
+    if (!initialized_) {
+      OP_REQUIRES_OK(context, cinfo_.Init(context->resource_manager(), def()));
+      initialized_ = true;
+    }
+
+    // Each run starts a new stream, as in CreateRangeDecodeStreamOp.
+    tensorflow::ResourceMgr* resource_manager = cinfo_.resource_manager();
+    resource_manager
+        ->Delete<RangeEncodeStream>(cinfo_.container(), cinfo_.name())
+        .IgnoreError();
+    // The resource manager takes ownership of the stream.
+    OP_REQUIRES_OK(context, resource_manager->Create(
+                                cinfo_.container(), cinfo_.name(),
+                                new RangeEncodeStream(std::move(table),
+                                                      overflow_width_)));
+
+    Tensor* handle;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape{}, &handle));
+    handle->scalar<tensorflow::ResourceHandle>()() =
+        tensorflow::MakeResourceHandle<RangeEncodeStream>(
+            context, cinfo_.container(), cinfo_.name());
+  }
+
+ private:
+  int precision_;
+  int overflow_width_;
+
+  tensorflow::mutex mu_;
+  tensorflow::ContainerInfo cinfo_ TF_GUARDED_BY(mu_);
+  bool initialized_ TF_GUARDED_BY(mu_) = false;
+};
+
+REGISTER_KERNEL_BUILDER(Name("CreateRangeEncodeStream").Device(DEVICE_CPU),
+                        CreateRangeEncodeStreamOp);
+
+class RangeEncodeStreamNextOp : public OpKernel {
+ public:
+  explicit RangeEncodeStreamNextOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("debug_level", &debug_level_));
+    OP_REQUIRES(context, debug_level_ == 0 || debug_level_ == 1,
+                errors::InvalidArgument("`debug_level` must be 0 or 1: ",
+                                        debug_level_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    tensorflow::core::RefCountPtr<RangeEncodeStream> stream;
+    OP_REQUIRES_OK(context,
+                   tensorflow::LookupResource(
+                       context, tensorflow::HandleFromInput(context, 0),
+                       &stream));
+
+    const Tensor& data = context->input(1);
+    const Tensor& index = context->input(2);
+    OP_REQUIRES(
+        context, data.shape() == index.shape(),
+        errors::InvalidArgument(
+            "`data` and `index` should have the same shape: data.shape=",
+            data.shape(), ", index.shape=", index.shape()));
+    const Tensor& final = context->input(3);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(final.shape()),
+                errors::InvalidArgument("Invalid `final` shape: ",
+                                        final.shape()));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckIndex(stream->table().num_cdfs(), index));
+    }
+
+    Tensor* fragment;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape{}, &fragment));
+    auto data_flat = data.flat<int32>();
+    auto index_flat = index.flat<int32>();
+    OP_REQUIRES_OK(
+        context,
+        stream->Next(absl::MakeConstSpan(data_flat.data(), data_flat.size()),
+                     absl::MakeConstSpan(index_flat.data(), index_flat.size()),
+                     final.scalar<bool>()(), &fragment->scalar<tstring>()()));
+  }
+
+ private:
+  int debug_level_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("RangeEncodeStreamNext").Device(DEVICE_CPU),
+                        RangeEncodeStreamNextOp);
+
+// The maximum number of bytes RangeDecoder reads to decode one value of a
+// valid bitstream, including the overflow.
+int64 MaxBytesPerValue(int overflow_width) {
+  const int64 max_widths = (32 + overflow_width - 1) / overflow_width;
+  const int64 max_overflow = (1 << overflow_width) - 1;
+  // One symbol, the number of overflow digits, and the digits, each of which
+  // reads at most 2 bytes.
+  return 2 * (1 + (max_widths / max_overflow + 1) + max_widths);
+}
+
+// State of a bitstream that is decoded while it arrives, created by
+// CreateRangeDecodeStream op and advanced by RangeDecodeStreamNext op. Holds
+// the bytes that have been received but not read yet, and the range decoder
+// reading them.
+class RangeDecodeStream : public tensorflow::ResourceBase {
+ public:
+  RangeDecodeStream(tensorflow::core::RefCountPtr<CdfTable> table,
+                    int overflow_width)
+      : table_(std::move(table)), overflow_width_(overflow_width) {}
+
+  // Appends `fragment` to the bitstream, and decodes the values for `index`
+  // that are fully contained in the bytes received so far. If `final` is true,
+  // `fragment` is taken to be the end of the bitstream, and all values are
+  // decoded. Sets `*num_decoded` to the number of values written to `output`.
+  // Once a decoding error is detected, this and all later calls fail.
+  //
+  // REQUIRES: The values of `index` are valid for the table.
+  tensorflow::Status Next(absl::string_view fragment,
+                          absl::Span<const int32> index, bool final,
+                          absl::Span<int32> output, int64* num_decoded) {
+    tensorflow::mutex_lock lock(mu_);
+    *num_decoded = 0;
+    if (corrupted_) {
+      return errors::InvalidArgument("The bitstream is corrupt");
+    }
+    Append(fragment);
+
+    if (decoder_ == nullptr) {
+      // The decoder reads the first 4 bytes when it is created.
+      if (!final && pending_.size() < 4) return tensorflow::Status::OK();
+      decoder_.reset(
+          new RangeDecoder(pending_.data(), pending_.data() + pending_.size()));
+    }
+
+    const PackedCdfs cdfs(*table_);
+    auto offset = table_->offset().vec<int32>();
+    const DecodeTable table = table_->decode_table();
+    const int precision = table_->precision();
+    const int64 max_bytes = MaxBytesPerValue(overflow_width_);
+    const char* const end = pending_.data() + pending_.size();
+
+    int64 i = 0;
+    for (; i < index.size(); ++i) {
+      // Stops before a value that may need bytes that have not arrived yet.
+      if (!final && end - decoder_->current() < max_bytes) break;
+
+      const int32 cdf_index = index[i];
+      const int32 max_value = cdfs.size(cdf_index) - 2;
+      int32 value = DecodeSymbol(decoder_.get(), cdfs.slice(cdf_index), table,
+                                 cdf_index, precision);
+      if (TF_PREDICT_FALSE(value == max_value)) {
+        value = DecodeOverflow(decoder_.get(), overflow_width_, max_value,
+                               &corrupted_);
+      }
+      output[i] = value + offset(cdf_index);
+    }
+    if (TF_PREDICT_FALSE(corrupted_ || decoder_->corrupted())) {
+      corrupted_ = true;
+      return errors::InvalidArgument("The bitstream is corrupt");
+    }
+    num_decoded_ += i;
+    *num_decoded = i;
+    return tensorflow::Status::OK();
+  }
+
+  const CdfTable& table() const { return *table_; }
+
+  std::string DebugString() const override {
+    tensorflow::mutex_lock lock(mu_);
+    return absl::StrCat("RangeDecodeStream(num_decoded=", num_decoded_,
+                        ", pending_bytes=", pending_.size(), ")");
+  }
+
+  tensorflow::int64 MemoryUsed() const override {
+    tensorflow::mutex_lock lock(mu_);
+    return pending_.capacity();
+  }
+
+ private:
+  // Drops the bytes that have been read, and appends `fragment` to the rest.
+  void Append(absl::string_view fragment) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (decoder_ != nullptr) {
+      pending_.erase(0, decoder_->current() - pending_.data());
+    }
+    pending_.append(fragment.data(), fragment.size());
+    if (decoder_ != nullptr) {
+      decoder_->Resume(pending_.data(), pending_.data() + pending_.size());
+    }
+  }
+
+  const tensorflow::core::RefCountPtr<CdfTable> table_;
+  const int overflow_width_;
+
+  mutable tensorflow::mutex mu_;
+  std::string pending_ TF_GUARDED_BY(mu_);
+  // Created once the first bytes have arrived.
+  std::unique_ptr<RangeDecoder> decoder_ TF_GUARDED_BY(mu_);
+  int64 num_decoded_ TF_GUARDED_BY(mu_) = 0;
+  bool corrupted_ TF_GUARDED_BY(mu_) = false;
+};
+
+class CreateRangeDecodeStreamOp : public OpKernel {
+ public:
+  explicit CreateRangeDecodeStreamOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("precision", &precision_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("overflow_width", &overflow_width_));
+    OP_REQUIRES(context, 0 < overflow_width_ && overflow_width_ <= 16,
+                errors::InvalidArgument("`overflow_width` must be in [1, 16]: ",
+                                        overflow_width_));
+  }
+
+  ~CreateRangeDecodeStreamOp() override {
+    // If the stream is not shared, delete it.
+    if (initialized_ && cinfo_.resource_is_private_to_kernel()) {
+      cinfo_.resource_manager()
+          ->Delete<RangeDecodeStream>(cinfo_.container(), cinfo_.name())
+          .IgnoreError();
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    tensorflow::core::RefCountPtr<CdfTable> table;
+    OP_REQUIRES_OK(context, LookupCdfTable(context, 0, precision_, &table));
+
+    tensorflow::mutex_lock lock(mu_);
+    if (!initialized_) {
+      OP_REQUIRES_OK(context, cinfo_.Init(context->resource_manager(), def()));
+      initialized_ = true;
+    }
+
+    // Each run starts a new stream. Ops that have already looked up the
+    // previous stream keep a reference to it, so it is safe to replace.
+    tensorflow::ResourceMgr* resource_manager = cinfo_.resource_manager();
+    resource_manager
+        ->Delete<RangeDecodeStream>(cinfo_.container(), cinfo_.name())
+        .IgnoreError();
+    // The resource manager takes ownership of the stream.
+    OP_REQUIRES_OK(context, resource_manager->Create(
+                                cinfo_.container(), cinfo_.name(),
+                                new RangeDecodeStream(std::move(table),
+                                                      overflow_width_)));
+
+    Tensor* handle;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, TensorShape{}, &handle));
+    handle->scalar<tensorflow::ResourceHandle>()() =
+        tensorflow::MakeResourceHandle<RangeDecodeStream>(
+            context, cinfo_.container(), cinfo_.name());
+  }
+
+ private:
+  int precision_;
+  int overflow_width_;
+
+  tensorflow::mutex mu_;
+  tensorflow::ContainerInfo cinfo_ TF_GUARDED_BY(mu_);
+  bool initialized_ TF_GUARDED_BY(mu_) = false;
+};
+
+REGISTER_KERNEL_BUILDER(Name("CreateRangeDecodeStream").Device(DEVICE_CPU),
+                        CreateRangeDecodeStreamOp);
+
+class RangeDecodeStreamNextOp : public OpKernel {
+ public:
+  explicit RangeDecodeStreamNextOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("debug_level", &debug_level_));
+    OP_REQUIRES(context, debug_level_ == 0 || debug_level_ == 1,
+                errors::InvalidArgument("`debug_level` must be 0 or 1: ",
+                                        debug_level_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    tensorflow::core::RefCountPtr<RangeDecodeStream> stream;
+    OP_REQUIRES_OK(context,
+                   tensorflow::LookupResource(
+                       context, tensorflow::HandleFromInput(context, 0),
+                       &stream));
+
+    const Tensor& fragment = context->input(1);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(fragment.shape()),
+                errors::InvalidArgument("Invalid `fragment` shape: ",
+                                        fragment.shape()));
+    const Tensor& index = context->input(2);
+    const Tensor& final = context->input(3);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(final.shape()),
+                errors::InvalidArgument("Invalid `final` shape: ",
+                                        final.shape()));
+    if (debug_level_ > 0) {
+      OP_REQUIRES_OK(context, CheckIndex(stream->table().num_cdfs(), index));
+    }
+
+    // Allocated for all values for `index`, and sliced to the number of
+    // values decoded.
+    Tensor decoded;
+    OP_REQUIRES_OK(context, context->allocate_temp(
+                                tensorflow::DT_INT32,
+                                TensorShape{index.NumElements()}, &decoded));
+    auto index_flat = index.flat<int32>();
+    auto decoded_flat = decoded.flat<int32>();
+    const tstring& bytes = fragment.scalar<tstring>()();
+    int64 num_decoded;
+    OP_REQUIRES_OK(
+        context,
+        stream->Next(absl::string_view(bytes.data(), bytes.size()),
+                     absl::MakeConstSpan(index_flat.data(), index_flat.size()),
+                     final.scalar<bool>()(),
+                     absl::MakeSpan(decoded_flat.data(), decoded_flat.size()),
+                     &num_decoded));
+    context->set_output(0, decoded.Slice(0, num_decoded));
+  }
+
+ private:
+  int debug_level_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("RangeDecodeStreamNext").Device(DEVICE_CPU),
+                        RangeDecodeStreamNextOp);
 
 }  // namespace
 }  // namespace tensorflow_compression
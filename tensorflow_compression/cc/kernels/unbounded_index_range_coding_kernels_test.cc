@@ -16,6 +16,7 @@ limitations under the License.
 #include <algorithm>
 #include <cmath>
 #include <memory>
+#include <numeric>
 #include <random>
 #include <vector>
 
@@ -25,6 +26,8 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def.proto.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/framework/types.proto.h"
 #include "tensorflow/core/framework/versions.proto.h"
@@ -34,20 +37,26 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/random/distribution_sampler.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/stacktrace_handler.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow_compression/cc/kernels/cdf_table.h"
 #include "tensorflow_compression/cc/kernels/range_coder.h"
 
 namespace tensorflow_compression {
 namespace {
 namespace random = tensorflow::random;
 namespace test = tensorflow::test;
+using tensorflow::DT_BOOL;
 using tensorflow::DT_INT32;
+using tensorflow::DT_RESOURCE;
 using tensorflow::DT_STRING;
+using tensorflow::DT_UINT16;
 using tensorflow::Graph;
 using tensorflow::int16;
 using tensorflow::int32;
@@ -63,7 +72,9 @@ using tensorflow::Status;
 using tensorflow::string;
 using tensorflow::Tensor;
 using tensorflow::TensorShape;
+using tensorflow::tstring;
 using tensorflow::TTypes;
+using tensorflow::uint16;
 using tensorflow::uint32;
 using tensorflow::uint64;
 using tensorflow::uint8;
@@ -152,29 +163,8 @@ class UnboundedIndexRangeCoderOpsTest : public OpsTestBase {
 
   Status RunEncodeOpImpl(int precision, int overflow_width, int debug_level,
                          absl::Span<const Tensor> input, Tensor* output) {
-    NodeDefBuilder builder("encode", "UnboundedIndexRangeEncode");
-    for (const Tensor& tensor : input) {
-      builder.Input(tensorflow::FakeInput(tensor.dtype()));
-    }
-    TF_RETURN_IF_ERROR(builder.Attr("precision", precision)
-                           .Attr("overflow_width", overflow_width)
-                           .Attr("debug_level", debug_level)
-                           .Finalize(node_def()));
-    TF_RETURN_IF_ERROR(InitOp());
-
-    inputs_.clear();
-    std::vector<Tensor> copies(input.size());
-    for (int i = 0; i < input.size(); ++i) {
-      copies[i] = input[i];
-      inputs_.emplace_back(&copies[i]);
-    }
-
-    TF_RETURN_IF_ERROR(RunOpKernel());
-
-    *output = *GetOutput(0);
-    inputs_.clear();
-
-    return Status::OK();
+    return RunOpImpl("UnboundedIndexRangeEncode", precision, overflow_width,
+                     debug_level, input, output);
   }
 
   Status RunDecodeOpDebug(int precision, int overflow_width,
@@ -190,13 +180,30 @@ class UnboundedIndexRangeCoderOpsTest : public OpsTestBase {
 
   Status RunDecodeOpImpl(int precision, int overflow_width, int debug_level,
                          absl::Span<const Tensor> input, Tensor* output) {
-    NodeDefBuilder builder("decode", "UnboundedIndexRangeDecode");
+    return RunOpImpl("UnboundedIndexRangeDecode", precision, overflow_width,
+                     debug_level, input, output);
+  }
+
+  Status RunOpImpl(const string& op_name, int precision, int overflow_width,
+                   int debug_level, absl::Span<const Tensor> input,
+                   Tensor* output, int num_chunks = 1, int interleave = 1,
+                   bool group_by_index = false, int coder_version = 1,
+                   bool checksum = false, const string& label = "") {
+    NodeDefBuilder builder("op", op_name);
     for (const Tensor& tensor : input) {
       builder.Input(tensorflow::FakeInput(tensor.dtype()));
     }
+    if (!label.empty()) {
+      builder.Attr("_kernel", label);
+    }
     TF_RETURN_IF_ERROR(builder.Attr("precision", precision)
                            .Attr("overflow_width", overflow_width)
                            .Attr("debug_level", debug_level)
+                           .Attr("num_chunks", num_chunks)
+                           .Attr("interleave", interleave)
+                           .Attr("group_by_index", group_by_index)
+                           .Attr("coder_version", coder_version)
+                           .Attr("checksum", checksum)
                            .Finalize(node_def()));
     TF_RETURN_IF_ERROR(InitOp());
 
@@ -440,6 +447,1480 @@ TEST_F(UnboundedIndexRangeCoderOpsTest, Broadcast2Axes) {
                       offset);
 }
 
+TEST_F(UnboundedIndexRangeCoderOpsTest, BroadcastIndex) {
+  constexpr int kPrecision = 12;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfWidth = 32;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {2, 8, 6, 5});
+  Tensor shape(DT_INT32, {4});
+  shape.vec<int32>().setValues({2, 8, 6, 5});
+  Tensor cdf(DT_INT32, {6 * 5, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {6 * 5});
+  Tensor offset(DT_INT32, {6 * 5});
+
+  // The index only depends on the two innermost axes, and is passed either
+  // without the other axes, or with them as axes of size 1.
+  const Tensor full_index = CreateBroadcastingIndex<4>(data.shape(), {0, 1});
+  BuildDataAndCdf(&gen, &data, full_index, &cdf, &cdf_size, &offset,
+                  kPrecision);
+  for (const TensorShape& index_shape :
+       {TensorShape{6, 5}, TensorShape{1, 1, 6, 5}}) {
+    Tensor index(DT_INT32, index_shape);
+    auto index_flat = index.flat<int32>();
+    std::copy_n(full_index.flat<int32>().data(), index_flat.size(),
+                index_flat.data());
+
+    for (const bool group_by_index : {false, true}) {
+      Tensor expected;
+      TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                             kOverflowWidth, 1,
+                             {data, full_index, cdf, cdf_size, offset},
+                             &expected, 2, 2, group_by_index));
+      Tensor encoded;
+      TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                             kOverflowWidth, 1,
+                             {data, index, cdf, cdf_size, offset}, &encoded, 2,
+                             2, group_by_index));
+      EXPECT_EQ(encoded.scalar<tstring>()(), expected.scalar<tstring>()());
+
+      Tensor decoded;
+      TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeDecodeWithShape", kPrecision,
+                             kOverflowWidth, 1,
+                             {encoded, shape, index, cdf, cdf_size, offset},
+                             &decoded, 2, 2, group_by_index));
+      EXPECT_EQ(decoded.shape(), data.shape());
+      EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+    }
+  }
+
+  // The index cannot be broadcast to the data.
+  Tensor index(DT_INT32, {3, 5});
+  index.flat<int32>().setZero();
+  Tensor unused;
+  EXPECT_FALSE(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                         kOverflowWidth, 1,
+                         {data, index, cdf, cdf_size, offset}, &unused)
+                   .ok());
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, Tiled) {
+  constexpr int kPrecision = 12;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfWidth = 32;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {19, 13, 3});
+  Tensor shape(DT_INT32, {3});
+  shape.vec<int32>().setValues({19, 13, 3});
+  Tensor cdf(DT_INT32, {3, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {3});
+  Tensor offset(DT_INT32, {3});
+
+  // The index depends on the channel only.
+  const Tensor full_index = CreateBroadcastingIndex<3>(data.shape(), {0, 1});
+  BuildDataAndCdf(&gen, &data, full_index, &cdf, &cdf_size, &offset,
+                  kPrecision);
+  Tensor index(DT_INT32, {3});
+  index.vec<int32>().setValues({0, 1, 2});
+
+  auto run_op = [&](const string& op_name, absl::Span<const Tensor> input,
+                    Tensor* output) {
+    NodeDefBuilder builder("op", op_name);
+    for (const Tensor& tensor : input) {
+      builder.Input(tensorflow::FakeInput(tensor.dtype()));
+    }
+    TF_RETURN_IF_ERROR(builder.Attr("precision", kPrecision)
+                           .Attr("overflow_width", kOverflowWidth)
+                           .Attr("tile_shape", {8, 4})
+                           .Attr("interleave", 2)
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    inputs_.clear();
+    std::vector<Tensor> copies(input.begin(), input.end());
+    for (Tensor& copy : copies) {
+      inputs_.emplace_back(&copy);
+    }
+    TF_RETURN_IF_ERROR(RunOpKernel());
+    *output = *GetOutput(0);
+    inputs_.clear();
+    return Status::OK();
+  };
+
+  Tensor encoded;
+  TF_ASSERT_OK(run_op("TiledUnboundedIndexRangeEncode",
+                      {data, index, cdf, cdf_size, offset}, &encoded));
+
+  // Regions aligned to the tiles, straddling them, and covering everything.
+  const std::vector<std::array<int32, 4>> regions = {
+      {0, 0, 8, 4}, {5, 3, 9, 7}, {18, 12, 1, 1}, {0, 0, 19, 13}};
+  for (const auto& region : regions) {
+    Tensor begin(DT_INT32, {2});
+    begin.vec<int32>().setValues({region[0], region[1]});
+    Tensor size(DT_INT32, {2});
+    size.vec<int32>().setValues({region[2], region[3]});
+    Tensor decoded;
+    TF_ASSERT_OK(run_op(
+        "TiledUnboundedIndexRangeDecode",
+        {encoded, shape, begin, size, index, cdf, cdf_size, offset},
+        &decoded));
+    ASSERT_EQ(decoded.shape(), TensorShape({region[2], region[3], 3}));
+
+    auto expected = data.tensor<int32, 3>();
+    auto actual = decoded.tensor<int32, 3>();
+    for (int i = 0; i < region[2]; ++i) {
+      for (int j = 0; j < region[3]; ++j) {
+        for (int k = 0; k < 3; ++k) {
+          EXPECT_EQ(actual(i, j, k),
+                    expected(region[0] + i, region[1] + j, k));
+        }
+      }
+    }
+  }
+
+  // The region should be inside of the data.
+  Tensor begin(DT_INT32, {2});
+  begin.vec<int32>().setValues({12, 0});
+  Tensor size(DT_INT32, {2});
+  size.vec<int32>().setValues({8, 4});
+  Tensor unused;
+  EXPECT_FALSE(run_op(
+                   "TiledUnboundedIndexRangeDecode",
+                   {encoded, shape, begin, size, index, cdf, cdf_size, offset},
+                   &unused)
+                   .ok());
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, Batched) {
+  constexpr int kPrecision = 12;
+  constexpr int kOverflowWidth = 4;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 32;
+  constexpr int kBatchSize = 6;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  const TensorShape string_shape{16, 8};
+  const int64 string_size = string_shape.num_elements();
+
+  for (const bool broadcast_index : {false, true}) {
+    Tensor data(DT_INT32, {kBatchSize, 16, 8});
+    Tensor full_index(DT_INT32, data.shape());
+    Tensor index(DT_INT32, {broadcast_index ? 1 : kBatchSize, 16, 8});
+
+    auto index_flat = index.flat<int32>();
+    for (int64 i = 0; i < index_flat.size(); ++i) {
+      index_flat(i) = gen.Uniform(kCdfCount);
+    }
+    auto full_index_flat = full_index.flat<int32>();
+    for (int64 i = 0; i < full_index_flat.size(); ++i) {
+      full_index_flat(i) = index_flat(i % index_flat.size());
+    }
+
+    Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+    Tensor cdf_size(DT_INT32, {kCdfCount});
+    Tensor offset(DT_INT32, {kCdfCount});
+    BuildDataAndCdf(&gen, &data, full_index, &cdf, &cdf_size, &offset,
+                    kPrecision);
+
+    // Insert some out-of-range values manually.
+    auto data_flat = data.flat<int32>();
+    data_flat(0) = -3;
+    data_flat(data_flat.size() - 1) = kCdfWidth + 5;
+
+    Tensor encoded;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncode", kPrecision,
+                           kOverflowWidth, 0,
+                           {data, index, cdf, cdf_size, offset}, &encoded));
+    ASSERT_EQ(encoded.shape(), TensorShape{kBatchSize});
+
+    // Each string should be identical to the output of the unbatched op.
+    for (int64 i = 0; i < kBatchSize; ++i) {
+      Tensor string_data(DT_INT32, string_shape);
+      Tensor string_index(DT_INT32, string_shape);
+      std::copy_n(data_flat.data() + i * string_size, string_size,
+                  string_data.flat<int32>().data());
+      std::copy_n(full_index_flat.data() + i * string_size, string_size,
+                  string_index.flat<int32>().data());
+
+      Tensor expected;
+      TF_ASSERT_OK(RunEncodeOp(
+          kPrecision, kOverflowWidth,
+          {string_data, string_index, cdf, cdf_size, offset}, &expected));
+      EXPECT_EQ(encoded.vec<tstring>()(i), expected.scalar<tstring>()());
+    }
+
+    Tensor decoded;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeDecode", kPrecision,
+                           kOverflowWidth, 0,
+                           {encoded, index, cdf, cdf_size, offset}, &decoded));
+    EXPECT_EQ(decoded.dtype(), data.dtype());
+    EXPECT_EQ(decoded.shape(), data.shape());
+    EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, BatchedIndexShape) {
+  Tensor data(DT_INT32, {3, 2});
+  data.flat<int32>().setZero();
+
+  Tensor cdf(DT_INT32, {1, 4});
+  cdf.flat<int32>().setValues({0, 16, 18, 32});
+
+  Tensor cdf_size(DT_INT32, {1});
+  cdf_size.vec<int32>().setValues({4});
+
+  Tensor offset(DT_INT32, {1});
+  offset.vec<int32>().setValues({1});
+
+  for (const TensorShape& shape :
+       {TensorShape{2, 2}, TensorShape{3, 3}, TensorShape{2}}) {
+    Tensor index(DT_INT32, shape);
+    index.flat<int32>().setZero();
+
+    Tensor unused;
+    const Status status =
+        RunOpImpl("BatchedUnboundedIndexRangeEncode", 5, 2, 1,
+                  {data, index, cdf, cdf_size, offset}, &unused);
+    EXPECT_FALSE(status.ok());
+    EXPECT_NE(status.error_message().find("leading axis"), string::npos)
+        << status.error_message();
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, RangeCodingCost) {
+  constexpr int kPrecision = 14;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 12;
+  constexpr int kCdfWidth = 24;
+  constexpr int kBatchSize = 4;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {kBatchSize, 64, 64});
+  Tensor index(DT_INT32, data.shape());
+  auto index_flat = index.flat<int32>();
+  for (int64 i = 0; i < index_flat.size(); ++i) {
+    index_flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  // Insert some out-of-range values manually.
+  auto data_flat = data.flat<int32>();
+  data_flat(0) = -300;
+  data_flat(data_flat.size() - 1) = kCdfWidth + 5000;
+
+  Tensor encoded;
+  TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncode", kPrecision,
+                         kOverflowWidth, 0,
+                         {data, index, cdf, cdf_size, offset}, &encoded));
+
+  TF_ASSERT_OK(NodeDefBuilder("cost", "BatchedRangeCodingCost")
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Attr("precision", kPrecision)
+                   .Attr("overflow_width", kOverflowWidth)
+                   .Attr("debug_level", 1)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  for (Tensor* tensor : {&data, &index, &cdf, &cdf_size, &offset}) {
+    inputs_.emplace_back(tensor);
+  }
+  TF_ASSERT_OK(RunOpKernel());
+  const Tensor cost = *GetOutput(0);
+  ASSERT_EQ(cost.shape(), TensorShape{kBatchSize});
+
+  // The cost should be close to the length of each string.
+  for (int64 i = 0; i < kBatchSize; ++i) {
+    const double bits = 8.0 * encoded.vec<tstring>()(i).size();
+    EXPECT_NEAR(cost.vec<float>()(i), bits, 1e-3 * bits + 64) << "i=" << i;
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, ChunkAndInterleave) {
+  constexpr int kPrecision = 14;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  // The last shape has fewer elements than some of the chunk counts.
+  for (const TensorShape& shape :
+       {TensorShape{1, 32, 32, 16}, TensorShape{5}}) {
+    Tensor data(DT_INT32, shape);
+    Tensor index(DT_INT32, shape);
+
+    auto flat = index.flat<int32>();
+    for (int64 i = 0; i < flat.size(); ++i) {
+      flat(i) = gen.Uniform(kCdfCount);
+    }
+
+    Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+    Tensor cdf_size(DT_INT32, {kCdfCount});
+    Tensor offset(DT_INT32, {kCdfCount});
+    BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+    // Insert some out-of-range values manually.
+    auto data_flat = data.flat<int32>();
+    data_flat(0) = -3;
+    data_flat(data_flat.size() - 1) = kCdfWidth + 5;
+
+    for (const int num_chunks : {1, 2, 7, 64}) {
+      for (const int interleave : {1, 2, 4, 8}) {
+        Tensor encoded;
+        TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                               kOverflowWidth, 0,
+                               {data, index, cdf, cdf_size, offset}, &encoded,
+                               num_chunks, interleave));
+
+        Tensor decoded;
+        TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeDecode", kPrecision,
+                               kOverflowWidth, 0,
+                               {encoded, index, cdf, cdf_size, offset},
+                               &decoded, num_chunks, interleave));
+        EXPECT_EQ(decoded.shape(), data.shape());
+        EXPECT_EQ(decoded.tensor_data(), data.tensor_data())
+            << "num_chunks=" << num_chunks << ", interleave=" << interleave;
+      }
+    }
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, GroupByIndex) {
+  constexpr int kPrecision = 14;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {4, 300});
+  Tensor index(DT_INT32, {4, 300});
+  auto index_flat = index.flat<int32>();
+  for (int64 i = 0; i < index_flat.size(); ++i) {
+    index_flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  auto data_flat = data.flat<int32>();
+  data_flat(0) = -3;
+  data_flat(data_flat.size() - 1) = kCdfWidth + 5;
+
+  // The grouped string is the ungrouped encoding of the values sorted by index
+  // with a stable sort.
+  Tensor sorted_data(DT_INT32, {data_flat.size()});
+  Tensor sorted_index(DT_INT32, {data_flat.size()});
+  {
+    std::vector<int64> order(data_flat.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int64 a, int64 b) {
+      return index_flat(a) < index_flat(b);
+    });
+    for (int64 i = 0; i < order.size(); ++i) {
+      sorted_data.flat<int32>()(i) = data_flat(order[i]);
+      sorted_index.flat<int32>()(i) = index_flat(order[i]);
+    }
+  }
+
+  for (const int num_chunks : {1, 3}) {
+    for (const int interleave : {1, 4}) {
+      Tensor expected;
+      TF_ASSERT_OK(RunOpImpl(
+          "UnboundedIndexRangeEncode", kPrecision, kOverflowWidth, 0,
+          {sorted_data, sorted_index, cdf, cdf_size, offset}, &expected,
+          num_chunks, interleave));
+
+      Tensor encoded;
+      TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                             kOverflowWidth, 0,
+                             {data, index, cdf, cdf_size, offset}, &encoded,
+                             num_chunks, interleave, true));
+      EXPECT_EQ(encoded.scalar<tstring>()(), expected.scalar<tstring>()());
+
+      Tensor decoded;
+      TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeDecode", kPrecision,
+                             kOverflowWidth, 0,
+                             {encoded, index, cdf, cdf_size, offset}, &decoded,
+                             num_chunks, interleave, true));
+      EXPECT_EQ(decoded.shape(), data.shape());
+      EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+
+      TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncode", kPrecision,
+                             kOverflowWidth, 0,
+                             {data, index, cdf, cdf_size, offset}, &encoded,
+                             num_chunks, interleave, true));
+      TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeDecode", kPrecision,
+                             kOverflowWidth, 0,
+                             {encoded, index, cdf, cdf_size, offset}, &decoded,
+                             num_chunks, interleave, true));
+      EXPECT_EQ(decoded.tensor_data(), data.tensor_data())
+          << "num_chunks=" << num_chunks << ", interleave=" << interleave;
+    }
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, CoderVersion) {
+  constexpr int kPrecision = 16;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {4, 300});
+  Tensor index(DT_INT32, {4, 300});
+  auto index_flat = index.flat<int32>();
+  for (int64 i = 0; i < index_flat.size(); ++i) {
+    index_flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  auto data_flat = data.flat<int32>();
+  data_flat(0) = -3;
+  data_flat(data_flat.size() - 1) = kCdfWidth + 5;
+
+  for (const int num_chunks : {1, 3}) {
+    for (const int interleave : {1, 4}) {
+      for (const bool group_by_index : {false, true}) {
+        Tensor expected;
+        TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                               kOverflowWidth, 0,
+                               {data, index, cdf, cdf_size, offset}, &expected,
+                               num_chunks, interleave, group_by_index));
+
+        // The 64-bit coder writes a different bitstream of about the same
+        // size.
+        Tensor encoded;
+        TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                               kOverflowWidth, 0,
+                               {data, index, cdf, cdf_size, offset}, &encoded,
+                               num_chunks, interleave, group_by_index, 2));
+        EXPECT_NE(encoded.scalar<tstring>()(), expected.scalar<tstring>()());
+        EXPECT_LE(encoded.scalar<tstring>()().size(),
+                  expected.scalar<tstring>()().size() +
+                      4 * num_chunks * interleave);
+
+        Tensor decoded;
+        TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeDecode", kPrecision,
+                               kOverflowWidth, 0,
+                               {encoded, index, cdf, cdf_size, offset},
+                               &decoded, num_chunks, interleave,
+                               group_by_index, 2));
+        EXPECT_EQ(decoded.tensor_data(), data.tensor_data())
+            << "num_chunks=" << num_chunks << ", interleave=" << interleave
+            << ", group_by_index=" << group_by_index;
+
+        TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncode", kPrecision,
+                               kOverflowWidth, 0,
+                               {data, index, cdf, cdf_size, offset}, &encoded,
+                               num_chunks, interleave, group_by_index, 2));
+        TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeDecode", kPrecision,
+                               kOverflowWidth, 0,
+                               {encoded, index, cdf, cdf_size, offset},
+                               &decoded, num_chunks, interleave,
+                               group_by_index, 2));
+        EXPECT_EQ(decoded.tensor_data(), data.tensor_data())
+            << "num_chunks=" << num_chunks << ", interleave=" << interleave
+            << ", group_by_index=" << group_by_index;
+      }
+    }
+  }
+
+  for (const int coder_version : {0, 3}) {
+    Tensor encoded;
+    EXPECT_FALSE(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                           kOverflowWidth, 0,
+                           {data, index, cdf, cdf_size, offset}, &encoded, 1,
+                           1, false, coder_version)
+                     .ok());
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, DecoderCorrupt) {
+  Tensor index(DT_INT32, {8});
+  index.flat<int32>().setZero();
+
+  // With precision 6, the CDF only covers half of the interval.
+  Tensor cdf(DT_INT32, {1, 4});
+  cdf.flat<int32>().setValues({0, 16, 18, 32});
+
+  Tensor cdf_size(DT_INT32, {1});
+  cdf_size.vec<int32>().setValues({4});
+
+  Tensor offset(DT_INT32, {1});
+  offset.vec<int32>().setValues({1});
+
+  Tensor encoded(DT_STRING, {});
+  encoded.scalar<tstring>()() = string(8, '\xff');
+
+  // The error is reported even without debug checks.
+  for (const int coder_version : {1, 2}) {
+    Tensor unused;
+    const Status status =
+        RunOpImpl("UnboundedIndexRangeDecode", 6, 2, 0,
+                  {encoded, index, cdf, cdf_size, offset}, &unused, 1, 1,
+                  false, coder_version);
+    EXPECT_FALSE(status.ok());
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, Checksum) {
+  constexpr int kPrecision = 14;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {4, 300});
+  Tensor index(DT_INT32, {4, 300});
+  auto index_flat = index.flat<int32>();
+  for (int64 i = 0; i < index_flat.size(); ++i) {
+    index_flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  for (const int num_chunks : {1, 3}) {
+    Tensor expected;
+    TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                           kOverflowWidth, 0,
+                           {data, index, cdf, cdf_size, offset}, &expected,
+                           num_chunks));
+
+    // The checksum is appended to the same bitstream.
+    Tensor encoded;
+    TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeEncode", kPrecision,
+                           kOverflowWidth, 0,
+                           {data, index, cdf, cdf_size, offset}, &encoded,
+                           num_chunks, 1, false, 1, true));
+    const string bitstream = expected.scalar<tstring>()();
+    const string checked = encoded.scalar<tstring>()();
+    ASSERT_EQ(checked.size(), bitstream.size() + 4);
+    EXPECT_EQ(checked.substr(0, bitstream.size()), bitstream);
+
+    Tensor decoded;
+    TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeDecode", kPrecision,
+                           kOverflowWidth, 0,
+                           {encoded, index, cdf, cdf_size, offset}, &decoded,
+                           num_chunks, 1, false, 1, true));
+    EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+
+    // A flipped bit anywhere is detected.
+    for (int64 i = 0; i < checked.size(); i += 7) {
+      Tensor corrupt(DT_STRING, {});
+      string bytes = checked;
+      bytes[i] ^= 1 << (i % 8);
+      corrupt.scalar<tstring>()() = bytes;
+      EXPECT_FALSE(RunOpImpl("UnboundedIndexRangeDecode", kPrecision,
+                             kOverflowWidth, 0,
+                             {corrupt, index, cdf, cdf_size, offset}, &decoded,
+                             num_chunks, 1, false, 1, true)
+                       .ok())
+          << "i=" << i;
+    }
+  }
+
+  // A string shorter than the checksum is rejected.
+  Tensor empty(DT_STRING, {});
+  Tensor decoded;
+  EXPECT_FALSE(RunOpImpl("UnboundedIndexRangeDecode", kPrecision,
+                         kOverflowWidth, 0,
+                         {empty, index, cdf, cdf_size, offset}, &decoded, 1, 1,
+                         false, 1, true)
+                   .ok());
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, AsyncKernels) {
+  constexpr int kPrecision = 14;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {4, 300});
+  Tensor index(DT_INT32, {4, 300});
+  auto index_flat = index.flat<int32>();
+  for (int64 i = 0; i < index_flat.size(); ++i) {
+    index_flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  for (const char* prefix : {"", "Batched"}) {
+    const string encode_op = string(prefix) + "UnboundedIndexRangeEncode";
+    const string decode_op = string(prefix) + "UnboundedIndexRangeDecode";
+
+    // The async kernels write the same bitstream as the default kernels.
+    Tensor expected;
+    TF_ASSERT_OK(RunOpImpl(encode_op, kPrecision, kOverflowWidth, 0,
+                           {data, index, cdf, cdf_size, offset}, &expected,
+                           3));
+    Tensor encoded;
+    TF_ASSERT_OK(RunOpImpl(encode_op, kPrecision, kOverflowWidth, 0,
+                           {data, index, cdf, cdf_size, offset}, &encoded, 3,
+                           1, false, 1, false, "async"));
+    tensorflow::test::ExpectTensorEqual<tstring>(encoded, expected);
+
+    Tensor decoded;
+    TF_ASSERT_OK(RunOpImpl(decode_op, kPrecision, kOverflowWidth, 0,
+                           {encoded, index, cdf, cdf_size, offset}, &decoded,
+                           3, 1, false, 1, false, "async"));
+    EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+  }
+
+  // Errors are reported through the context as usual.
+  Tensor decoded;
+  EXPECT_FALSE(RunOpImpl("UnboundedIndexRangeDecode", kPrecision,
+                         kOverflowWidth, 0,
+                         {Tensor(DT_STRING, {2}), index, cdf, cdf_size, offset},
+                         &decoded, 1, 1, false, 1, false, "async")
+                   .ok());
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, DecodeTable) {
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  // Covers both the complete and the bucketed decode tables.
+  for (const int precision : {10, 14}) {
+    Tensor data(DT_INT32, {2, 16, 16, 8});
+    Tensor index(DT_INT32, data.shape());
+    auto flat = index.flat<int32>();
+    for (int64 i = 0; i < flat.size(); ++i) {
+      flat(i) = gen.Uniform(kCdfCount);
+    }
+
+    Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+    Tensor cdf_size(DT_INT32, {kCdfCount});
+    Tensor offset(DT_INT32, {kCdfCount});
+    BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, precision);
+
+    TF_ASSERT_OK(NodeDefBuilder("table", "CdfToDecodeTable")
+                     .Input(tensorflow::FakeInput(DT_INT32))
+                     .Attr("precision", precision)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    inputs_.clear();
+    inputs_.emplace_back(&cdf);
+    TF_ASSERT_OK(RunOpKernel());
+    const Tensor table = *GetOutput(0);
+    inputs_.clear();
+    EXPECT_EQ(table.shape(),
+              (TensorShape{kCdfCount, 1 << std::min(precision, 12)}));
+
+    Tensor encoded;
+    TF_ASSERT_OK(RunEncodeOp(precision, kOverflowWidth,
+                             {data, index, cdf, cdf_size, offset}, &encoded));
+
+    Tensor decoded;
+    TF_ASSERT_OK(RunOpImpl("UnboundedIndexRangeDecodeWithTable", precision,
+                           kOverflowWidth, 0,
+                           {encoded, index, cdf, cdf_size, offset, table},
+                           &decoded));
+    EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncode", precision,
+                           kOverflowWidth, 0,
+                           {data, index, cdf, cdf_size, offset}, &encoded));
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeDecodeWithTable",
+                           precision, kOverflowWidth, 0,
+                           {encoded, index, cdf, cdf_size, offset, table},
+                           &decoded));
+    EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, ChunkedCorruptTable) {
+  Tensor index(DT_INT32, {4});
+  index.flat<int32>().setZero();
+
+  Tensor cdf(DT_INT32, {1, 4});
+  cdf.flat<int32>().setValues({0, 16, 18, 32});
+
+  Tensor cdf_size(DT_INT32, {1});
+  cdf_size.vec<int32>().setValues({4});
+
+  Tensor offset(DT_INT32, {1});
+  offset.vec<int32>().setValues({1});
+
+  // The first chunk length does not fit in the string.
+  Tensor encoded(DT_STRING, {});
+  encoded.scalar<tstring>()() = "\x7f\x01\x02";
+
+  Tensor unused;
+  const Status status =
+      RunOpImpl("UnboundedIndexRangeDecode", 5, 2, 0,
+                {encoded, index, cdf, cdf_size, offset}, &unused, 4);
+  EXPECT_FALSE(status.ok());
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, CdfTable) {
+  constexpr int kPrecision = 14;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {3, 16, 8});
+  Tensor index(DT_INT32, data.shape());
+  auto flat = index.flat<int32>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  // Insert some out-of-range values manually.
+  auto data_flat = data.flat<int32>();
+  data_flat(0) = -3;
+  data_flat(data_flat.size() - 1) = kCdfWidth + 5;
+
+  // The table is shared, so that it outlives the kernel creating it.
+  TF_ASSERT_OK(NodeDefBuilder("table", "CreateCdfTable")
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Attr("precision", kPrecision)
+                   .Attr("shared_name", "cdf_table")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  auto lookup_table = [this]() {
+    CdfTable* table = nullptr;
+    TF_CHECK_OK(device_->resource_manager()->Lookup<CdfTable>(
+        device_->resource_manager()->default_container(), "cdf_table",
+        &table));
+    table->Unref();
+    return table;
+  };
+
+  inputs_.clear();
+  inputs_.emplace_back(&cdf);
+  inputs_.emplace_back(&cdf_size);
+  inputs_.emplace_back(&offset);
+  TF_ASSERT_OK(RunOpKernel());
+  const Tensor handle = *GetOutput(0);
+  const CdfTable* table = lookup_table();
+
+  // Running again with the same tensors reuses the table.
+  TF_ASSERT_OK(RunOpKernel());
+  EXPECT_EQ(lookup_table(), table);
+
+  // Running with a copy of the CDFs recreates the table.
+  Tensor cdf_copy(DT_INT32, cdf.shape());
+  cdf_copy.flat<int32>() = cdf.flat<int32>();
+  inputs_[0] = &cdf_copy;
+  TF_ASSERT_OK(RunOpKernel());
+  EXPECT_NE(lookup_table(), table);
+  inputs_.clear();
+
+  for (const int interleave : {1, 4}) {
+    Tensor expected;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncode", kPrecision,
+                           kOverflowWidth, 0,
+                           {data, index, cdf, cdf_size, offset}, &expected, 2,
+                           interleave));
+
+    Tensor encoded;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncodeWithCdfTable",
+                           kPrecision, kOverflowWidth, 1,
+                           {data, index, handle}, &encoded, 2, interleave));
+    EXPECT_EQ(encoded.shape(), expected.shape());
+    for (int64 i = 0; i < encoded.NumElements(); ++i) {
+      EXPECT_EQ(encoded.vec<tstring>()(i), expected.vec<tstring>()(i));
+    }
+
+    Tensor decoded;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeDecodeWithCdfTable",
+                           kPrecision, kOverflowWidth, 1,
+                           {encoded, index, handle}, &decoded, 2, interleave));
+    EXPECT_EQ(decoded.shape(), data.shape());
+    EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+  }
+
+  // The coding ops should use the precision the table was created with.
+  Tensor unused;
+  const Status status =
+      RunOpImpl("BatchedUnboundedIndexRangeEncodeWithCdfTable", kPrecision - 1,
+                kOverflowWidth, 0, {data, index, handle}, &unused);
+  EXPECT_FALSE(status.ok());
+  EXPECT_NE(status.error_message().find("precision"), string::npos)
+      << status.error_message();
+
+  // The index is still checked with debug_level > 0.
+  index.flat<int32>()(0) = kCdfCount;
+  EXPECT_FALSE(RunOpImpl("BatchedUnboundedIndexRangeEncodeWithCdfTable",
+                         kPrecision, kOverflowWidth, 1, {data, index, handle},
+                         &unused)
+                   .ok());
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, FusedQuantization) {
+  constexpr int kPrecision = 15;
+  constexpr int kOverflowWidth = 4;
+  constexpr int kCdfCount = 8;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  // One CDF per channel, as in ContinuousBatchedEntropyModel.
+  Tensor index(DT_INT32, {3, 16, kCdfCount});
+  auto index_flat = index.flat<int32>();
+  for (int64 i = 0; i < index_flat.size(); ++i) {
+    index_flat(i) = i % kCdfCount;
+  }
+  Tensor channel_index(DT_INT32, {kCdfCount});
+  std::iota(channel_index.flat<int32>().data(),
+            channel_index.flat<int32>().data() + kCdfCount, 0);
+
+  Tensor data(DT_INT32, index.shape());
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+  auto data_flat = data.flat<int32>();
+  data_flat(0) = -3;
+  data_flat(data_flat.size() - 1) = kCdfWidth + 5;
+
+  // Values which round to `data` after subtracting the quantization offset.
+  // The offsets are exactly representable, so that the ties are exact.
+  Tensor quantization_offset(tensorflow::DT_FLOAT, {kCdfCount});
+  auto quantization_offset_vec = quantization_offset.vec<float>();
+  for (int i = 0; i < kCdfCount; ++i) {
+    quantization_offset_vec(i) = 0.25f * (i % 3) - 0.25f;
+  }
+  Tensor values(tensorflow::DT_FLOAT, data.shape());
+  auto values_flat = values.flat<float>();
+  for (int64 i = 0; i < values_flat.size(); ++i) {
+    float noise;
+    if (data_flat(i) % 2 == 0) {
+      // Ties are rounded to even.
+      noise = gen.Uniform(2) ? 0.5f : -0.5f;
+    } else {
+      noise = 0.8f * gen.RandFloat() - 0.4f;
+    }
+    values_flat(i) =
+        data_flat(i) + quantization_offset_vec(index_flat(i)) + noise;
+  }
+
+  TF_ASSERT_OK(NodeDefBuilder("table", "CreateCdfTable")
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Attr("precision", kPrecision)
+                   .Attr("shared_name", "cdf_table")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&cdf);
+  inputs_.emplace_back(&cdf_size);
+  inputs_.emplace_back(&offset);
+  TF_ASSERT_OK(RunOpKernel());
+  const Tensor handle = *GetOutput(0);
+  inputs_.clear();
+
+  Tensor batched_index(DT_INT32, {1, 16, kCdfCount});
+  for (int64 i = 0; i < batched_index.NumElements(); ++i) {
+    batched_index.flat<int32>()(i) = index_flat(i);
+  }
+
+  // The dequantized values are data + quantization_offset[index].
+  Tensor dequantized(tensorflow::DT_FLOAT, data.shape());
+  for (int64 i = 0; i < dequantized.NumElements(); ++i) {
+    dequantized.flat<float>()(i) =
+        data_flat(i) + quantization_offset_vec(index_flat(i));
+  }
+  Tensor shape(DT_INT32, {2});
+  shape.flat<int32>().setValues({16, kCdfCount});
+
+  for (const bool group_by_index : {false, true}) {
+    Tensor expected;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncodeWithCdfTable",
+                           kPrecision, kOverflowWidth, 1,
+                           {data, index, handle}, &expected, 2, 4,
+                           group_by_index));
+
+    for (const Tensor& fused_index : {channel_index, batched_index, index}) {
+      Tensor encoded;
+      TF_ASSERT_OK(RunOpImpl("BatchedQuantizeAndRangeEncodeWithCdfTable",
+                             kPrecision, kOverflowWidth, 1,
+                             {values, fused_index, quantization_offset, handle},
+                             &encoded, 2, 4, group_by_index));
+      ASSERT_EQ(encoded.shape(), expected.shape());
+      for (int64 i = 0; i < encoded.NumElements(); ++i) {
+        EXPECT_EQ(encoded.vec<tstring>()(i), expected.vec<tstring>()(i));
+      }
+
+      Tensor decoded;
+      TF_ASSERT_OK(RunOpImpl(
+          "BatchedRangeDecodeAndDequantizeWithCdfTable", kPrecision,
+          kOverflowWidth, 1,
+          {encoded, shape, fused_index, quantization_offset, handle}, &decoded,
+          2, 4, group_by_index));
+      EXPECT_EQ(decoded.shape(), data.shape());
+      EXPECT_EQ(decoded.tensor_data(), dequantized.tensor_data());
+    }
+  }
+
+  // `index` should be tiled from the innermost axes only.
+  Tensor unused;
+  Tensor invalid_index(DT_INT32, {16, 1});
+  invalid_index.flat<int32>().setZero();
+  EXPECT_FALSE(RunOpImpl("BatchedQuantizeAndRangeEncodeWithCdfTable",
+                         kPrecision, kOverflowWidth, 1,
+                         {values, invalid_index, quantization_offset, handle},
+                         &unused)
+                   .ok());
+
+  // `quantization_offset` should have one element per CDF.
+  Tensor invalid_offset(tensorflow::DT_FLOAT, {kCdfCount - 1});
+  EXPECT_FALSE(RunOpImpl("BatchedQuantizeAndRangeEncodeWithCdfTable",
+                         kPrecision, kOverflowWidth, 1,
+                         {values, channel_index, invalid_offset, handle},
+                         &unused)
+                   .ok());
+
+  channel_index.flat<int32>()(0) = kCdfCount;
+  EXPECT_FALSE(RunOpImpl("BatchedQuantizeAndRangeEncodeWithCdfTable",
+                         kPrecision, kOverflowWidth, 1,
+                         {values, channel_index, quantization_offset, handle},
+                         &unused)
+                   .ok());
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, CdfTableInvalidCdf) {
+  Tensor cdf(DT_INT32, {1, 4});
+  cdf.flat<int32>().setValues({0, 18, 16, 32});
+
+  Tensor cdf_size(DT_INT32, {1});
+  cdf_size.vec<int32>().setValues({4});
+
+  Tensor offset(DT_INT32, {1});
+  offset.vec<int32>().setValues({1});
+
+  TF_ASSERT_OK(NodeDefBuilder("table", "CreateCdfTable")
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Attr("precision", 5)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&cdf);
+  inputs_.emplace_back(&cdf_size);
+  inputs_.emplace_back(&offset);
+  const Status status = RunOpKernel();
+  inputs_.clear();
+  EXPECT_FALSE(status.ok());
+  EXPECT_NE(status.error_message().find("monotonic"), string::npos)
+      << status.error_message();
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, PackedCdfTable) {
+  // With precision 16, the last element of each CDF does not fit in uint16.
+  constexpr int kPrecision = 16;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {3, 16, 8});
+  Tensor index(DT_INT32, data.shape());
+  auto flat = index.flat<int32>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  auto data_flat = data.flat<int32>();
+  data_flat(0) = -3;
+  data_flat(data_flat.size() - 1) = kCdfWidth + 5;
+
+  Tensor cdf_row_splits(DT_INT32, {kCdfCount + 1});
+  auto row_splits = cdf_row_splits.vec<int32>();
+  row_splits(0) = 0;
+  for (int i = 0; i < kCdfCount; ++i) {
+    row_splits(i + 1) = row_splits(i) + cdf_size.vec<int32>()(i) - 1;
+  }
+  Tensor cdf_values(DT_UINT16, {row_splits(kCdfCount)});
+  for (int i = 0; i < kCdfCount; ++i) {
+    for (int j = row_splits(i); j < row_splits(i + 1); ++j) {
+      cdf_values.vec<uint16>()(j) = cdf.matrix<int32>()(i, j - row_splits(i));
+    }
+  }
+
+  TF_ASSERT_OK(NodeDefBuilder("table", "CreatePackedCdfTable")
+                   .Input(tensorflow::FakeInput(DT_UINT16))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Attr("precision", kPrecision)
+                   .Attr("shared_name", "packed_cdf_table")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&cdf_values);
+  inputs_.emplace_back(&cdf_row_splits);
+  inputs_.emplace_back(&offset);
+  TF_ASSERT_OK(RunOpKernel());
+  const Tensor handle = *GetOutput(0);
+  inputs_.clear();
+
+  for (const int interleave : {1, 4}) {
+    Tensor expected;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncode", kPrecision,
+                           kOverflowWidth, 0,
+                           {data, index, cdf, cdf_size, offset}, &expected, 2,
+                           interleave));
+
+    Tensor encoded;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncodeWithCdfTable",
+                           kPrecision, kOverflowWidth, 1,
+                           {data, index, handle}, &encoded, 2, interleave));
+    EXPECT_EQ(encoded.shape(), expected.shape());
+    for (int64 i = 0; i < encoded.NumElements(); ++i) {
+      EXPECT_EQ(encoded.vec<tstring>()(i), expected.vec<tstring>()(i));
+    }
+
+    Tensor decoded;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeDecodeWithCdfTable",
+                           kPrecision, kOverflowWidth, 1,
+                           {encoded, index, handle}, &decoded, 2, interleave));
+    EXPECT_EQ(decoded.shape(), data.shape());
+    EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, PackedCdfTableInvalidCdf) {
+  Tensor cdf_values(DT_UINT16, {3});
+  cdf_values.vec<uint16>().setValues({0, 18, 16});
+
+  Tensor cdf_row_splits(DT_INT32, {2});
+  cdf_row_splits.vec<int32>().setValues({0, 3});
+
+  Tensor offset(DT_INT32, {1});
+  offset.vec<int32>().setValues({1});
+
+  TF_ASSERT_OK(NodeDefBuilder("table", "CreatePackedCdfTable")
+                   .Input(tensorflow::FakeInput(DT_UINT16))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Attr("precision", 5)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&cdf_values);
+  inputs_.emplace_back(&cdf_row_splits);
+  inputs_.emplace_back(&offset);
+  Status status = RunOpKernel();
+  EXPECT_FALSE(status.ok());
+  EXPECT_NE(status.error_message().find("monotonic"), string::npos)
+      << status.error_message();
+
+  // The row splits should cover `cdf_values`.
+  cdf_values.vec<uint16>().setValues({0, 16, 18});
+  cdf_row_splits.vec<int32>().setValues({0, 2});
+  status = RunOpKernel();
+  inputs_.clear();
+  EXPECT_FALSE(status.ok());
+  EXPECT_NE(status.error_message().find("cdf_row_splits"), string::npos)
+      << status.error_message();
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, SaveAndLoadCdfTable) {
+  constexpr int kPrecision = 16;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {3, 16, 8});
+  Tensor index(DT_INT32, data.shape());
+  auto flat = index.flat<int32>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  TF_ASSERT_OK(NodeDefBuilder("table", "CreateCdfTable")
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Attr("precision", kPrecision)
+                   .Attr("shared_name", "cdf_table_to_save")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&cdf);
+  inputs_.emplace_back(&cdf_size);
+  inputs_.emplace_back(&offset);
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor handle = *GetOutput(0);
+
+  const string path = tensorflow::io::JoinPath(tensorflow::testing::TmpDir(),
+                                               "cdf_table");
+  Tensor filename(DT_STRING, {});
+  filename.scalar<tstring>()() = path;
+  TF_ASSERT_OK(NodeDefBuilder("save", "SaveCdfTable")
+                   .Input(tensorflow::FakeInput(DT_RESOURCE))
+                   .Input(tensorflow::FakeInput(DT_STRING))
+                   .Attr("precision", kPrecision)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&handle);
+  inputs_.emplace_back(&filename);
+  TF_ASSERT_OK(RunOpKernel());
+  inputs_.clear();
+
+  Tensor expected;
+  TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncode", kPrecision,
+                         kOverflowWidth, 0,
+                         {data, index, cdf, cdf_size, offset}, &expected, 2,
+                         4));
+
+  for (const int debug_level : {0, 1}) {
+    TF_ASSERT_OK(NodeDefBuilder("load", "LoadCdfTable")
+                     .Input(tensorflow::FakeInput(DT_STRING))
+                     .Attr("precision", kPrecision)
+                     .Attr("debug_level", debug_level)
+                     .Attr("shared_name", "loaded_cdf_table")
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    inputs_.clear();
+    inputs_.emplace_back(&filename);
+    TF_ASSERT_OK(RunOpKernel());
+    const Tensor loaded = *GetOutput(0);
+    inputs_.clear();
+
+    Tensor encoded;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeEncodeWithCdfTable",
+                           kPrecision, kOverflowWidth, 1,
+                           {data, index, loaded}, &encoded, 2, 4));
+    EXPECT_EQ(encoded.shape(), expected.shape());
+    for (int64 i = 0; i < encoded.NumElements(); ++i) {
+      EXPECT_EQ(encoded.vec<tstring>()(i), expected.vec<tstring>()(i));
+    }
+
+    Tensor decoded;
+    TF_ASSERT_OK(RunOpImpl("BatchedUnboundedIndexRangeDecodeWithCdfTable",
+                           kPrecision, kOverflowWidth, 1,
+                           {encoded, index, loaded}, &decoded, 2, 4));
+    EXPECT_EQ(decoded.tensor_data(), data.tensor_data());
+  }
+
+  // A truncated file is rejected.
+  string contents;
+  TF_ASSERT_OK(tensorflow::ReadFileToString(tensorflow::Env::Default(), path,
+                                            &contents));
+  TF_ASSERT_OK(tensorflow::WriteStringToFile(
+      tensorflow::Env::Default(), path,
+      contents.substr(0, contents.size() - 1)));
+  TF_ASSERT_OK(NodeDefBuilder("load", "LoadCdfTable")
+                   .Input(tensorflow::FakeInput(DT_STRING))
+                   .Attr("precision", kPrecision)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&filename);
+  const Status status = RunOpKernel();
+  inputs_.clear();
+  EXPECT_FALSE(status.ok());
+  EXPECT_NE(status.error_message().find("bytes"), string::npos)
+      << status.error_message();
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, EncodeStream) {
+  constexpr int kPrecision = 14;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {1000});
+  Tensor index(DT_INT32, data.shape());
+  auto flat = index.flat<int32>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  // Insert some out-of-range values manually.
+  auto data_flat = data.flat<int32>();
+  data_flat(0) = -3;
+  data_flat(data_flat.size() / 2) = 1 << 20;
+  data_flat(data_flat.size() - 1) = kCdfWidth + 5;
+
+  Tensor expected;
+  TF_ASSERT_OK(RunEncodeOp(kPrecision, kOverflowWidth,
+                           {data, index, cdf, cdf_size, offset}, &expected));
+
+  TF_ASSERT_OK(NodeDefBuilder("table", "CreateCdfTable")
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Attr("precision", kPrecision)
+                   .Attr("shared_name", "encode_stream_cdf_table")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&cdf);
+  inputs_.emplace_back(&cdf_size);
+  inputs_.emplace_back(&offset);
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor table = *GetOutput(0);
+  inputs_.clear();
+
+  for (const int piece_size : {1, 7, 1000}) {
+    TF_ASSERT_OK(NodeDefBuilder("stream", "CreateRangeEncodeStream")
+                     .Input(tensorflow::FakeInput(DT_RESOURCE))
+                     .Attr("precision", kPrecision)
+                     .Attr("overflow_width", kOverflowWidth)
+                     .Attr("shared_name", "encode_stream")
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    inputs_.clear();
+    inputs_.emplace_back(&table);
+    TF_ASSERT_OK(RunOpKernel());
+    Tensor stream = *GetOutput(0);
+    inputs_.clear();
+
+    TF_ASSERT_OK(NodeDefBuilder("next", "RangeEncodeStreamNext")
+                     .Input(tensorflow::FakeInput(DT_RESOURCE))
+                     .Input(tensorflow::FakeInput(DT_INT32))
+                     .Input(tensorflow::FakeInput(DT_INT32))
+                     .Input(tensorflow::FakeInput(DT_BOOL))
+                     .Attr("debug_level", 1)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+
+    string encoded;
+    Tensor final(DT_BOOL, {});
+    for (int64 position = 0; position < data_flat.size();) {
+      const int64 size =
+          std::min<int64>(piece_size, data_flat.size() - position);
+      Tensor piece(DT_INT32, {size});
+      Tensor piece_index(DT_INT32, {size});
+      for (int64 i = 0; i < size; ++i) {
+        piece.flat<int32>()(i) = data_flat(position + i);
+        piece_index.flat<int32>()(i) = flat(position + i);
+      }
+      position += size;
+      final.scalar<bool>()() = (position == data_flat.size());
+
+      inputs_.clear();
+      inputs_.emplace_back(&stream);
+      inputs_.emplace_back(&piece);
+      inputs_.emplace_back(&piece_index);
+      inputs_.emplace_back(&final);
+      TF_ASSERT_OK(RunOpKernel());
+      const tstring& fragment = GetOutput(0)->scalar<tstring>()();
+      encoded.append(fragment.data(), fragment.size());
+      inputs_.clear();
+    }
+    EXPECT_EQ(encoded, string(expected.scalar<tstring>()()));
+
+    // The stream is finalized.
+    Tensor empty(DT_INT32, {0});
+    inputs_.clear();
+    inputs_.emplace_back(&stream);
+    inputs_.emplace_back(&empty);
+    inputs_.emplace_back(&empty);
+    inputs_.emplace_back(&final);
+    EXPECT_FALSE(RunOpKernel().ok());
+    inputs_.clear();
+  }
+}
+
+TEST_F(UnboundedIndexRangeCoderOpsTest, DecodeStream) {
+  constexpr int kPrecision = 14;
+  constexpr int kOverflowWidth = 3;
+  constexpr int kCdfCount = 10;
+  constexpr int kCdfWidth = 40;
+
+  std::random_device rd;
+  random::PhiloxRandom philox(rd(), rd());
+  random::SimplePhilox gen(&philox);
+
+  Tensor data(DT_INT32, {1000});
+  Tensor index(DT_INT32, data.shape());
+  auto flat = index.flat<int32>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = gen.Uniform(kCdfCount);
+  }
+
+  Tensor cdf(DT_INT32, {kCdfCount, kCdfWidth + 1});
+  Tensor cdf_size(DT_INT32, {kCdfCount});
+  Tensor offset(DT_INT32, {kCdfCount});
+  BuildDataAndCdf(&gen, &data, index, &cdf, &cdf_size, &offset, kPrecision);
+
+  // Insert some out-of-range values manually.
+  auto data_flat = data.flat<int32>();
+  data_flat(0) = -3;
+  data_flat(data_flat.size() / 2) = 1 << 20;
+  data_flat(data_flat.size() - 1) = kCdfWidth + 5;
+
+  Tensor encoded;
+  TF_ASSERT_OK(RunEncodeOp(kPrecision, kOverflowWidth,
+                           {data, index, cdf, cdf_size, offset}, &encoded));
+  const tstring& bitstream = encoded.scalar<tstring>()();
+
+  TF_ASSERT_OK(NodeDefBuilder("table", "CreateCdfTable")
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Input(tensorflow::FakeInput(DT_INT32))
+                   .Attr("precision", kPrecision)
+                   .Attr("shared_name", "stream_cdf_table")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  inputs_.clear();
+  inputs_.emplace_back(&cdf);
+  inputs_.emplace_back(&cdf_size);
+  inputs_.emplace_back(&offset);
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor table = *GetOutput(0);
+  inputs_.clear();
+
+  for (const int fragment_size : {1, 3, 16, 1 << 20}) {
+    TF_ASSERT_OK(NodeDefBuilder("stream", "CreateRangeDecodeStream")
+                     .Input(tensorflow::FakeInput(DT_RESOURCE))
+                     .Attr("precision", kPrecision)
+                     .Attr("overflow_width", kOverflowWidth)
+                     .Attr("shared_name", "stream")
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    inputs_.clear();
+    inputs_.emplace_back(&table);
+    TF_ASSERT_OK(RunOpKernel());
+    Tensor stream = *GetOutput(0);
+    inputs_.clear();
+
+    TF_ASSERT_OK(NodeDefBuilder("next", "RangeDecodeStreamNext")
+                     .Input(tensorflow::FakeInput(DT_RESOURCE))
+                     .Input(tensorflow::FakeInput(DT_STRING))
+                     .Input(tensorflow::FakeInput(DT_INT32))
+                     .Input(tensorflow::FakeInput(DT_BOOL))
+                     .Attr("debug_level", 1)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+
+    // Feeds the bitstream in fragments, together with the index of the values
+    // that have not been decoded yet.
+    std::vector<int32> decoded;
+    for (int64 position = 0; position < bitstream.size();) {
+      const int64 size =
+          std::min<int64>(fragment_size, bitstream.size() - position);
+      Tensor fragment(DT_STRING, {});
+      fragment.scalar<tstring>()() =
+          tstring(bitstream.data() + position, size);
+      position += size;
+
+      Tensor remaining(DT_INT32, {index.NumElements() -
+                                  static_cast<int64>(decoded.size())});
+      for (int64 i = 0; i < remaining.NumElements(); ++i) {
+        remaining.flat<int32>()(i) = flat(decoded.size() + i);
+      }
+      Tensor final(DT_BOOL, {});
+      final.scalar<bool>()() = (position == bitstream.size());
+
+      inputs_.clear();
+      inputs_.emplace_back(&stream);
+      inputs_.emplace_back(&fragment);
+      inputs_.emplace_back(&remaining);
+      inputs_.emplace_back(&final);
+      TF_ASSERT_OK(RunOpKernel());
+      const Tensor& output = *GetOutput(0);
+      for (int64 i = 0; i < output.NumElements(); ++i) {
+        decoded.push_back(output.flat<int32>()(i));
+      }
+      inputs_.clear();
+    }
+
+    ASSERT_EQ(decoded.size(), data_flat.size());
+    for (int64 i = 0; i < data_flat.size(); ++i) {
+      EXPECT_EQ(decoded[i], data_flat(i)) << "i=" << i;
+    }
+  }
+}
+
 TEST_F(UnboundedIndexRangeCoderOpsTest, DecoderShapeFn) {
   Tensor encoded_tensor(DT_STRING, TensorShape{2});
   Tensor index_tensor(DT_INT32, TensorShape{4, 6, 8});
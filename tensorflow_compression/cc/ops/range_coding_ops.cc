@@ -13,6 +13,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+
 #include "tensorflow/core/framework/common_shape_fns.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/shape_inference.h"
@@ -32,6 +34,7 @@ REGISTER_OP("RangeEncode")
     .Output("encoded: string")
     .Attr("precision: int >= 1")
     .Attr("debug_level: int = 1")
+    .Attr("interleave: int = 1")
     .SetShapeFn(shape_inference::ScalarShape)
     .Doc(R"doc(
 Using the provided cumulative distribution functions (CDF) inside `cdf`, returns
@@ -67,6 +70,14 @@ The encoded string neither contains the shape information of the encoded data
 nor a termination symbol. Therefore the shape of the encoded data must be
 explicitly provided to the decoder.
 
+If `interleave` is greater than 1, that many range coders run side by side over
+the elements of `data` in a round-robin fashion, i.e., the i-th element of the
+flattened `data` is encoded by the `(i % interleave)`-th coder. The coders do
+not depend on each other, which lets the CPU overlap their work and speeds up
+decoding. Each coder produces its own substream. The output then starts with a
+table of varint-coded byte lengths of all substreams but the last, followed by
+the concatenated substreams.
+
 Implementation notes:
 
 - Because of potential performance issues, the op does not check whether
@@ -86,6 +97,8 @@ cdf: An int32 tensor representing the CDF's of `data`. Each integer is divided
 encoded: A range-coded scalar string.
 precision: The number of bits for probability quantization. Must be <= 16.
 debug_level: Either 0 or 1.
+interleave: The number of interleaved coders. Must be 1, 2, 4, or 8. The
+  default value 1 produces a single range-coded stream.
 )doc");
 
 REGISTER_OP("RangeDecode")
@@ -95,6 +108,7 @@ REGISTER_OP("RangeDecode")
     .Output("decoded: int16")
     .Attr("precision: int >= 1")
     .Attr("debug_level: int = 1")
+    .Attr("interleave: int = 1")
     .SetShapeFn([](InferenceContext* c) {
       ShapeHandle out;
       TF_RETURN_IF_ERROR(c->MakeShapeFromShapeTensor(1, &out));
@@ -110,8 +124,9 @@ should be known by the caller.
 Implementation notes:
 
 - If wrong input was given (e.g., corrupt `encoded` string, or `cdf` or
-`precision` do not match encoder), the decode is unsuccessful. Because of
-potential performance issues, the decoder does not return error status.
+`precision` do not match encoder), the decode is unsuccessful. The decoder
+returns an error status when it detects this on the way, which is cheap but
+does not catch every corruption.
 
 encoded: A scalar string tensor from RangeEncode.
 shape: An int32 1-D tensor representing the shape of the data encoded by
@@ -120,6 +135,42 @@ decoded: An int16 tensor with shape equal to `shape`.
 precision: The number of bits for probability quantization. Must be <= 16, and
   must match the precision used by RangeEncode that produced `encoded`.
 debug_level: Either 0 or 1.
+interleave: Must match the value used by RangeEncode that produced `encoded`.
+)doc");
+
+REGISTER_OP("RangeDecodeWithTable")
+    .Input("encoded: string")
+    .Input("shape: int32")
+    .Input("cdf: int32")
+    .Input("decode_table: int16")
+    .Output("decoded: int16")
+    .Attr("precision: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("interleave: int = 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->MakeShapeFromShapeTensor(1, &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Same as RangeDecode, but uses a precomputed decode table to look up symbols.
+
+The output is identical to that of RangeDecode with the same arguments. The
+table lookup replaces the binary search over each CDF, which speeds up decoding
+when the same `cdf` is used many times.
+
+encoded: A scalar string tensor from RangeEncode.
+shape: An int32 1-D tensor representing the shape of the data encoded by
+  RangeEncode.
+cdf: An int32 tensor representing the CDF's of `data`. Each integer is divided
+  by `2^precision` to represent a fraction.
+decode_table: The output of CdfToDecodeTable for `cdf` and `precision`.
+decoded: An int16 tensor with shape equal to `shape`.
+precision: The number of bits for probability quantization. Must be <= 16, and
+  must match the precision used by RangeEncode that produced `encoded`.
+debug_level: Either 0 or 1.
+interleave: Must match the value used by RangeEncode that produced `encoded`.
 )doc");
 
 REGISTER_OP("UnboundedIndexRangeEncode")
@@ -132,16 +183,28 @@ REGISTER_OP("UnboundedIndexRangeEncode")
     .Attr("precision: int >= 1")
     .Attr("overflow_width: int >= 1")
     .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
     .SetShapeFn(shape_inference::ScalarShape)
     .Doc(R"doc(
 Range encodes unbounded integer `data` using an indexed probability table.
 
-Arguments `data` and `index` should have the same shape. `data` contains the
-values to be encoded. For each value in `data`, the corresponding value in
-`index` determines which row in `cdf` should be used to encode the value in
-`data`. `index` also determines which element in `offset` vector determines the
-integer interval the cdf applies to. Naturally, the elements of `index` should
-be in the half-open interval `[0, cdf.shape[0])`.
+Argument `index` should have the same shape as `data`, or a shape that can be
+broadcast to it. `data` contains the values to be encoded. For each value in
+`data`, the corresponding value in `index` determines which row in `cdf` should
+be used to encode the value in `data`. `index` also determines which element in
+`offset` vector determines the integer interval the cdf applies to. Naturally,
+the elements of `index` should be in the half-open interval
+`[0, cdf.shape[0])`.
+
+When `index` depends on only some of the axes of `data`, e.g., on the channel,
+passing it without the other axes avoids a tensor of the same size as `data`.
+Because the broadcast index is computed as the values are coded, this is
+slightly slower than an `index` of the same shape. Such data is decoded with
+`UnboundedIndexRangeDecodeWithShape`.
 
 The argument `cdf` is a 2-D tensor and each of its rows contains a CDF. The
 argument `cdf_size` is a 1-D tensor, and its length should be the same as the
@@ -178,6 +241,21 @@ The encoded output contains neither the shape information of the encoded data
 nor a termination symbol. Therefore the shape of the encoded data must be
 explicitly provided to the decoder.
 
+If `num_chunks` is greater than 1, the flattened `data` is split into that many
+contiguous chunks of nearly equal size (or one chunk per element, if `data` has
+fewer elements), and each chunk is range encoded independently. The output then
+starts with a table of varint-coded byte lengths of all chunks but the last,
+followed by the concatenated chunks. The chunks can be decoded in parallel at
+the cost of a slightly longer string.
+
+If `group_by_index` is true, the values are coded in the order of their
+`index` instead of the order of the flattened `data`: first all values with
+index 0 in their original order, then all values with index 1, and so on. The
+decoder derives the same order from `index`, so it is not transmitted. This
+keeps each row of `cdf` in cache while its values are coded, which speeds up
+coding when there are many large CDFs. Chunks and interleaved coders apply to
+the grouped order.
+
 Implementation notes:
 
 - Because of potential performance issues, the op does not check if `cdf`
@@ -190,8 +268,18 @@ are incorrect. For this reason, the range coder uses integer arithmetics and
 avoids using any floating point operations internally, and `cdf` should contain
 integers representing quantized probability mass rather than floating points.
 
+- `coder_version` selects the range coder. Version 1 keeps a 32-bit interval
+and reads and writes 16 bits at a time. Version 2 keeps a 64-bit interval and
+reads and writes 32-bit words, which halves the number of renormalizations and
+makes coding faster, while the compression is practically the same. The two
+bitstreams are not compatible, and the decoder has to use the same version.
+
+- If `checksum` is true, a 4-byte CRC32C of the bitstream is appended to
+`encoded`. The decoder then verifies it before decoding, and reports a corrupt
+`encoded` string as an error even with `debug_level=0`.
+
 data: An int32 tensor.
-index: An int32 tensor of the same shape as `data`.
+index: An int32 tensor of the same shape as `data`, or broadcastable to it.
 cdf: An int32 tensor representing the CDF's of `data`. Each integer is divided
   by `2^precision` to represent a fraction.
 cdf_size: An int32 tensor.
@@ -200,6 +288,13 @@ encoded: A range-coded scalar string and a prefix varint string.
 precision: The number of bits for probability quantization. Must be <= 16.
 overflow_width: The bit width of the variable-length overflow code. Must be <=
   precision.
+num_chunks: The number of independently coded chunks. The default value 1
+  produces a single range-coded string without a chunk table.
+interleave: The number of interleaved coders within each chunk. Must be 1, 2,
+  4, or 8. See `RangeEncode` for details.
+group_by_index: Whether to code the values grouped by their index. See above.
+coder_version: The version of the range coder bitstream. See above.
+checksum: Whether to append a checksum of the bitstream. See above.
 )doc");
 
 REGISTER_OP("UnboundedIndexRangeDecode")
@@ -212,6 +307,11 @@ REGISTER_OP("UnboundedIndexRangeDecode")
     .Attr("precision: int >= 1")
     .Attr("overflow_width: int >= 1")
     .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
     .SetShapeFn([](InferenceContext* c) {
       c->set_output(0, c->input(1));
       return Status::OK();
@@ -225,8 +325,11 @@ encoded stream `code` into an int32 tensor `decoded`. The other inputs `index`,
 Implementation notes:
 
 - If a wrong input was given (e.g., a corrupt `encoded` string, or `cdf` or
-`precision` not matching the encoder), the decode is unsuccessful. Because of
-potential performance issues, the decoder does not return an error status.
+`precision` not matching the encoder), the decode is unsuccessful. The decoder
+returns an error status when it detects this on the way, which is cheap but
+does not catch every corruption. With `checksum`, every corruption of
+`encoded` is caught with high probability. The values of `index`, `cdf`,
+`cdf_size`, and `offset` are only checked with `debug_level=1`.
 
 encoded: A scalar string tensor from `UnboundedIndexRangeEncode`.
 index: An int32 tensor of the same shape as `data`.
@@ -241,6 +344,930 @@ precision: The number of bits for probability quantization. Must be <= 16, and
 overflow_width: The bit width of the variable-length overflow code. Must be <=
   precision, and must match the width used by `UnboundedIndexRangeEncode` that
   produced `encoded`.
+num_chunks: Must match the value used by `UnboundedIndexRangeEncode` that
+  produced `encoded`. The chunks are decoded in parallel.
+interleave: Must match the value used by `UnboundedIndexRangeEncode` that
+  produced `encoded`.
+group_by_index: Must match the value used by `UnboundedIndexRangeEncode` that
+  produced `encoded`.
+coder_version: Must match the value used by `UnboundedIndexRangeEncode` that
+  produced `encoded`.
+checksum: Must match the value used by `UnboundedIndexRangeEncode` that
+  produced `encoded`.
+)doc");
+
+REGISTER_OP("UnboundedIndexRangeDecodeWithTable")
+    .Input("encoded: string")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Input("decode_table: int16")
+    .Output("decoded: int32")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->input(1));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Same as `UnboundedIndexRangeDecode`, but uses a precomputed decode table to look
+up symbols.
+
+The output is identical to that of `UnboundedIndexRangeDecode` with the same
+arguments. `decode_table` should be the output of `CdfToDecodeTable` for `cdf`
+and `precision`.
+)doc");
+
+REGISTER_OP("UnboundedIndexRangeDecodeWithShape")
+    .Input("encoded: string")
+    .Input("shape: int32")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Output("decoded: int32")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->MakeShapeFromShapeTensor(1, &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Same as `UnboundedIndexRangeDecode`, but decodes a tensor of shape `shape`, to
+which `index` is broadcast.
+
+This is the reverse op of `UnboundedIndexRangeEncode` when its `index` has a
+different shape than `data`. The output is identical to that of
+`UnboundedIndexRangeDecode` with `index` broadcast to `shape`.
+
+shape: An int32 1-D tensor representing the shape of the data encoded by
+  `UnboundedIndexRangeEncode`.
+index: An int32 tensor that can be broadcast to `shape`.
+decoded: An int32 tensor with shape equal to `shape`.
+)doc");
+
+REGISTER_OP("UnboundedIndexRangeDecodeWithShapeAndTable")
+    .Input("encoded: string")
+    .Input("shape: int32")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Input("decode_table: int16")
+    .Output("decoded: int32")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->MakeShapeFromShapeTensor(1, &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Same as `UnboundedIndexRangeDecodeWithShape`, but uses a precomputed decode
+table to look up symbols. See `UnboundedIndexRangeDecodeWithTable`.
+)doc");
+
+REGISTER_OP("TiledUnboundedIndexRangeEncode")
+    .Input("data: int32")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Output("encoded: string")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("tile_shape: list(int) >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Same as `UnboundedIndexRangeEncode`, but splits `data` into tiles that can be
+decoded independently of each other.
+
+The leading axes of `data` are split into tiles of `tile_shape`, e.g., the
+spatial axes of a latent tensor of shape `[height, width, channels]` with a
+`tile_shape` of length 2. The other axes are not split. The tiles at the end of
+an axis are smaller if the axis is not a multiple of the tile size. Each tile
+is coded like a tensor of its own by `UnboundedIndexRangeEncode` with the same
+attributes, in row-major order of its elements, and the tiles are stored in
+row-major order of their positions, preceded by a table of varint-coded byte
+lengths of all tiles but the last, as with `num_chunks`.
+
+`TiledUnboundedIndexRangeDecode` uses the table to find the tiles that overlap
+a region of interest, e.g., a crop of a large image, and only decodes those.
+
+tile_shape: The size of the tiles along each of the leading axes of `data`.
+  The elements should be positive, and there should be at most as many as the
+  dimensions of `data`.
+encoded: A string scalar with the tile table and the encoded tiles.
+)doc");
+
+REGISTER_OP("TiledUnboundedIndexRangeDecode")
+    .Input("encoded: string")
+    .Input("shape: int32")
+    .Input("begin: int32")
+    .Input("size: int32")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Output("decoded: int32")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("tile_shape: list(int) >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle shape;
+      TF_RETURN_IF_ERROR(c->MakeShapeFromShapeTensor(1, &shape));
+      ShapeHandle size;
+      TF_RETURN_IF_ERROR(c->MakeShapeFromShapeTensor(3, &size));
+      if (!c->RankKnown(shape) || !c->RankKnown(size)) {
+        c->set_output(0, c->UnknownShape());
+        return Status::OK();
+      }
+      ShapeHandle untiled;
+      TF_RETURN_IF_ERROR(c->Subshape(shape, c->Rank(size), &untiled));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(size, untiled, &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Decodes a region of a tensor encoded by `TiledUnboundedIndexRangeEncode`.
+
+The region is `[begin, begin + size)` along the tiled axes, and covers the
+other axes entirely, like `tf.slice` of the tensor with `begin` and `size`
+padded with 0 and -1, respectively. Only the tiles that overlap the region are
+decoded, so the work is proportional to the area of the region rather than
+that of the whole tensor. Corrupt tiles outside of the region are not
+detected.
+
+The attributes should be the same as those of the encoder.
+
+shape: An int32 1-D tensor representing the shape of the data encoded by
+  `TiledUnboundedIndexRangeEncode`.
+begin: An int32 vector with one element per element of `tile_shape`, where the
+  region starts.
+size: An int32 vector with one element per element of `tile_shape`, the size
+  of the region. The region should be inside of `shape`.
+index: An int32 tensor that can be broadcast to `shape`, the same as that of
+  the encoder.
+decoded: An int32 tensor with the values in the region, of shape `size`
+  followed by `shape[len(tile_shape):]`.
+)doc");
+
+REGISTER_OP("BatchedUnboundedIndexRangeEncode")
+    .Input("data: int32")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Output("encoded: string")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle data;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &data));
+      c->set_output(0, c->Vector(c->Dim(data, 0)));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Range encodes a batch of unbounded integer tensors into a vector of strings.
+
+This op is equivalent to running `UnboundedIndexRangeEncode` on each
+`data[i]` with the index `index[i]`, but the strings are encoded in parallel
+on the CPU worker threads.
+
+The leading axis of `index` should be either the same as that of `data`, or 1.
+In the latter case, `index[0]` is used for every element of the batch. The
+remaining axes of `index` should be the same as `data`.
+
+data: An int32 tensor of rank at least 1. The leading axis is the batch axis.
+index: An int32 tensor. See above for the shape requirements.
+cdf: An int32 tensor representing the CDF's of `data`. Each integer is divided
+  by `2^precision` to represent a fraction.
+cdf_size: An int32 tensor.
+offset: An int32 tensor.
+encoded: A range-coded string vector with length `data.shape[0]`.
+precision: The number of bits for probability quantization. Must be <= 16.
+overflow_width: The bit width of the variable-length overflow code. Must be <=
+  precision.
+num_chunks: The number of independently coded chunks per string. See
+  `UnboundedIndexRangeEncode`. Within this op, the chunks of each string are
+  coded sequentially.
+interleave: The number of interleaved coders within each chunk. Must be 1, 2,
+  4, or 8. See `RangeEncode` for details.
+group_by_index: Whether to code the values of each string grouped by their
+  index. See `UnboundedIndexRangeEncode`.
+coder_version: The version of the range coder bitstream, 1 or 2. See
+  `UnboundedIndexRangeEncode`.
+checksum: Whether to append a checksum to each string. See
+  `UnboundedIndexRangeEncode`.
+)doc");
+
+REGISTER_OP("RangeCodingCost")
+    .Input("data: int32")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Output("cost: float")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Returns the cost in bits of range encoding `data`, without encoding it.
+
+The arguments are the same as for `UnboundedIndexRangeEncode`. The cost is the
+sum over all values of `precision - log2(cdf[s + 1] - cdf[s])`, where `s` is
+the coded symbol, plus `overflow_width` bits for each digit of the overflow
+code of the values coded with the overflow code.
+
+This is the information content of the symbols, which the range coder attains
+up to its rounding of the intervals, typically within 0.1%. The string returned
+by `UnboundedIndexRangeEncode` is about `cost / 8` bytes long, plus a few bytes
+of final coder state for each chunk or interleaved coder, the segment table,
+and the checksum, if any. This op is much faster than encoding, e.g., for rate
+control.
+
+data: An int32 tensor.
+index: An int32 tensor of the same shape as `data`, or broadcastable to it.
+cdf: An int32 tensor representing the CDF's of `data`. Each integer is divided
+  by `2^precision` to represent a fraction.
+cdf_size: An int32 tensor.
+offset: An int32 tensor.
+cost: A float scalar, the cost in bits.
+precision: The number of bits for probability quantization. Must be <= 16.
+overflow_width: The bit width of the variable-length overflow code. Must be <=
+  precision.
+)doc");
+
+REGISTER_OP("BatchedRangeCodingCost")
+    .Input("data: int32")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Output("cost: float")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle data;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &data));
+      c->set_output(0, c->Vector(c->Dim(data, 0)));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Returns the cost in bits of range encoding each string of a batch.
+
+This op is equivalent to running `RangeCodingCost` on each `data[i]` with the
+index `index[i]`, i.e., it estimates the string lengths of
+`BatchedUnboundedIndexRangeEncode` with the same arguments. The shape
+requirements are the same as for that op.
+
+data: An int32 tensor of rank at least 1. The leading axis is the batch axis.
+index: An int32 tensor. See `BatchedUnboundedIndexRangeEncode`.
+cdf: An int32 tensor representing the CDF's of `data`. Each integer is divided
+  by `2^precision` to represent a fraction.
+cdf_size: An int32 tensor.
+offset: An int32 tensor.
+cost: A float vector with length `data.shape[0]`, the cost of each string in
+  bits.
+precision: The number of bits for probability quantization. Must be <= 16.
+overflow_width: The bit width of the variable-length overflow code. Must be <=
+  precision.
+)doc");
+
+REGISTER_OP("BatchedUnboundedIndexRangeDecode")
+    .Input("encoded: string")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Output("decoded: int32")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle encoded;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &encoded));
+      ShapeHandle index;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(1), 1, &index));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->ReplaceDim(index, 0, c->Dim(encoded, 0), &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+This is the reverse op of `BatchedUnboundedIndexRangeEncode`, and decodes the
+range encoded string vector `encoded` into an int32 tensor `decoded`. The
+strings are decoded in parallel on the CPU worker threads.
+
+The leading axis of `index` should be either the same as the length of
+`encoded`, or 1. In the latter case, `index[0]` is used for every string. The
+other inputs `cdf`, `cdf_size`, and `offset` should be the identical tensors
+passed to the `BatchedUnboundedIndexRangeEncode` op that generated `encoded`.
+
+encoded: A string vector from `BatchedUnboundedIndexRangeEncode`.
+index: An int32 tensor. See above for the shape requirements.
+cdf: An int32 tensor representing the CDF's of `data`. Each integer is divided
+  by `2^precision` to represent a fraction.
+cdf_size: An int32 tensor.
+offset: An int32 tensor.
+decoded: An int32 tensor with shape `encoded.shape + index.shape[1:]`.
+precision: The number of bits for probability quantization. Must be <= 16, and
+  must match the precision used by `BatchedUnboundedIndexRangeEncode` that
+  produced `encoded`.
+overflow_width: The bit width of the variable-length overflow code. Must be <=
+  precision, and must match the width used by
+  `BatchedUnboundedIndexRangeEncode` that produced `encoded`.
+num_chunks: Must match the value used by `BatchedUnboundedIndexRangeEncode`
+  that produced `encoded`.
+interleave: Must match the value used by `BatchedUnboundedIndexRangeEncode`
+  that produced `encoded`.
+group_by_index: Must match the value used by
+  `BatchedUnboundedIndexRangeEncode` that produced `encoded`.
+coder_version: Must match the value used by
+  `BatchedUnboundedIndexRangeEncode` that produced `encoded`.
+checksum: Must match the value used by `BatchedUnboundedIndexRangeEncode` that
+  produced `encoded`.
+)doc");
+
+REGISTER_OP("BatchedUnboundedIndexRangeDecodeWithTable")
+    .Input("encoded: string")
+    .Input("index: int32")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Input("decode_table: int16")
+    .Output("decoded: int32")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle encoded;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &encoded));
+      ShapeHandle index;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(1), 1, &index));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->ReplaceDim(index, 0, c->Dim(encoded, 0), &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Same as `BatchedUnboundedIndexRangeDecode`, but uses a precomputed decode table
+to look up symbols.
+
+The output is identical to that of `BatchedUnboundedIndexRangeDecode` with the
+same arguments. `decode_table` should be the output of `CdfToDecodeTable` for
+`cdf` and `precision`.
+)doc");
+
+REGISTER_OP("CreateCdfTable")
+    .Input("cdf: int32")
+    .Input("cdf_size: int32")
+    .Input("offset: int32")
+    .Output("handle: resource")
+    .Attr("precision: int >= 1")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Creates a table of CDFs for the unbounded index range coding ops.
+
+The arguments are checked once when the table is created, and the decode table
+(see `CdfToDecodeTable`) is computed along with it. The returned handle can be
+passed to `BatchedUnboundedIndexRangeEncodeWithCdfTable` and
+`BatchedUnboundedIndexRangeDecodeWithCdfTable`, which then skip the checks of
+the CDFs regardless of their `debug_level`.
+
+The table is kept across runs of this op, and is only recreated when the op is
+run with different input tensors, e.g., after the variables holding the CDFs
+were assigned to. The CDFs are stored in the packed format of
+`CreatePackedCdfTable`, without the padding of `cdf`.
+
+cdf: An int32 tensor. See `UnboundedIndexRangeEncode`.
+cdf_size: An int32 tensor. See `UnboundedIndexRangeEncode`.
+offset: An int32 tensor. See `UnboundedIndexRangeEncode`.
+handle: A handle to the table.
+precision: The number of bits for probability quantization. Must be <= 16, and
+  must match the precision of the coding ops the table is passed to.
+container: If non-empty, the table is placed in the given container.
+shared_name: If non-empty, the table is shared under the given name across
+  multiple sessions.
+)doc");
+
+REGISTER_OP("CreatePackedCdfTable")
+    .Input("cdf_values: uint16")
+    .Input("cdf_row_splits: int32")
+    .Input("offset: int32")
+    .Output("handle: resource")
+    .Attr("precision: int >= 1")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Same as `CreateCdfTable`, but takes the CDFs in a packed format, in which each
+CDF takes only as much memory as it needs regardless of the longest one.
+
+The i-th CDF is `cdf_values[cdf_row_splits[i]:cdf_row_splits[i + 1]]`, followed
+by 2^precision, which is not stored. That is, it equals
+`cdf[i, :cdf_size[i] - 1]` with the arguments of `CreateCdfTable`. Because the
+stored values are less than 2^precision, they fit in 16 bits for any valid
+precision. Each CDF should start from 0, be strictly increasing, and hold at
+least 2 values.
+
+`CreateCdfTable` stores the table in this format, so the handles returned by
+both ops can be used interchangeably.
+
+cdf_values: A uint16 vector with the concatenated CDFs.
+cdf_row_splits: An int32 vector with one element more than the number of CDFs,
+  starting from 0 and ending at the length of `cdf_values`.
+offset: An int32 vector with one element per CDF. See
+  `UnboundedIndexRangeEncode`.
+handle: A handle to the table.
+precision: The number of bits for probability quantization. Must be <= 16, and
+  must match the precision of the coding ops the table is passed to.
+container: If non-empty, the table is placed in the given container.
+shared_name: If non-empty, the table is shared under the given name across
+  multiple sessions.
+)doc");
+
+REGISTER_OP("SaveCdfTable")
+    .Input("table: resource")
+    .Input("filename: string")
+    .Attr("precision: int >= 1")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::NoOutputs)
+    .Doc(R"doc(
+Writes a table of CDFs to a file, which can be loaded by `LoadCdfTable`.
+
+The file holds the CDFs in the packed format, `offset`, and the decode tables,
+each aligned to 64 bytes, so that `LoadCdfTable` can map the file into memory
+and use it as it is. The values are stored in the byte order of the host, and
+the file can only be loaded on hosts with the same byte order.
+
+table: A handle to a table created by `CreateCdfTable` or its variants.
+filename: A scalar string with the name of the file.
+precision: Must match the precision of the table.
+)doc");
+
+REGISTER_OP("LoadCdfTable")
+    .Input("filename: string")
+    .Output("handle: resource")
+    .Attr("precision: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Loads a table of CDFs from a file written by `SaveCdfTable`.
+
+The file is mapped into memory, and the table refers to the mapped file instead
+of copying it. Neither the CDFs nor the decode tables are recomputed, so that
+loading a table takes little time regardless of its size. When several
+processes on a host load the same file, they share its pages in the page cache.
+
+The table is kept across runs of this op like with `CreateCdfTable`, and is
+only loaded again when the op is run with a different `filename` tensor. The
+returned handle can be used in place of those returned by `CreateCdfTable`.
+
+filename: A scalar string with the name of the file.
+handle: A handle to the table.
+precision: Must match the precision the table was saved with.
+debug_level: Either 0 or 1. With 1, the CDFs and decode tables in the file are
+  checked, which reads the whole file once. With 0, only the size of the file
+  is checked against its header, and the contents are trusted.
+container: If non-empty, the table is placed in the given container.
+shared_name: If non-empty, the table is shared under the given name across
+  multiple sessions.
+)doc");
+
+REGISTER_OP("BatchedUnboundedIndexRangeEncodeWithCdfTable")
+    .Input("data: int32")
+    .Input("index: int32")
+    .Input("table: resource")
+    .Output("encoded: string")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle data;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &data));
+      c->set_output(0, c->Vector(c->Dim(data, 0)));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Same as `BatchedUnboundedIndexRangeEncode`, but takes the CDFs from a table
+created by `CreateCdfTable`.
+
+The output is identical to that of `BatchedUnboundedIndexRangeEncode` with the
+arguments the table was created from. If `debug_level` is greater than 0, only
+`index` is checked.
+
+table: A handle to a table created by `CreateCdfTable` with `precision`.
+)doc");
+
+REGISTER_OP("BatchedQuantizeAndRangeEncodeWithCdfTable")
+    .Input("data: T")
+    .Input("index: int32")
+    .Input("quantization_offset: T")
+    .Input("table: resource")
+    .Output("encoded: string")
+    .Attr("T: {half, bfloat16, float, double}")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle data;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &data));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &unused));
+      c->set_output(0, c->Vector(c->Dim(data, 0)));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Quantizes floating point values and range encodes them with a `CdfTable`.
+
+This is a fused version of rounding `data - quantization_offset[index]` to the
+nearest integer, with ties rounded to even as by `tf.round`, and passing the
+result to `BatchedUnboundedIndexRangeEncodeWithCdfTable`, which outputs the same
+strings. The quantized values are never stored in memory.
+
+Also, `index` does not need to be as large as `data`. It may have the shape of
+the innermost axes of a string, in which case it is tiled over the other axes
+and over the batch. For example, the CDF of each channel of a batch of images
+with shape [batch, height, width, channels] can be selected with an `index` of
+shape [channels]. The other arguments are the same as for
+`BatchedUnboundedIndexRangeEncodeWithCdfTable`.
+
+data: A floating point tensor. The first axis is the batch axis, and each
+  element along it is encoded into a separate string.
+index: An int32 tensor with values in [0, number of CDFs in `table`). Its shape
+  is either that of the innermost axes of `data[0]`, or `data.shape` with the
+  first axis replaced by 1 or the batch size.
+quantization_offset: A 1-D tensor with one element for each CDF in `table`,
+  which is subtracted from the values before rounding.
+encoded: A 1-D string tensor with the encoded strings.
+table: A handle to a table created by `CreateCdfTable` with `precision`.
+)doc");
+
+REGISTER_OP("BatchedUnboundedIndexRangeDecodeWithCdfTable")
+    .Input("encoded: string")
+    .Input("index: int32")
+    .Input("table: resource")
+    .Output("decoded: int32")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle encoded;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &encoded));
+      ShapeHandle index;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(1), 1, &index));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->ReplaceDim(index, 0, c->Dim(encoded, 0), &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Same as `BatchedUnboundedIndexRangeDecode`, but takes the CDFs from a table
+created by `CreateCdfTable`, and looks up symbols using the decode table stored
+with it.
+
+The output is identical to that of `BatchedUnboundedIndexRangeDecode` with the
+arguments the table was created from. If `debug_level` is greater than 0, only
+`index` is checked.
+
+table: A handle to a table created by `CreateCdfTable` with `precision`.
+)doc");
+
+REGISTER_OP("BatchedRangeDecodeAndDequantizeWithCdfTable")
+    .Input("encoded: string")
+    .Input("shape: int32")
+    .Input("index: int32")
+    .Input("quantization_offset: T")
+    .Input("table: resource")
+    .Output("decoded: T")
+    .Attr("T: {half, bfloat16, float, double}")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("debug_level: int = 1")
+    .Attr("num_chunks: int = 1")
+    .Attr("interleave: int = 1")
+    .Attr("group_by_index: bool = false")
+    .Attr("coder_version: int = 1")
+    .Attr("checksum: bool = false")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle encoded;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &encoded));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 1, &unused));
+      ShapeHandle shape;
+      TF_RETURN_IF_ERROR(c->MakeShapeFromShapeTensor(1, &shape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(c->Vector(c->Dim(encoded, 0)), shape,
+                                        &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Decodes strings encoded by `BatchedQuantizeAndRangeEncodeWithCdfTable`.
+
+This is a fused version of `BatchedUnboundedIndexRangeDecodeWithCdfTable`,
+followed by casting the result to `T` and adding
+`quantization_offset[index]`. The decoded integers are never stored in memory.
+The other arguments are the same as for
+`BatchedUnboundedIndexRangeDecodeWithCdfTable`.
+
+encoded: A 1-D string tensor with the encoded strings.
+shape: An int32 vector, the shape of the values encoded into each string.
+index: An int32 tensor with values in [0, number of CDFs in `table`). Its shape
+  is either a suffix of `shape`, in which case it is tiled, or `shape` preceded
+  by an axis of size 1 or the batch size.
+quantization_offset: A 1-D tensor with one element for each CDF in `table`,
+  which is added to the decoded values.
+decoded: A tensor of shape `[encoded.shape[0]] + shape`.
+table: A handle to a table created by `CreateCdfTable` with `precision`.
+)doc");
+
+REGISTER_OP("CreateRangeEncodeStream")
+    .Input("table: resource")
+    .Output("handle: resource")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Creates a stream that encodes a bitstream of `UnboundedIndexRangeEncode` piece
+by piece.
+
+The stream is advanced by `RangeEncodeStreamNext`, which encodes the next
+values and returns the bytes of the bitstream that are determined so far. Only
+the state of the range encoder is carried between the runs, so that the memory
+use does not grow with the size of the whole bitstream. The concatenation of
+the fragments is identical to the output of `UnboundedIndexRangeEncode` with
+`num_chunks` = 1 and `interleave` = 1 for all values, and may be decoded by
+`CreateRangeDecodeStream`.
+
+Each run of this op starts a new stream, and discards the state of the stream
+it previously created.
+
+table: A handle to a table created by `CreateCdfTable` with `precision`.
+handle: A handle to the stream.
+precision: Must match the precision of the table.
+overflow_width: See `UnboundedIndexRangeEncode`.
+container: If non-empty, the stream is placed in the given container.
+shared_name: If non-empty, the stream is shared under the given name across
+  multiple sessions.
+)doc");
+
+REGISTER_OP("RangeEncodeStreamNext")
+    .Input("handle: resource")
+    .Input("data: int32")
+    .Input("index: int32")
+    .Input("final: bool")
+    .Output("fragment: string")
+    .Attr("debug_level: int = 1")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->Merge(c->input(1), c->input(2), &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      c->set_output(0, c->Scalar());
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Encodes the next values into a stream created by `CreateRangeEncodeStream`.
+
+The values are appended to the values of the previous runs of this op on the
+same stream, in the order of the flattened `data`. The returned fragment holds
+the bytes that are determined by the values encoded so far, and follows the
+fragment of the previous run. It may be empty.
+
+Once `final` is true, the bitstream is finalized, and the stream rejects any
+further values.
+
+handle: A handle to the stream.
+data: An int32 tensor with the next values to encode.
+index: An int32 tensor of the same shape as `data`, with the CDF indexes of the
+  values, see `UnboundedIndexRangeEncode`.
+final: A scalar bool tensor. Whether `data` holds the last values.
+fragment: A scalar string tensor with the next bytes of the bitstream.
+debug_level: Either 0 or 1. If 1, `index` is checked against the table.
+)doc");
+
+REGISTER_OP("CreateRangeDecodeStream")
+    .Input("table: resource")
+    .Output("handle: resource")
+    .Attr("precision: int >= 1")
+    .Attr("overflow_width: int >= 1")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Creates a stream that decodes a bitstream of `UnboundedIndexRangeEncode` while
+it arrives.
+
+The stream is advanced by `RangeDecodeStreamNext`, which takes the bitstream in
+fragments of any size, and returns the values that can be decoded from the
+bytes received so far. The stream only holds the bytes that have not been read
+yet, so that the memory use is bounded by the fragments instead of the whole
+bitstream. Only the format with `num_chunks` = 1 and `interleave` = 1 can be
+decoded as a stream.
+
+Each run of this op starts a new stream, and discards the state of the stream
+it previously created.
+
+table: A handle to a table created by `CreateCdfTable` with `precision`, holding
+  the CDFs the bitstream was encoded with.
+handle: A handle to the stream.
+precision: Must match the precision of the table.
+overflow_width: See `UnboundedIndexRangeEncode`.
+container: If non-empty, the stream is placed in the given container.
+shared_name: If non-empty, the stream is shared under the given name across
+  multiple sessions.
+)doc");
+
+REGISTER_OP("RangeDecodeStreamNext")
+    .Input("handle: resource")
+    .Input("fragment: string")
+    .Input("index: int32")
+    .Input("final: bool")
+    .Output("decoded: int32")
+    .Attr("debug_level: int = 1")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      c->set_output(0, c->Vector(c->UnknownDim()));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Appends a fragment of the bitstream to a stream created by
+`CreateRangeDecodeStream`, and decodes the next values.
+
+The values are decoded in the order of `index`, continuing where the previous
+run of this op on the same stream stopped. As many leading values as the bytes
+received so far allow are decoded; a value is only decoded if the bytes of the
+longest possible code for it have arrived, so that decoding never runs past the
+received bytes. The caller passes the indexes of the remaining values again in
+the next run, along with the next fragment.
+
+Once `final` is true, all values of `index` are decoded, treating `fragment` as
+the end of the bitstream.
+
+handle: A handle to the stream.
+fragment: A scalar string tensor with the next bytes of the bitstream. May be
+  empty.
+index: An int32 tensor with the CDF indexes of the next values to decode, see
+  `UnboundedIndexRangeEncode`. It is flattened.
+final: A scalar bool tensor. Whether `fragment` ends the bitstream.
+decoded: An int32 vector with the decoded values for the leading elements of
+  `index`.
+debug_level: Either 0 or 1. If 1, `index` is checked against the table.
+)doc");
+
+REGISTER_OP("AdaptiveRangeEncode")
+    .Input("data: int32")
+    .Input("context: int32")
+    .Output("encoded: string")
+    .Attr("num_symbols: int >= 2")
+    .Attr("num_contexts: int >= 1")
+    .Attr("precision: int = 15")
+    .Attr("adaptation_rate: int = 5")
+    .Attr("debug_level: int = 1")
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Range encodes integers with an adaptive probability model.
+
+Instead of taking CDFs from the caller, this op keeps a CDF for each of
+`num_contexts` contexts, which is learned while coding. Each value of `data` is
+coded with the CDF of its element of `context`, in the order of the flattened
+tensors. All CDFs start out uniform over [0, `num_symbols`), and after each
+value, the CDF it was coded with moves its probability mass towards the value
+by 2^-adaptation_rate of the distance to the distribution that puts all mass on
+the value. Each value keeps a probability of at least 2^-precision.
+
+This is meant for small streams of side information, such as header fields or
+flags, for which precomputed CDFs would cost more than they save. The cost per
+value grows linearly with `num_symbols`, so the alphabet should be small.
+
+data: An int32 tensor with values in [0, `num_symbols`).
+context: An int32 tensor with the same shape as `data`, with values in
+  [0, `num_contexts`).
+encoded: A range-coded scalar string.
+num_symbols: The number of symbols of each CDF. Must be less than
+  2^precision.
+num_contexts: The number of independently adapted CDFs.
+precision: The number of bits for probability quantization. Must be <= 16.
+adaptation_rate: Controls how fast the CDFs adapt, in [1, 16]. Smaller values
+  adapt faster, larger values result in more stable estimates.
+debug_level: Either 0 or 1. If 1, `data` and `context` are checked to be in
+  range.
+)doc");
+
+REGISTER_OP("AdaptiveRangeDecode")
+    .Input("encoded: string")
+    .Input("context: int32")
+    .Output("decoded: int32")
+    .Attr("num_symbols: int >= 2")
+    .Attr("num_contexts: int >= 1")
+    .Attr("precision: int = 15")
+    .Attr("adaptation_rate: int = 5")
+    .Attr("debug_level: int = 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      c->set_output(0, c->input(1));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Decodes a string encoded by `AdaptiveRangeEncode`.
+
+The attributes must match those used by `AdaptiveRangeEncode`, and `context`
+must be the same tensor, so that the CDFs adapt in the same way.
+
+encoded: A scalar string tensor from `AdaptiveRangeEncode`.
+context: An int32 tensor with the contexts of the values, with values in
+  [0, `num_contexts`).
+decoded: An int32 tensor with the same shape as `context`.
+num_symbols: Must match the value used by `AdaptiveRangeEncode`.
+num_contexts: Must match the value used by `AdaptiveRangeEncode`.
+precision: Must match the value used by `AdaptiveRangeEncode`.
+adaptation_rate: Must match the value used by `AdaptiveRangeEncode`.
+debug_level: Either 0 or 1. If 1, `context` is checked to be in range.
 )doc");
 
 REGISTER_OP("PmfToQuantizedCdf")
@@ -272,5 +1299,121 @@ by this op prior to quantization. Therefore the user is responsible for
 normalizing PMF if necessary.
 )doc");
 
+REGISTER_OP("BatchedPmfToQuantizedCdf")
+    .Input("pmf: float")
+    .Input("pmf_length: int32")
+    .Output("cdf: int32")
+    .Attr("precision: int >= 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle pmf;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 2, &pmf));
+      ShapeHandle pmf_length;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &pmf_length));
+      DimensionHandle rows;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(pmf, 0), c->Dim(pmf_length, 0), &rows));
+      DimensionHandle width;
+      TF_RETURN_IF_ERROR(c->Add(c->Dim(pmf, 1), 1, &width));
+      c->set_output(0, c->Matrix(rows, width));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Converts a batch of PMFs of different lengths to quantized CDFs.
+
+This op is equivalent to running `PmfToQuantizedCdf` on `pmf[i, :pmf_length[i]]`
+for each row `i`, and padding the resulting CDFs with zeros to a common length,
+but all rows are converted in parallel on the CPU worker threads.
+
+pmf: A 2-D float tensor. Row `i` holds a PMF in its first `pmf_length[i]`
+  elements. The remaining elements are ignored.
+pmf_length: An int32 vector with one element per row of `pmf`. Each value
+  should be in `[2, pmf.shape[1]]`.
+cdf: An int32 tensor with shape `[pmf.shape[0], pmf.shape[1] + 1]`. Row `i`
+  holds a CDF in its first `pmf_length[i] + 1` elements, followed by zeros.
+precision: The number of bits for probability quantization. Must be <= 16.
+)doc");
+
+REGISTER_OP("BatchedPmfToQuantizedCdfWithOverflow")
+    .Input("pmf: float")
+    .Input("pmf_length: int32")
+    .Input("overflow: float")
+    .Output("cdf: int32")
+    .Attr("precision: int >= 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle pmf;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 2, &pmf));
+      ShapeHandle pmf_length;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &pmf_length));
+      ShapeHandle overflow;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &overflow));
+      DimensionHandle rows;
+      TF_RETURN_IF_ERROR(
+          c->Merge(c->Dim(pmf, 0), c->Dim(pmf_length, 0), &rows));
+      TF_RETURN_IF_ERROR(c->Merge(rows, c->Dim(overflow, 0), &rows));
+      DimensionHandle width;
+      TF_RETURN_IF_ERROR(c->Add(c->Dim(pmf, 1), 2, &width));
+      c->set_output(0, c->Matrix(rows, width));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Same as `BatchedPmfToQuantizedCdf`, but appends an overflow mass to each PMF.
+
+Row `i` of the output is the CDF of `pmf[i, :pmf_length[i]]` followed by
+`overflow[i]`, i.e., the CDF expected by `UnboundedIndexRangeEncode`, in which
+the last symbol is the overflow code. This replaces slicing, concatenating, and
+padding each row in the graph.
+
+pmf: A 2-D float tensor. Row `i` holds a PMF in its first `pmf_length[i]`
+  elements. The remaining elements are ignored.
+pmf_length: An int32 vector with one element per row of `pmf`. Each value
+  should be in `[1, pmf.shape[1]]`.
+overflow: A float vector with one element per row of `pmf`, the probability
+  mass of the values outside of the range of the PMF.
+cdf: An int32 tensor with shape `[pmf.shape[0], pmf.shape[1] + 2]`. Row `i`
+  holds a CDF in its first `pmf_length[i] + 2` elements, followed by zeros.
+precision: The number of bits for probability quantization. Must be <= 16.
+)doc");
+
+REGISTER_OP("CdfToDecodeTable")
+    .Input("cdf: int32")
+    .Output("decode_table: int16")
+    .Attr("precision: int >= 1")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle in;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &in));
+      int precision;
+      TF_RETURN_IF_ERROR(c->GetAttr("precision", &precision));
+      // Must match kMaxDecodeTableBits in range_coding_kernels_util.h.
+      const int table_bits = std::min(precision, 12);
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(
+          c->ReplaceDim(in, -1, c->MakeDim(1 << table_bits), &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Creates decode tables for the `*WithTable` range decoding ops.
+
+For each CDF in the innermost axis of `cdf`, the op computes a table that maps
+the top `min(precision, 12)` bits of a probability value to the symbol whose
+interval contains the value. When `precision <= 12`, the decoder finds every
+symbol with one table lookup. Otherwise, it starts from the table entry and
+scans forward, which typically takes a step or two. In either case, the binary
+search over the CDF is avoided.
+
+Any entries of a CDF after the first one that equals `2^precision` are ignored.
+Therefore the padded `cdf` tensors of `UnboundedIndexRangeDecode` can be passed.
+
+The table only depends on `cdf`. It is meant to be computed once and reused for
+many decode calls.
+
+cdf: An int32 tensor with the CDF's, as passed to the decode ops. The innermost
+  axis should have size at most 2^15.
+decode_table: An int16 tensor with shape
+  `cdf.shape[:-1] + [2^min(precision, 12)]`.
+precision: The number of bits for probability quantization, as passed to the
+  decode ops.
+)doc");
+
 }  // namespace
 }  // namespace tensorflow_compression
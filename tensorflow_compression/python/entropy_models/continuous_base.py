@@ -269,19 +269,15 @@ class ContinuousEntropyModelBase(tf.Module, metaclass=abc.ABCMeta):
 
     # Prevent tensors from bouncing back and forth between host and GPU.
     with tf.device("/cpu:0"):
-      def loop_body(args):
-        prob, length = args
-        prob = prob[:length]
-        overflow = tf.math.maximum(1 - tf.reduce_sum(prob, keepdims=True), 0.)
-        prob = tf.concat([prob, overflow], axis=0)
-        cdf = range_coding_ops.pmf_to_quantized_cdf(
-            prob, precision=self.range_coder_precision)
-        return tf.pad(
-            cdf, [[0, max_length - length]], mode="CONSTANT", constant_values=0)
-
-      # TODO(jonycgn,ssjhv): Consider switching to Python control flow.
-      cdf = tf.map_fn(
-          loop_body, (pmf, pmf_length), dtype=tf.int32, name="pmf_to_cdf")
+      # The op appends the overflow mass to each PMF, at the position given by
+      # its length. The remaining elements are ignored.
+      mask = tf.sequence_mask(pmf_length, max_length)
+      overflow = tf.math.maximum(
+          1 - tf.reduce_sum(tf.where(mask, pmf, tf.zeros_like(pmf)), axis=1),
+          0.)
+      cdf = range_coding_ops.batched_pmf_to_quantized_cdf_with_overflow(
+          pmf, pmf_length, overflow, precision=self.range_coder_precision,
+          name="pmf_to_cdf")
 
     if self.no_variables:
       self._cdf = cdf
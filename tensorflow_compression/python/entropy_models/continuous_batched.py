@@ -153,14 +153,31 @@ class ContinuousBatchedEntropyModel(continuous_base.ContinuousEntropyModelBase):
     return tf.convert_to_tensor(self._quantization_offset)
 
   def _compute_indexes_and_offset(self, broadcast_shape):
-    """Returns the indexes for range coding and the quantization offset."""
-    # TODO(jonycgn, ssjhv): Investigate broadcasting in range coding op.
+    """Returns the indexes for range coding and the quantization offset.
+
+    The range coding ops tile the indexes over `broadcast_shape`, and look up
+    the quantization offset of each value by its index, so neither needs to be
+    materialized at full size.
+
+    Arguments:
+      broadcast_shape: The part of the shape of a coding unit to the left of
+        `self.prior_shape`.
+
+    Returns:
+      A tuple (indexes, offset), where `indexes` is an int32 tensor with the
+      shape of the innermost dimensions of a coding unit, and `offset` is a
+      vector with the quantization offset for each CDF in `self.cdf`.
+    """
+    del broadcast_shape  # Unused.
     prior_size = functools.reduce(lambda x, y: x * y, self.prior_shape, 1)
     indexes = tf.range(prior_size, dtype=tf.int32)
     indexes = tf.reshape(indexes, self.prior_shape_tensor)
-    indexes = tf.broadcast_to(
-        indexes, tf.concat([broadcast_shape, self.prior_shape_tensor], 0))
-    return indexes, self.quantization_offset
+    offset = self.quantization_offset
+    if offset is None:
+      offset = tf.zeros([prior_size], dtype=self.dtype)
+    else:
+      offset = tf.reshape(offset, [-1])
+    return indexes, offset
 
   @tf.Module.with_name_scope
   def __call__(self, bottleneck, training=True):
@@ -248,26 +265,21 @@ class ContinuousBatchedEntropyModel(continuous_base.ContinuousEntropyModelBase):
     broadcast_shape = coding_shape[
         :self.coding_rank - len(self.prior_shape)]
 
+    # The op quantizes the values itself.
     indexes, offset = self._compute_indexes_and_offset(broadcast_shape)
-    if offset is not None:
-      bottleneck -= offset
-    symbols = tf.cast(tf.round(bottleneck), tf.int32)
-    symbols = tf.reshape(symbols, tf.concat([[-1], coding_shape], 0))
+    bottleneck = tf.cast(bottleneck, self.dtype)
+    bottleneck = tf.reshape(bottleneck, tf.concat([[-1], coding_shape], 0))
 
     # Prevent tensors from bouncing back and forth between host and GPU.
     with tf.device("/cpu:0"):
-      cdf = self.cdf
-      cdf_length = self.cdf_length
-      cdf_offset = self.cdf_offset
-      def loop_body(symbols):
-        return range_coding_ops.unbounded_index_range_encode(
-            symbols, indexes, cdf, cdf_length, cdf_offset,
-            precision=self.range_coder_precision,
-            overflow_width=4, debug_level=1)
-
-      # TODO(jonycgn,ssjhv): Consider switching to Python control flow.
-      strings = tf.map_fn(
-          loop_body, symbols, dtype=tf.string, name="compress")
+      table = range_coding_ops.create_cdf_table(
+          self.cdf, self.cdf_length, self.cdf_offset,
+          precision=self.range_coder_precision)
+      strings = (
+          range_coding_ops.batched_quantize_and_range_encode_with_cdf_table(
+              bottleneck, indexes, offset, table,
+              precision=self.range_coder_precision,
+              overflow_width=4, debug_level=1, name="compress"))
 
     strings = tf.reshape(strings, batch_shape)
     return strings
@@ -293,30 +305,24 @@ class ContinuousBatchedEntropyModel(continuous_base.ContinuousEntropyModelBase):
     strings = tf.convert_to_tensor(strings, dtype=tf.string)
     broadcast_shape = tf.convert_to_tensor(broadcast_shape, dtype=tf.int32)
     batch_shape = tf.shape(strings)
-    symbols_shape = tf.concat(
-        [batch_shape, broadcast_shape, self.prior_shape_tensor], 0)
+    coding_shape = tf.concat([broadcast_shape, self.prior_shape_tensor], 0)
 
+    # The op adds the quantization offset itself.
     indexes, offset = self._compute_indexes_and_offset(broadcast_shape)
     strings = tf.reshape(strings, [-1])
 
     # Prevent tensors from bouncing back and forth between host and GPU.
     with tf.device("/cpu:0"):
-      cdf = self.cdf
-      cdf_length = self.cdf_length
-      cdf_offset = self.cdf_offset
-      def loop_body(string):
-        return range_coding_ops.unbounded_index_range_decode(
-            string, indexes, cdf, cdf_length, cdf_offset,
-            precision=self.range_coder_precision,
-            overflow_width=4, debug_level=1)
-
-      # TODO(jonycgn,ssjhv): Consider switching to Python control flow.
-      symbols = tf.map_fn(
-          loop_body, strings, dtype=tf.int32, name="decompress")
-
-    symbols = tf.reshape(symbols, symbols_shape)
-    outputs = tf.cast(symbols, self.dtype)
-    return outputs + offset if offset is not None else outputs
+      table = range_coding_ops.create_cdf_table(
+          self.cdf, self.cdf_length, self.cdf_offset,
+          precision=self.range_coder_precision)
+      outputs = (
+          range_coding_ops.batched_range_decode_and_dequantize_with_cdf_table(
+              strings, coding_shape, indexes, offset, table,
+              precision=self.range_coder_precision,
+              overflow_width=4, debug_level=1, name="decompress"))
+
+    return tf.reshape(outputs, tf.concat([batch_shape, coding_shape], 0))
 
   def get_config(self):
     """Returns the configuration of the entropy model.
@@ -390,18 +390,14 @@ class ContinuousIndexedEntropyModel(continuous_base.ContinuousEntropyModelBase):
 
     # Prevent tensors from bouncing back and forth between host and GPU.
     with tf.device("/cpu:0"):
-      cdf = self.cdf
-      cdf_length = self.cdf_length
-      cdf_offset = self.cdf_offset
-      def loop_body(args):
-        return range_coding_ops.unbounded_index_range_encode(
-            args[0], args[1], cdf, cdf_length, cdf_offset,
-            precision=self.range_coder_precision,
-            overflow_width=4, debug_level=1)
-
-      # TODO(jonycgn,ssjhv): Consider switching to Python control flow.
-      strings = tf.map_fn(
-          loop_body, (symbols, flat_indexes), dtype=tf.string, name="compress")
+      table = range_coding_ops.create_cdf_table(
+          self.cdf, self.cdf_length, self.cdf_offset,
+          precision=self.range_coder_precision)
+      strings = (
+          range_coding_ops.batched_unbounded_index_range_encode_with_cdf_table(
+              symbols, flat_indexes, table,
+              precision=self.range_coder_precision,
+              overflow_width=4, debug_level=1, name="compress"))
 
     strings = tf.reshape(strings, batch_shape)
     return strings
@@ -433,18 +429,14 @@ class ContinuousIndexedEntropyModel(continuous_base.ContinuousEntropyModelBase):
 
     # Prevent tensors from bouncing back and forth between host and GPU.
     with tf.device("/cpu:0"):
-      cdf = self.cdf
-      cdf_length = self.cdf_length
-      cdf_offset = self.cdf_offset
-      def loop_body(args):
-        return range_coding_ops.unbounded_index_range_decode(
-            args[0], args[1], cdf, cdf_length, cdf_offset,
-            precision=self.range_coder_precision,
-            overflow_width=4, debug_level=1)
-
-      # TODO(jonycgn,ssjhv): Consider switching to Python control flow.
-      symbols = tf.map_fn(
-          loop_body, (strings, flat_indexes), dtype=tf.int32, name="decompress")
+      table = range_coding_ops.create_cdf_table(
+          self.cdf, self.cdf_length, self.cdf_offset,
+          precision=self.range_coder_precision)
+      symbols = (
+          range_coding_ops.batched_unbounded_index_range_decode_with_cdf_table(
+              strings, flat_indexes, table,
+              precision=self.range_coder_precision,
+              overflow_width=4, debug_level=1, name="decompress"))
 
     symbols = tf.reshape(symbols, symbols_shape)
     offset = self._offset_from_indexes(indexes)
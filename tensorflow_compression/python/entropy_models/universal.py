@@ -148,6 +148,17 @@ class UniversalBatchedEntropyModel(
 
   def _compute_indexes_and_offset(self, broadcast_shape):
     """See base class."""
+    # The indexes depend on the pseudorandom offsets, so they can't be tiled.
+    indexes, _ = self._compute_full_indexes_and_offset(broadcast_shape)
+    prior_size = functools.reduce(lambda x, y: x * y, self.prior_shape, 1)
+    offset_indexes = tf.range(
+        self._num_noise_levels * prior_size, dtype=tf.int32) // prior_size
+    offset = _offset_indexes_to_offset(offset_indexes, self._num_noise_levels,
+                                       self.dtype)
+    return indexes, offset
+
+  def _compute_full_indexes_and_offset(self, broadcast_shape):
+    """Returns the indexes and the offset for each element of a coding unit."""
     # TODO(relational): Switch to math.prod when we switch to Python 3.8
     prior_size = functools.reduce(lambda x, y: x * y, self.prior_shape, 1)
     # Create index for each dimension in prior_shape.
@@ -210,7 +221,7 @@ class UniversalBatchedEntropyModel(
           input_shape, [input_rank - self.coding_rank, self.coding_rank])
       broadcast_shape = coding_shape[
           :self.coding_rank - len(self.prior_shape)]
-      _, offset = self._compute_indexes_and_offset(broadcast_shape)
+      _, offset = self._compute_full_indexes_and_offset(broadcast_shape)
       symbols = tf.round(bottleneck - offset)
       bottleneck_perturbed = symbols + offset
       log_probs = log_prob_fn(bottleneck_perturbed)
@@ -127,22 +127,14 @@ class EntropyModel(tf.keras.layers.Layer):
     """
     raise NotImplementedError("Must inherit from EntropyModel.")
 
-  def _pmf_to_cdf(self, pmf, tail_mass, pmf_length, max_length):
+  def _pmf_to_cdf(self, pmf, tail_mass, pmf_length):
     """Helper function for computing the CDF from the PMF."""
 
     # Prevent tensors from bouncing back and forth between host and GPU.
     with tf.device("/cpu:0"):
-      def loop_body(args):
-        prob, length, tail = args
-        prob = tf.concat([prob[:length], tail], axis=0)
-        cdf = range_coding_ops.pmf_to_quantized_cdf(
-            prob, precision=self.range_coder_precision)
-        return tf.pad(
-            cdf, [[0, max_length - length]], mode="CONSTANT", constant_values=0)
-
-      return tf.map_fn(
-          loop_body, (pmf, pmf_length, tail_mass),
-          dtype=tf.int32, back_prop=False, name="pmf_to_cdf")
+      return range_coding_ops.batched_pmf_to_quantized_cdf_with_overflow(
+          pmf, pmf_length, tf.reshape(tail_mass, [-1]),
+          precision=self.range_coder_precision, name="pmf_to_cdf")
 
   def call(self, inputs, training):
     """Pass a tensor through the bottleneck.
@@ -222,25 +214,15 @@ class EntropyModel(tf.keras.layers.Layer):
 
       ndim = self.input_spec.ndim
       indexes = self._prepare_indexes(shape=tf.shape(symbols)[1:])
-      broadcast_indexes = (indexes.shape.ndims != ndim)
-      if broadcast_indexes:
+      if indexes.shape.ndims != ndim:
         # We can't currently broadcast over anything else but the batch axis.
         assert indexes.shape.ndims == ndim - 1
-        args = (symbols,)
-      else:
-        args = (symbols, indexes)
-
-      def loop_body(args):
-        string = range_coding_ops.unbounded_index_range_encode(
-            args[0], indexes if broadcast_indexes else args[1],
-            self._quantized_cdf, self._cdf_length, self._offset,
-            precision=self.range_coder_precision, overflow_width=4,
-            debug_level=0)
-        return string
-
-      strings = tf.map_fn(
-          loop_body, args, dtype=tf.string,
-          back_prop=False, name="compress")
+        indexes = tf.expand_dims(indexes, 0)
+
+      strings = range_coding_ops.batched_unbounded_index_range_encode(
+          symbols, indexes, self._quantized_cdf, self._cdf_length,
+          self._offset, precision=self.range_coder_precision, overflow_width=4,
+          debug_level=0, name="compress")
 
       if not tf.executing_eagerly():
         strings.set_shape(inputs.shape[:1])
@@ -262,24 +244,15 @@ class EntropyModel(tf.keras.layers.Layer):
 
       indexes = self._prepare_indexes(**kwargs)
       ndim = self.input_spec.ndim
-      broadcast_indexes = (indexes.shape.ndims != ndim)
-      if broadcast_indexes:
+      if indexes.shape.ndims != ndim:
         # We can't currently broadcast over anything else but the batch axis.
         assert indexes.shape.ndims == ndim - 1
-        args = (strings,)
-      else:
-        args = (strings, indexes)
-
-      def loop_body(args):
-        symbols = range_coding_ops.unbounded_index_range_decode(
-            args[0], indexes if broadcast_indexes else args[1],
-            self._quantized_cdf, self._cdf_length, self._offset,
-            precision=self.range_coder_precision, overflow_width=4,
-            debug_level=0)
-        return symbols
+        indexes = tf.expand_dims(indexes, 0)
 
-      symbols = tf.map_fn(
-          loop_body, args, dtype=tf.int32, back_prop=False, name="decompress")
+      symbols = range_coding_ops.batched_unbounded_index_range_decode(
+          strings, indexes, self._quantized_cdf, self._cdf_length,
+          self._offset, precision=self.range_coder_precision, overflow_width=4,
+          debug_level=0, name="decompress")
 
       outputs = self._dequantize(symbols, "dequantize")
       assert outputs.dtype == self.dtype
@@ -589,7 +562,7 @@ class EntropyBottleneck(EntropyModel):
 
     update_cdf = tf.assign(
         quantized_cdf,
-        self._pmf_to_cdf(pmf, tail_mass, pmf_length, max_length),
+        self._pmf_to_cdf(pmf, tail_mass, pmf_length),
         validate_shape=False)
     update_length = tf.assign(
         cdf_length,
@@ -853,7 +826,7 @@ class SymmetricConditional(EntropyModel):
       assert dtype == tf.int32
       return self._pmf_to_cdf(
           pmf, tail_mass,
-          tf.constant(pmf_length, dtype=tf.int32), max_length)
+          tf.constant(pmf_length, dtype=tf.int32))
 
     quantized_cdf = self.add_weight(
         "quantized_cdf", shape=(len(pmf_length), max_length + 2),
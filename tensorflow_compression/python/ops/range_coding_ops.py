@@ -18,7 +18,10 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+import contextlib
+
 from tensorflow.python.framework import load_library
+from tensorflow.python.framework import ops as framework_ops
 from tensorflow.python.platform import resource_loader
 from tensorflow_compression.python.ops import namespace_helper
 
@@ -28,4 +31,52 @@ ops = namespace_helper.get_ops(load_library.load_op_library(
         "../../cc/libtensorflow_compression.so")))
 
 globals().update(ops)
-__all__ = list(ops)
+__all__ = list(ops) + ["async_range_coding"]
+
+
+# The range coding ops that have kernels with label "async".
+_ASYNC_OPS = (
+    "RangeEncode",
+    "RangeDecode",
+    "RangeDecodeWithTable",
+    "UnboundedIndexRangeEncode",
+    "UnboundedIndexRangeDecode",
+    "UnboundedIndexRangeDecodeWithTable",
+    "UnboundedIndexRangeDecodeWithShape",
+    "UnboundedIndexRangeDecodeWithShapeAndTable",
+    "BatchedUnboundedIndexRangeEncode",
+    "BatchedUnboundedIndexRangeDecode",
+    "BatchedUnboundedIndexRangeDecodeWithTable",
+    "BatchedUnboundedIndexRangeEncodeWithCdfTable",
+    "BatchedUnboundedIndexRangeDecodeWithCdfTable",
+    "BatchedQuantizeAndRangeEncodeWithCdfTable",
+    "BatchedRangeDecodeAndDequantizeWithCdfTable",
+)
+
+
+@contextlib.contextmanager
+def async_range_coding(graph=None):
+  """Selects the async kernels for range coding ops created in this context.
+
+  The async kernels return at once and do the coding on the CPU worker pool,
+  so that the executor can run other ops in the meantime. When several steps
+  run concurrently, e.g. from multiple threads, the entropy coding of one step
+  then overlaps with the transforms of another. The bitstreams are the same as
+  with the default kernels.
+
+  This also applies to ops imported into `graph`, e.g. with
+  `tf.compat.v1.train.import_meta_graph`. It has no effect in eager mode.
+
+  Args:
+    graph: The `tf.Graph` in which the ops are created. Defaults to the default
+      graph.
+
+  Yields:
+    Nothing.
+  """
+  if graph is None:
+    graph = framework_ops.get_default_graph()
+  # pylint:disable=protected-access
+  with graph._kernel_label_map({op: "async" for op in _ASYNC_OPS}):
+    yield
+  # pylint:enable=protected-access
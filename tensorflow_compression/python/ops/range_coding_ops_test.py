@@ -43,6 +43,21 @@ class RangeCodingOpsTest(tf.test.TestCase):
     with self.cached_session() as sess:
       self.assertAllEqual(*sess.run((data, decoded)))
 
+  def test_async_kernels(self):
+    data = tf.random.uniform((128, 128), 0, 5, dtype=tf.int32)
+    data = tf.cast(data, tf.int16)
+    cdf = tf.constant([[[0, 3000, 6000, 9000, 12000, 16384]]], dtype=tf.int32)
+
+    with range_coding_ops.async_range_coding():
+      encoded = range_coding_ops.range_encode(data, cdf, precision=14)
+      decoded = range_coding_ops.range_decode(
+          encoded, tf.shape(data), cdf, precision=14)
+    self.assertEqual(encoded.op.get_attr("_kernel"), b"async")
+    self.assertEqual(decoded.op.get_attr("_kernel"), b"async")
+
+    with self.cached_session() as sess:
+      self.assertAllEqual(*sess.run((data, decoded)))
+
 
 if __name__ == "__main__":
   tf.test.main()